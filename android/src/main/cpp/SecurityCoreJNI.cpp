@@ -1,51 +1,355 @@
 #include <jni.h>
+#include <pthread.h>
+#include <stdlib.h>
 #include <string>
+#include <vector>
+#include <sys/system_properties.h>
 #include "SecurityCore.h"
 
-extern "C" {
-JNIEXPORT jboolean JNICALL
-Java_com_securitycore_SecurityCoreModule_runAdvancedChecksNative(JNIEnv *, jobject) {
-    return run_advanced_checks() ? JNI_TRUE : JNI_FALSE;
-}
-JNIEXPORT jboolean JNICALL
-Java_com_securitycore_SecurityCoreModule_detectDebuggerNative(JNIEnv *, jobject) {
+// Natives are bound once in JNI_OnLoad with RegisterNatives instead of
+// being looked up by their mangled Java_... names on first call.
+static const char *const MODULE_CLASS = "com/securitycore/SecurityCoreModule";
+
+// ========== Detectors ==========
+// The short detectors are @CriticalNative on API 26+: no JNIEnv, no class
+// and no thread state transition, just a plain C call. The thread stays
+// runnable for the whole call, so a critical native must never block. On a
+// cache hit check_process_name() is a lookup under the entry mutex; on a
+// miss it adds one pread() of /proc/self/cmdline into a reused arena and
+// the store under the same mutex. ART before 8.0 ignores the annotation
+// and passes (JNIEnv*, jclass) as for any static native, so each also has a
+// regular variant.
+#define SC_DETECTOR(name, expr)                                              \
+    static jboolean name##Critical() { return (expr) ? JNI_TRUE : JNI_FALSE; } \
+    static jboolean name##Regular(JNIEnv *, jclass) { return name##Critical(); }
+
+SC_DETECTOR(checkProcessName, check_process_name())
+
+#undef SC_DETECTOR
+
+// A cache miss here means reading /proc/self/status (the debugger's
+// TracerPid), a full /proc scan, or for verify_integrity() waiting on the
+// worker pool, so these are regular natives: the thread is in native state
+// and does not hold up GC while it waits.
+static jboolean detectDebuggerNative(JNIEnv *, jclass) {
     return detect_debugger() ? JNI_TRUE : JNI_FALSE;
 }
-JNIEXPORT jboolean JNICALL
-Java_com_securitycore_SecurityCoreModule_detectFridaThreadNative(JNIEnv *, jobject) {
+
+static jboolean detectFridaThreadNative(JNIEnv *, jclass) {
     return detect_frida_thread() ? JNI_TRUE : JNI_FALSE;
 }
-JNIEXPORT jboolean JNICALL
-Java_com_securitycore_SecurityCoreModule_detectMemoryMapsNative(JNIEnv *, jobject) {
+
+static jboolean detectMemoryMapsNative(JNIEnv *, jclass) {
     return detect_memory_maps() ? JNI_TRUE : JNI_FALSE;
 }
-JNIEXPORT jboolean JNICALL
-Java_com_securitycore_SecurityCoreModule_checkProcessNameNative(JNIEnv *, jobject) {
-    return check_process_name() ? JNI_TRUE : JNI_FALSE;
-}
-JNIEXPORT jboolean JNICALL
-Java_com_securitycore_SecurityCoreModule_verifyIntegrityNative(JNIEnv *, jobject) {
+
+static jboolean verifyIntegrityNative(JNIEnv *, jclass) {
     return verify_integrity() ? JNI_TRUE : JNI_FALSE;
 }
-JNIEXPORT jstring JNICALL
-Java_com_securitycore_SecurityCoreModule_xorDecodeNative(JNIEnv *env, jobject, jstring encoded,
-                                                         jchar key) {
+
+// ========== Async Checks ==========
+// Scans go through sc_submit(): the promise is resolved from the completion
+// callback on a library thread, so no bridge thread waits on the checks.
+// The result is handed to SecurityCoreModule.onChecksDone(request, packed):
+// detected, clean, cancelled and timed-out masks (bit = sc_check_id), then
+// elapsed_us for each of the SC_CHECK_COUNT checks. Must match
+// SecurityCoreModule.kt.
+static const int RUN_MASKS = 4;
+
+static JavaVM *java_vm = nullptr;
+static jmethodID on_checks_done = nullptr;
+static pthread_key_t detach_key;
+
+struct PendingChecks {
+    jobject module;
+    jlong request;
+};
+
+static void detachThread(void *) {
+    java_vm->DetachCurrentThread();
+}
+
+// Library threads are attached on first use and detached when they exit.
+static JNIEnv *attachedEnv() {
+    JNIEnv *env = nullptr;
+    if (java_vm->GetEnv((void **) &env, JNI_VERSION_1_6) == JNI_OK) return env;
+    if (java_vm->AttachCurrentThread(&env, nullptr) != JNI_OK) return nullptr;
+    pthread_setspecific(detach_key, env);
+    return env;
+}
+
+static jlongArray packRunResults(JNIEnv *env, const sc_check_result *results) {
+    jlong packed[RUN_MASKS + SC_CHECK_COUNT] = {0};
+    for (int id = 0; id < SC_CHECK_COUNT; ++id) {
+        switch (results[id].status) {
+            case SC_STATUS_DETECTED: packed[0] |= SC_CHECK_BIT(id); break;
+            case SC_STATUS_CLEAN: packed[1] |= SC_CHECK_BIT(id); break;
+            case SC_STATUS_CANCELLED: packed[2] |= SC_CHECK_BIT(id); break;
+            case SC_STATUS_TIMED_OUT: packed[3] |= SC_CHECK_BIT(id); break;
+            default: break;
+        }
+        packed[RUN_MASKS + id] = (jlong) results[id].elapsed_us;
+    }
+    jlongArray result = env->NewLongArray(RUN_MASKS + SC_CHECK_COUNT);
+    if (result) env->SetLongArrayRegion(result, 0, RUN_MASKS + SC_CHECK_COUNT, packed);
+    return result;
+}
+
+// Attached threads never return to Java, so local references are freed here.
+static void onChecksDone(sc_task, bool, const sc_check_result *results, void *userdata) {
+    PendingChecks *pending = (PendingChecks *) userdata;
+    JNIEnv *env = attachedEnv();
+    if (env) {
+        jlongArray packed = packRunResults(env, results);
+        if (packed) {
+            env->CallVoidMethod(pending->module, on_checks_done, pending->request, packed);
+            env->DeleteLocalRef(packed);
+        }
+        if (env->ExceptionCheck()) env->ExceptionClear();
+        env->DeleteGlobalRef(pending->module);
+    }
+    delete pending;
+}
+
+static void submitChecksNative(JNIEnv *env, jobject thiz, jint mask, jint deadlineMs, jboolean stopOnDetect,
+                               jlong request) {
+    PendingChecks *pending = new PendingChecks{env->NewGlobalRef(thiz), request};
+    sc_submit((unsigned int) mask, (unsigned int) deadlineMs, stopOnDetect == JNI_TRUE, nullptr, onChecksDone,
+              pending);
+}
+
+// ========== Utilities ==========
+static jstring xorDecodeNative(JNIEnv *env, jobject, jstring encoded, jchar key) {
     const char *encStr = env->GetStringUTFChars(encoded, nullptr);
     const char *decoded = xor_decode(encStr, (char) key);
     jstring result = env->NewStringUTF(decoded);
     env->ReleaseStringUTFChars(encoded, encStr);
     return result;
 }
-JNIEXPORT jint JNICALL
-Java_com_securitycore_SecurityCoreModule_crc32Native(JNIEnv *env, jobject, jbyteArray data) {
-    jsize len = env->GetArrayLength(data);
-    jbyte *bytes = env->GetByteArrayElements(data, nullptr);
-    unsigned int crc = crc32((unsigned char *) bytes, len);
-    env->ReleaseByteArrayElements(data, bytes, JNI_ABORT);
-    return (jint) crc;
+
+// ========== Hashing ==========
+// Arrays are pinned with GetPrimitiveArrayCritical rather than copied;
+// nothing in between calls back into the VM. Direct buffers are read in
+// place. offset/length are checked on the Kotlin side.
+static jbyteArray newDigest(JNIEnv *env, const unsigned char *digest) {
+    jbyteArray result = env->NewByteArray(SC_SHA256_LENGTH);
+    if (result) env->SetByteArrayRegion(result, 0, SC_SHA256_LENGTH, (const jbyte *) digest);
+    return result;
+}
+
+// GC waits while an array is pinned, so heap arrays are hashed on this
+// thread only (crc32_parallel would block on pool workers) and released
+// after every chunk.
+static const jint CRC32_PIN_CHUNK = 1024 * 1024;
+
+static jint crc32Native(JNIEnv *env, jclass, jbyteArray data, jint offset, jint length) {
+    crc32_ctx ctx;
+    crc32_init(&ctx);
+    for (jint done = 0; done < length;) {
+        jint n = length - done < CRC32_PIN_CHUNK ? length - done : CRC32_PIN_CHUNK;
+        unsigned char *bytes = (unsigned char *) env->GetPrimitiveArrayCritical(data, nullptr);
+        if (!bytes) return 0;
+        crc32_update(&ctx, bytes + offset + done, (size_t) n);
+        env->ReleasePrimitiveArrayCritical(data, bytes, JNI_ABORT);
+        done += n;
+    }
+    return (jint) crc32_final(&ctx);
+}
+static jint crc32DirectNative(JNIEnv *env, jclass, jobject buffer, jint offset, jint length) {
+    unsigned char *bytes = (unsigned char *) env->GetDirectBufferAddress(buffer);
+    if (!bytes) return 0;
+    return (jint) crc32_parallel(bytes + offset, (size_t) length, 0);
+}
+static jbyteArray sha256Native(JNIEnv *env, jclass, jbyteArray data, jint offset, jint length) {
+    unsigned char digest[SC_SHA256_LENGTH];
+    sha256_ctx *ctx = sha256_init();
+    if (!ctx) return nullptr;
+    bool ok = true;
+    for (jint done = 0; ok && done < length;) {
+        jint n = length - done < CRC32_PIN_CHUNK ? length - done : CRC32_PIN_CHUNK;
+        unsigned char *bytes = (unsigned char *) env->GetPrimitiveArrayCritical(data, nullptr);
+        if (!bytes) {
+            ok = false;
+            break;
+        }
+        ok = sha256_update(ctx, bytes + offset + done, (size_t) n);
+        env->ReleasePrimitiveArrayCritical(data, bytes, JNI_ABORT);
+        done += n;
+    }
+    ok = sha256_final(ctx, digest) && ok;
+    return ok ? newDigest(env, digest) : nullptr;
 }
-JNIEXPORT jboolean JNICALL
-Java_com_securitycore_SecurityCoreModule_isRootedNative(JNIEnv *, jobject) {
-    return is_rooted() ? JNI_TRUE : JNI_FALSE;
+static jbyteArray sha256DirectNative(JNIEnv *env, jclass, jobject buffer, jint offset, jint length) {
+    unsigned char digest[SC_SHA256_LENGTH];
+    unsigned char *bytes = (unsigned char *) env->GetDirectBufferAddress(buffer);
+    if (!bytes) return nullptr;
+    sha256_digest(bytes + offset, (size_t) length, digest);
+    return newDigest(env, digest);
 }
+
+// File hashing reads the descriptor on the native side; -1 / null on error.
+static jlong crc32FdNative(JNIEnv *, jclass, jint fd) {
+    unsigned int crc;
+    return crc32_fd(fd, &crc) ? (jlong) crc : -1;
+}
+static jbyteArray sha256FdNative(JNIEnv *env, jclass, jint fd) {
+    unsigned char digest[SC_SHA256_LENGTH];
+    return sha256_fd(fd, digest) ? newDigest(env, digest) : nullptr;
+}
+
+// digests holds SC_SHA256_LENGTH bytes per path. Returns one sc_file_status
+// per path, or null if an argument is malformed.
+static jintArray verifyPackageFilesNative(JNIEnv *env, jobject, jobjectArray paths, jbyteArray digests,
+                                          jstring cachePath) {
+    jsize count = env->GetArrayLength(paths);
+    if (env->GetArrayLength(digests) != count * SC_SHA256_LENGTH) return nullptr;
+
+    std::vector<std::string> names(count);
+    for (jsize i = 0; i < count; ++i) {
+        jstring path = (jstring) env->GetObjectArrayElement(paths, i);
+        if (!path) return nullptr;
+        const char *chars = env->GetStringUTFChars(path, nullptr);
+        names[i] = chars;
+        env->ReleaseStringUTFChars(path, chars);
+        env->DeleteLocalRef(path);
+    }
+    std::vector<sc_file_digest> files(count);
+    for (jsize i = 0; i < count; ++i) {
+        files[i].path = names[i].c_str();
+        env->GetByteArrayRegion(digests, i * SC_SHA256_LENGTH, SC_SHA256_LENGTH, (jbyte *) files[i].sha256);
+    }
+    std::string cache;
+    if (cachePath) {
+        const char *chars = env->GetStringUTFChars(cachePath, nullptr);
+        cache = chars;
+        env->ReleaseStringUTFChars(cachePath, chars);
+    }
+
+    std::vector<sc_file_status> statuses(count);
+    verify_package_files(files.data(), files.size(), cachePath ? cache.c_str() : nullptr, statuses.data());
+
+    std::vector<jint> packed(statuses.begin(), statuses.end());
+    jintArray result = env->NewIntArray(count);
+    if (result) env->SetIntArrayRegion(result, 0, count, packed.data());
+    return result;
+}
+
+// ========== Signatures ==========
+// Revision of the newly active set, or -1 if the file was rejected.
+static jint loadSignaturesNative(JNIEnv *env, jobject, jstring path) {
+    const char *chars = env->GetStringUTFChars(path, nullptr);
+    bool loaded = security_core_load_signatures(chars);
+    env->ReleaseStringUTFChars(path, chars);
+    return loaded ? (jint) security_core_signature_revision() : -1;
+}
+static jint signatureRevisionNative(JNIEnv *, jobject) {
+    return (jint) security_core_signature_revision();
+}
+static jboolean isRootPackageNative(JNIEnv *env, jobject, jstring packageName) {
+    const char *chars = env->GetStringUTFChars(packageName, nullptr);
+    bool found = security_core_is_root_package(chars);
+    env->ReleaseStringUTFChars(packageName, chars);
+    return found ? JNI_TRUE : JNI_FALSE;
+}
+
+// ========== Background Monitor ==========
+static void startSelfHealNative(JNIEnv *, jobject) {
+    start_self_heal();
+}
+static void stopMonitorNative(JNIEnv *, jobject) {
+    security_core_monitor_stop();
+}
+static void pauseMonitorNative(JNIEnv *, jobject) {
+    security_core_monitor_pause();
+}
+static void resumeMonitorNative(JNIEnv *, jobject) {
+    security_core_monitor_resume();
+}
+
+// ========== Instrumentation ==========
+// Flattened sc_check_stats, SC_CHECK_COUNT records of STATS_STRIDE longs:
+// calls, detections, cache_hits, cancelled, timeouts, total_ns, max_ns,
+// then SC_STATS_BUCKETS latency buckets. Must match SecurityCoreModule.kt.
+static const int STATS_FIELDS = 7;
+static const int STATS_STRIDE = STATS_FIELDS + SC_STATS_BUCKETS;
+
+static jlongArray getStatsNative(JNIEnv *env, jobject) {
+    sc_check_stats stats[SC_CHECK_COUNT];
+    security_core_get_stats(stats);
+
+    jlong flat[SC_CHECK_COUNT * STATS_STRIDE];
+    for (int id = 0; id < SC_CHECK_COUNT; ++id) {
+        const sc_check_stats &s = stats[id];
+        jlong *out = flat + id * STATS_STRIDE;
+        out[0] = (jlong) s.calls;
+        out[1] = (jlong) s.detections;
+        out[2] = (jlong) s.cache_hits;
+        out[3] = (jlong) s.cancelled;
+        out[4] = (jlong) s.timeouts;
+        out[5] = (jlong) s.total_ns;
+        out[6] = (jlong) s.max_ns;
+        for (int b = 0; b < SC_STATS_BUCKETS; ++b) out[STATS_FIELDS + b] = (jlong) s.latency_buckets[b];
+    }
+    jlongArray result = env->NewLongArray(SC_CHECK_COUNT * STATS_STRIDE);
+    if (result) env->SetLongArrayRegion(result, 0, SC_CHECK_COUNT * STATS_STRIDE, flat);
+    return result;
+}
+static void resetStatsNative(JNIEnv *, jobject) {
+    security_core_reset_stats();
+}
+static jstring checkNameNative(JNIEnv *env, jobject, jint id) {
+    const char *name = security_core_check_name((sc_check_id) id);
+    return env->NewStringUTF(name ? name : "");
+}
+
+// ========== Registration ==========
+static bool critical_natives_supported() {
+    char sdk[PROP_VALUE_MAX];
+    return __system_property_get("ro.build.version.sdk", sdk) > 0 && atoi(sdk) >= 26;
+}
+
+extern "C" JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *) {
+    JNIEnv *env = nullptr;
+    if (vm->GetEnv((void **) &env, JNI_VERSION_1_6) != JNI_OK) return JNI_ERR;
+    jclass module = env->FindClass(MODULE_CLASS);
+    if (!module) return JNI_ERR;
+    java_vm = vm;
+    on_checks_done = env->GetMethodID(module, "onChecksDone", "(J[J)V");
+    if (!on_checks_done || pthread_key_create(&detach_key, detachThread) != 0) return JNI_ERR;
+
+    bool critical = critical_natives_supported();
+#define SC_DETECTOR_ENTRY(name) \
+    {(char *) #name "Native", (char *) "()Z", critical ? (void *) name##Critical : (void *) name##Regular}
+    const JNINativeMethod methods[] = {
+        SC_DETECTOR_ENTRY(checkProcessName),
+        {(char *) "detectDebuggerNative", (char *) "()Z", (void *) detectDebuggerNative},
+        {(char *) "detectFridaThreadNative", (char *) "()Z", (void *) detectFridaThreadNative},
+        {(char *) "detectMemoryMapsNative", (char *) "()Z", (void *) detectMemoryMapsNative},
+        {(char *) "verifyIntegrityNative", (char *) "()Z", (void *) verifyIntegrityNative},
+        {(char *) "submitChecksNative", (char *) "(IIZJ)V", (void *) submitChecksNative},
+        {(char *) "xorDecodeNative", (char *) "(Ljava/lang/String;C)Ljava/lang/String;", (void *) xorDecodeNative},
+        {(char *) "crc32Native", (char *) "([BII)I", (void *) crc32Native},
+        {(char *) "crc32DirectNative", (char *) "(Ljava/nio/ByteBuffer;II)I", (void *) crc32DirectNative},
+        {(char *) "sha256Native", (char *) "([BII)[B", (void *) sha256Native},
+        {(char *) "sha256DirectNative", (char *) "(Ljava/nio/ByteBuffer;II)[B", (void *) sha256DirectNative},
+        {(char *) "crc32FdNative", (char *) "(I)J", (void *) crc32FdNative},
+        {(char *) "sha256FdNative", (char *) "(I)[B", (void *) sha256FdNative},
+        {(char *) "verifyPackageFilesNative", (char *) "([Ljava/lang/String;[BLjava/lang/String;)[I",
+         (void *) verifyPackageFilesNative},
+        {(char *) "loadSignaturesNative", (char *) "(Ljava/lang/String;)I", (void *) loadSignaturesNative},
+        {(char *) "signatureRevisionNative", (char *) "()I", (void *) signatureRevisionNative},
+        {(char *) "isRootPackageNative", (char *) "(Ljava/lang/String;)Z", (void *) isRootPackageNative},
+        {(char *) "startSelfHealNative", (char *) "()V", (void *) startSelfHealNative},
+        {(char *) "stopMonitorNative", (char *) "()V", (void *) stopMonitorNative},
+        {(char *) "pauseMonitorNative", (char *) "()V", (void *) pauseMonitorNative},
+        {(char *) "resumeMonitorNative", (char *) "()V", (void *) resumeMonitorNative},
+        {(char *) "getStatsNative", (char *) "()[J", (void *) getStatsNative},
+        {(char *) "resetStatsNative", (char *) "()V", (void *) resetStatsNative},
+        {(char *) "checkNameNative", (char *) "(I)Ljava/lang/String;", (void *) checkNameNative},
+    };
+#undef SC_DETECTOR_ENTRY
+
+    jint rc = env->RegisterNatives(module, methods, sizeof(methods) / sizeof(methods[0]));
+    env->DeleteLocalRef(module);
+    return rc == JNI_OK ? JNI_VERSION_1_6 : JNI_ERR;
 }
@@ -1,26 +1,141 @@
 package com.securitycore
 
+import android.os.ParcelFileDescriptor
+import com.facebook.proguard.annotations.DoNotStrip
 import com.facebook.react.bridge.*
 import com.facebook.react.modules.core.DeviceEventManagerModule
+import dalvik.annotation.optimization.CriticalNative
+import dalvik.annotation.optimization.FastNative
+import java.io.File
+import java.nio.ByteBuffer
+import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.atomic.AtomicLong
 
-class SecurityCoreModule(reactContext: ReactApplicationContext) : ReactContextBaseJavaModule(reactContext) {
+class SecurityCoreModule(reactContext: ReactApplicationContext) : ReactContextBaseJavaModule(reactContext),
+    LifecycleEventListener {
 
     companion object {
         private const val MODULE_NAME = "SecurityCore"
+        // Layout of getStatsNative(); must match SecurityCoreJNI.cpp
+        private const val STATS_FIELDS = 7
+        private const val STATS_BUCKETS = 32
+        private const val STATS_STRIDE = STATS_FIELDS + STATS_BUCKETS
+        // Layout of onChecksDone(); must match SecurityCoreJNI.cpp
+        private const val RUN_MASKS = 4
+        // SC_ADVANCED_CHECKS_MASK and SC_ROOT_CHECKS_MASK; must match SecurityCore.h
+        private const val ADVANCED_CHECKS_MASK = 0x1F
+        private const val ROOT_CHECKS_MASK = 0x3FE7
+        private const val SHA256_LENGTH = 32
+        private const val FILE_CACHE_NAME = "security_core_files.cache"
         init {
             System.loadLibrary("SecurityCoreJNI")
         }
+
+        // Short single-check detector: a plain C call with no JNI
+        // transition (ignored before API 26, where it is a normal native)
+        @JvmStatic @CriticalNative private external fun checkProcessNameNative(): Boolean
+        // These can read or scan /proc or wait on the worker pool, so they
+        // must not be critical natives
+        @JvmStatic private external fun detectDebuggerNative(): Boolean
+        @JvmStatic private external fun detectFridaThreadNative(): Boolean
+        @JvmStatic private external fun detectMemoryMapsNative(): Boolean
+        @JvmStatic private external fun verifyIntegrityNative(): Boolean
+
+        // Hashing: arrays are pinned, direct buffers and files are read in
+        // place by the native side
+        @JvmStatic private external fun crc32Native(data: ByteArray, offset: Int, length: Int): Int
+        @JvmStatic private external fun crc32DirectNative(buffer: ByteBuffer, offset: Int, length: Int): Int
+        @JvmStatic private external fun sha256Native(data: ByteArray, offset: Int, length: Int): ByteArray?
+        @JvmStatic private external fun sha256DirectNative(buffer: ByteBuffer, offset: Int, length: Int): ByteArray?
+        @JvmStatic private external fun crc32FdNative(fd: Int): Long
+        @JvmStatic private external fun sha256FdNative(fd: Int): ByteArray?
+
+        /** CRC32 of the buffer's remaining bytes; its position is not moved. */
+        @JvmStatic
+        fun crc32(buffer: ByteBuffer): Long {
+            val crc = when {
+                buffer.isDirect -> crc32DirectNative(buffer, buffer.position(), buffer.remaining())
+                buffer.hasArray() -> crc32Native(buffer.array(), buffer.arrayOffset() + buffer.position(), buffer.remaining())
+                else -> copyRemaining(buffer).let { crc32Native(it, 0, it.size) }
+            }
+            return crc.toLong() and 0xFFFFFFFFL
+        }
+
+        /** SHA-256 of the buffer's remaining bytes; its position is not moved. */
+        @JvmStatic
+        fun sha256(buffer: ByteBuffer): ByteArray {
+            val digest = when {
+                buffer.isDirect -> sha256DirectNative(buffer, buffer.position(), buffer.remaining())
+                buffer.hasArray() -> sha256Native(buffer.array(), buffer.arrayOffset() + buffer.position(), buffer.remaining())
+                else -> copyRemaining(buffer).let { sha256Native(it, 0, it.size) }
+            }
+            return digest ?: throw IllegalStateException("sha256 failed")
+        }
+
+        // Read-only heap buffers expose no array
+        private fun copyRemaining(buffer: ByteBuffer): ByteArray {
+            val bytes = ByteArray(buffer.remaining())
+            buffer.duplicate().get(bytes)
+            return bytes
+        }
+
+        private fun openFile(path: String): ParcelFileDescriptor =
+            ParcelFileDescriptor.open(File(path.removePrefix("file://")), ParcelFileDescriptor.MODE_READ_ONLY)
+
+        private fun toHex(bytes: ByteArray): String = bytes.joinToString("") { "%02x".format(it) }
+
+        private fun parseHex(hex: String, out: ByteArray, at: Int) {
+            require(hex.length == SHA256_LENGTH * 2) { "sha256 must be ${SHA256_LENGTH * 2} hex digits" }
+            for (i in 0 until SHA256_LENGTH) {
+                out[at + i] = hex.substring(i * 2, i * 2 + 2).toInt(16).toByte()
+            }
+        }
+    }
+
+    // Scans submitted to the native executor, by request id
+    private val pendingChecks = ConcurrentHashMap<Long, (LongArray) -> Unit>()
+    private val nextCheckRequest = AtomicLong()
+
+    init {
+        reactContext.addLifecycleEventListener(this)
     }
 
     override fun getName(): String = MODULE_NAME
 
+    // Background monitors sleep while the app is in the background
+    override fun onHostPause() {
+        pauseMonitorNative()
+    }
+
+    override fun onHostResume() {
+        resumeMonitorNative()
+    }
+
+    override fun onHostDestroy() {
+        stopMonitorNative()
+    }
+
     // ========== Android Security Functions ==========
 
+    // Scans run on the native executor; the promise is resolved from its
+    // completion callback instead of holding the bridge thread
+
+    private fun submitChecks(mask: Int, deadlineMs: Int, stopOnDetect: Boolean, onDone: (LongArray) -> Unit) {
+        val request = nextCheckRequest.incrementAndGet()
+        pendingChecks[request] = onDone
+        submitChecksNative(mask, deadlineMs, stopOnDetect, request)
+    }
+
+    // Called by SecurityCoreJNI.cpp on a native worker thread
+    @DoNotStrip
+    private fun onChecksDone(request: Long, raw: LongArray) {
+        pendingChecks.remove(request)?.invoke(raw)
+    }
+
     @ReactMethod
     fun runAdvancedChecks(promise: Promise) {
         try {
-            val result = runAdvancedChecksNative()
-            promise.resolve(result)
+            submitChecks(ADVANCED_CHECKS_MASK, 0, true) { raw -> promise.resolve(raw[0] == 0L) }
         } catch (e: Exception) {
             promise.reject("ERROR", e.message)
         }
@@ -76,11 +191,33 @@ class SecurityCoreModule(reactContext: ReactApplicationContext) : ReactContextBa
         }
     }
 
+    // All selected checks in one native call; see onChecksDone()
+    @ReactMethod
+    fun runAllChecks(mask: Int, deadlineMs: Int, stopOnDetect: Boolean, promise: Promise) {
+        try {
+            submitChecks(mask, deadlineMs, stopOnDetect) { raw ->
+                val result = Arguments.createMap()
+                result.putBoolean("detected", raw[0] != 0L)
+                result.putInt("detectedMask", raw[0].toInt())
+                result.putInt("cleanMask", raw[1].toInt())
+                result.putInt("cancelledMask", raw[2].toInt())
+                result.putInt("timedOutMask", raw[3].toInt())
+                val elapsed = Arguments.createArray()
+                for (i in RUN_MASKS until raw.size) {
+                    elapsed.pushDouble(raw[i].toDouble())
+                }
+                result.putArray("elapsedUs", elapsed)
+                promise.resolve(result)
+            }
+        } catch (e: Exception) {
+            promise.reject("ERROR", e.message)
+        }
+    }
+
     @ReactMethod
     fun isRooted(promise: Promise) {
         try {
-            val result = isRootedNative()
-            promise.resolve(result)
+            submitChecks(ROOT_CHECKS_MASK, 0, true) { raw -> promise.resolve(raw[0] != 0L) }
         } catch (e: Exception) {
             promise.reject("ERROR", e.message)
         }
@@ -173,26 +310,216 @@ class SecurityCoreModule(reactContext: ReactApplicationContext) : ReactContextBa
     @ReactMethod
     fun crc32(data: ReadableArray, promise: Promise) {
         try {
-            val bytes = ByteArray(data.size())
-            for (i in 0 until data.size()) {
-                bytes[i] = data.getInt(i).toByte()
+            val bytes = toByteArray(data)
+            val result = crc32Native(bytes, 0, bytes.size)
+            promise.resolve(result)
+        } catch (e: Exception) {
+            promise.reject("ERROR", e.message)
+        }
+    }
+
+    @ReactMethod
+    fun sha256(data: ReadableArray, promise: Promise) {
+        try {
+            val bytes = toByteArray(data)
+            promise.resolve(toHex(sha256Native(bytes, 0, bytes.size) ?: throw IllegalStateException("sha256 failed")))
+        } catch (e: Exception) {
+            promise.reject("ERROR", e.message)
+        }
+    }
+
+    // File checksums never bring the contents into the JS or Java heap: the
+    // native side mmaps or reads the descriptor directly
+    @ReactMethod
+    fun crc32File(path: String, promise: Promise) {
+        try {
+            val crc = openFile(path).use { crc32FdNative(it.fd) }
+            if (crc < 0) throw IllegalStateException("cannot read $path")
+            promise.resolve(crc.toDouble())
+        } catch (e: Exception) {
+            promise.reject("ERROR", e.message)
+        }
+    }
+
+    @ReactMethod
+    fun sha256File(path: String, promise: Promise) {
+        try {
+            val digest = openFile(path).use { sha256FdNative(it.fd) } ?: throw IllegalStateException("cannot read $path")
+            promise.resolve(toHex(digest))
+        } catch (e: Exception) {
+            promise.reject("ERROR", e.message)
+        }
+    }
+
+    // files: [{ path, sha256 }]. Relative paths are resolved against the
+    // app's native library directory. cachePath null uses the module's cache
+    // in noBackupFilesDir; "" disables the cache
+    @ReactMethod
+    fun verifyPackageFiles(files: ReadableArray, cachePath: String?, promise: Promise) {
+        try {
+            val libDir = reactApplicationContext.applicationInfo.nativeLibraryDir
+            val paths = Array(files.size()) { "" }
+            val digests = ByteArray(files.size() * SHA256_LENGTH)
+            for (i in 0 until files.size()) {
+                val entry = files.getMap(i) ?: throw IllegalArgumentException("files[$i] is null")
+                val path = (entry.getString("path") ?: "").removePrefix("file://")
+                paths[i] = if (path.startsWith("/")) path else File(libDir, path).path
+                parseHex(entry.getString("sha256") ?: "", digests, i * SHA256_LENGTH)
+            }
+            val cache = when {
+                cachePath == null -> File(reactApplicationContext.noBackupFilesDir, FILE_CACHE_NAME).path
+                cachePath.isEmpty() -> null
+                else -> cachePath.removePrefix("file://")
+            }
+            val statuses = verifyPackageFilesNative(paths, digests, cache)
+                ?: throw IllegalStateException("verification failed")
+            val result = Arguments.createMap()
+            val list = Arguments.createArray()
+            var verified = true
+            for (status in statuses) {
+                list.pushInt(status)
+                // SC_FILE_VERIFIED, SC_FILE_CACHED
+                if (status > 1) verified = false
+            }
+            result.putBoolean("verified", verified)
+            result.putArray("statuses", list)
+            promise.resolve(result)
+        } catch (e: Exception) {
+            promise.reject("ERROR", e.message)
+        }
+    }
+
+    // ========== Signatures ==========
+
+    // Replace the active signature set with an image built by
+    // SecurityCoreSigGen; resolves its revision. Write updates to a new file
+    // and rename it into place rather than rewriting the loaded one.
+    @ReactMethod
+    fun loadSignatures(path: String, promise: Promise) {
+        try {
+            val revision = loadSignaturesNative(path.removePrefix("file://"))
+            if (revision < 0) {
+                promise.reject("ERROR", "signature file rejected: $path")
+            } else {
+                promise.resolve(revision)
+            }
+        } catch (e: Exception) {
+            promise.reject("ERROR", e.message)
+        }
+    }
+
+    @ReactMethod
+    fun getSignatureRevision(promise: Promise) {
+        try {
+            promise.resolve(signatureRevisionNative())
+        } catch (e: Exception) {
+            promise.reject("ERROR", e.message)
+        }
+    }
+
+    // Installed packages matching the root package signatures. Since Android
+    // 11 only packages visible to the app (<queries>) are listed.
+    @ReactMethod
+    fun findRootPackages(promise: Promise) {
+        try {
+            @Suppress("DEPRECATION")
+            val installed = reactApplicationContext.packageManager.getInstalledApplications(0)
+            val found = Arguments.createArray()
+            for (info in installed) {
+                if (isRootPackageNative(info.packageName)) found.pushString(info.packageName)
+            }
+            promise.resolve(found)
+        } catch (e: Exception) {
+            promise.reject("ERROR", e.message)
+        }
+    }
+
+    private fun toByteArray(data: ReadableArray): ByteArray {
+        val bytes = ByteArray(data.size())
+        for (i in 0 until data.size()) {
+            bytes[i] = data.getInt(i).toByte()
+        }
+        return bytes
+    }
+
+    // ========== Background Monitor ==========
+
+    @ReactMethod
+    fun startSelfHeal(promise: Promise) {
+        try {
+            startSelfHealNative()
+            promise.resolve(true)
+        } catch (e: Exception) {
+            promise.reject("ERROR", e.message)
+        }
+    }
+
+    @ReactMethod
+    fun stopMonitor(promise: Promise) {
+        try {
+            stopMonitorNative()
+            promise.resolve(null)
+        } catch (e: Exception) {
+            promise.reject("ERROR", e.message)
+        }
+    }
+
+    // ========== Instrumentation ==========
+
+    @ReactMethod
+    fun getStats(promise: Promise) {
+        try {
+            val raw = getStatsNative()
+            val result = Arguments.createArray()
+            for (id in 0 until raw.size / STATS_STRIDE) {
+                val base = id * STATS_STRIDE
+                val entry = Arguments.createMap()
+                entry.putInt("id", id)
+                entry.putString("name", checkNameNative(id))
+                entry.putDouble("calls", raw[base].toDouble())
+                entry.putDouble("detections", raw[base + 1].toDouble())
+                entry.putDouble("cacheHits", raw[base + 2].toDouble())
+                entry.putDouble("cancelled", raw[base + 3].toDouble())
+                entry.putDouble("timeouts", raw[base + 4].toDouble())
+                entry.putDouble("totalNs", raw[base + 5].toDouble())
+                entry.putDouble("maxNs", raw[base + 6].toDouble())
+                val buckets = Arguments.createArray()
+                for (b in 0 until STATS_BUCKETS) {
+                    buckets.pushDouble(raw[base + STATS_FIELDS + b].toDouble())
+                }
+                entry.putArray("latencyBuckets", buckets)
+                result.pushMap(entry)
             }
-            val result = crc32Native(bytes)
             promise.resolve(result)
         } catch (e: Exception) {
             promise.reject("ERROR", e.message)
         }
     }
 
+    @ReactMethod
+    fun resetStats(promise: Promise) {
+        try {
+            resetStatsNative()
+            promise.resolve(null)
+        } catch (e: Exception) {
+            promise.reject("ERROR", e.message)
+        }
+    }
+
     // ========== Native Functions ==========
+    // Registered in JNI_OnLoad; the detectors and hashing are in the companion object
 
-    private external fun runAdvancedChecksNative(): Boolean
-    private external fun detectDebuggerNative(): Boolean
-    private external fun detectFridaThreadNative(): Boolean
-    private external fun detectMemoryMapsNative(): Boolean
-    private external fun checkProcessNameNative(): Boolean
-    private external fun verifyIntegrityNative(): Boolean
-    private external fun xorDecodeNative(encoded: String, key: Char): String
-    private external fun crc32Native(data: ByteArray): Int
-    private external fun isRootedNative(): Boolean
+    @FastNative private external fun xorDecodeNative(encoded: String, key: Char): String
+    private external fun submitChecksNative(mask: Int, deadlineMs: Int, stopOnDetect: Boolean, request: Long)
+    private external fun verifyPackageFilesNative(paths: Array<String>, digests: ByteArray, cachePath: String?): IntArray?
+    private external fun loadSignaturesNative(path: String): Int
+    private external fun signatureRevisionNative(): Int
+    private external fun isRootPackageNative(packageName: String): Boolean
+    private external fun startSelfHealNative()
+    private external fun stopMonitorNative()
+    private external fun pauseMonitorNative()
+    private external fun resumeMonitorNative()
+    private external fun getStatsNative(): LongArray
+    private external fun resetStatsNative()
+    @FastNative private external fun checkNameNative(id: Int): String
 }
@@ -0,0 +1,343 @@
+// ========== SecurityCoreBench ==========
+// Latency distributions for every exported detector and utility, plus
+// crc32 / xor_decode / WebSocket masking throughput across buffer sizes.
+//
+// By default the detectors read the real /proc/self and filesystem. With
+// --maps / --threads a synthetic procfs tree is generated and the procfs
+// layer is pointed at it; --path-hits creates that many indicator paths
+// under a fixture root for the path prober.
+//
+//   SecurityCoreBench --maps 5000 --threads 500 --iterations 2000
+
+#include "SecurityCore.h"
+#include "path_prober.h"
+#include "procfs_reader.h"
+#include "root_checker.h"
+#include "sig_db.h"
+#include "ws_frame_codec.h"
+
+#include <algorithm>
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <functional>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct Options {
+    unsigned int iterations = 1000;
+    unsigned int maps = 0;         // 0 = real /proc/self
+    unsigned int threads = 0;
+    unsigned int pathHits = 0;     // indicator paths created under the fixture root
+    bool fridaHit = false;         // plant Frida signatures in the fixtures
+    bool cached = false;           // keep the result cache enabled
+    bool keepFixtures = false;
+    std::string fixtureDir;
+    std::string filter;
+};
+
+uint64_t now_ns() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ========== Fixtures ==========
+bool make_dirs(const std::string& path) {
+    for (size_t i = 1; i <= path.size(); ++i) {
+        if (i == path.size() || path[i] == '/') {
+            std::string prefix = path.substr(0, i);
+            if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) return false;
+        }
+    }
+    return true;
+}
+
+bool write_file(const std::string& path, const std::string& content) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(content.data(), 1, content.size(), f) == content.size();
+    return fclose(f) == 0 && ok;
+}
+
+bool build_procfs_fixture(const Options& opt, const std::string& root) {
+    if (!make_dirs(root + "/task")) return false;
+
+    std::string maps;
+    char line[256];
+    for (unsigned int i = 0; i < opt.maps; ++i) {
+        unsigned long long start = 0x7f0000000000ULL + (unsigned long long)i * 0x10000;
+        snprintf(line, sizeof(line), "%llx-%llx r-xp 00000000 fd:01 %u                      /system/lib64/libbench_%u.so\n",
+                 start, start + 0x10000, 100000 + i, i);
+        maps += line;
+    }
+    if (opt.fridaHit) maps += "7fff00000000-7fff00010000 r-xp 00000000 fd:01 1 /data/local/tmp/frida-agent-64.so\n";
+
+    std::string mounts = "/dev/block/dm-0 /system ext4 ro,seclabel,relatime 0 0\n"
+                         "tmpfs /dev tmpfs rw,seclabel,nosuid,relatime 0 0\n";
+    std::string cmdline("com.app.trusted\0", 16);
+    snprintf(line, sizeof(line), "%u 1024 512 16 0 2048 0\n", 65536 + opt.maps * 16);
+
+    bool ok = write_file(root + "/maps", maps) &&
+              write_file(root + "/status", "Name:\tbench\nState:\tR (running)\nTracerPid:\t0\n") &&
+              write_file(root + "/mounts", mounts) &&
+              write_file(root + "/cmdline", cmdline) &&
+              write_file(root + "/statm", line);
+
+    unsigned int threads = std::max(1u, opt.threads);
+    for (unsigned int i = 0; ok && i < threads; ++i) {
+        std::string dir = root + "/task/" + std::to_string(10000 + i);
+        bool frida = opt.fridaHit && i == threads - 1;
+        ok = make_dirs(dir) && write_file(dir + "/comm", frida ? "gum-js-loop\n" : "worker-" + std::to_string(i) + "\n");
+    }
+    return ok;
+}
+
+bool build_path_fixture(const Options& opt, const std::string& root) {
+    if (!make_dirs(root)) return false;
+    std::shared_ptr<const SigDb> db = sig_db_active();
+    for (unsigned int i = 0; i < opt.pathHits && i < db->count(SIG_PATHS); ++i) {
+        const char* path = db->string(SIG_PATHS, i);
+        std::string full = root + path;
+        if (full.back() == '/') full.pop_back();
+        size_t slash = full.rfind('/');
+        if (!make_dirs(full.substr(0, slash)) || !write_file(full, "")) return false;
+    }
+    return true;
+}
+
+void remove_tree(const std::string& path) {
+    std::string cmd = "rm -rf '" + path + "'";
+    if (system(cmd.c_str()) != 0) fprintf(stderr, "could not remove %s\n", path.c_str());
+}
+
+// ========== Latency ==========
+void print_latency_header() {
+    printf("%-34s %10s %10s %10s %10s %10s %10s\n", "function", "min(us)", "p50", "p90", "p99", "max", "mean");
+}
+
+void bench_latency(const Options& opt, const char* name, const std::function<void()>& fn) {
+    if (!opt.filter.empty() && strstr(name, opt.filter.c_str()) == NULL) return;
+
+    // Detectors log through stdout on desktop; keep it out of the table.
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int devnull = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if (devnull >= 0) dup2(devnull, STDOUT_FILENO);
+
+    std::vector<uint64_t> samples(opt.iterations);
+    fn();  // warm up descriptors, matchers and the pool
+    for (unsigned int i = 0; i < opt.iterations; ++i) {
+        if (!opt.cached) security_core_invalidate_cache();
+        uint64_t start = now_ns();
+        fn();
+        samples[i] = now_ns() - start;
+    }
+
+    fflush(stdout);
+    if (saved >= 0) {
+        dup2(saved, STDOUT_FILENO);
+        close(saved);
+    }
+    if (devnull >= 0) close(devnull);
+    std::sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (uint64_t s : samples) sum += (double)s;
+    size_t n = samples.size();
+    printf("%-34s %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f\n", name,
+           samples[0] / 1e3, samples[n / 2] / 1e3, samples[n * 9 / 10] / 1e3,
+           samples[std::min(n - 1, n * 99 / 100)] / 1e3, samples[n - 1] / 1e3, sum / n / 1e3);
+}
+
+// ========== Throughput ==========
+void bench_throughput(const Options& opt, const char* name, size_t size,
+                      const std::function<void()>& fn) {
+    if (!opt.filter.empty() && strstr(name, opt.filter.c_str()) == NULL) return;
+
+    // Enough repetitions for ~64 MiB per sample, at least 3.
+    unsigned int reps = (unsigned int)std::max<size_t>(3, (64u << 20) / size);
+    reps = std::min(reps, 100000u);
+    std::vector<double> rates;
+    for (int sample = 0; sample < 5; ++sample) {
+        uint64_t start = now_ns();
+        for (unsigned int i = 0; i < reps; ++i) fn();
+        uint64_t elapsed = std::max<uint64_t>(1, now_ns() - start);
+        rates.push_back((double)size * reps / (elapsed / 1e9) / (1 << 20));
+    }
+    std::sort(rates.begin(), rates.end());
+    printf("%-22s %10zu %12.1f\n", name, size, rates[rates.size() / 2]);
+}
+
+volatile unsigned int sink;
+
+void run_throughput(const Options& opt) {
+    static const size_t sizes[] = {64, 1024, 16 * 1024, 256 * 1024, 4 * 1024 * 1024};
+    std::vector<unsigned char> data(sizes[4] + 1);
+    for (size_t i = 0; i < data.size(); ++i) data[i] = (unsigned char)(i * 131 + 7) | 1;  // no NUL for xor_decode
+    std::vector<char> out(data.size());
+
+    printf("\n%-22s %10s %12s\n", "throughput", "bytes", "MiB/s");
+    for (size_t size : sizes) {
+        bench_throughput(opt, "crc32", size, [&] { sink = sc_crc32(data.data(), size); });
+    }
+    for (size_t size : sizes) {
+        bench_throughput(opt, "crc32_ctx (4 KiB)", size, [&] {
+            crc32_ctx ctx;
+            crc32_init(&ctx);
+            for (size_t off = 0; off < size; off += 4096) {
+                crc32_update(&ctx, data.data() + off, std::min<size_t>(4096, size - off));
+            }
+            sink = crc32_final(&ctx);
+        });
+    }
+    for (size_t size : sizes) {
+        bench_throughput(opt, "crc32_parallel", size, [&] { sink = crc32_parallel(data.data(), size, 0); });
+    }
+    for (size_t size : sizes) {
+        unsigned char saved = data[size];
+        data[size] = 0;
+        bench_throughput(opt, "xor_decode", size, [&] { sink = (unsigned char)xor_decode((const char*)data.data(), 0x5A)[0]; });
+        bench_throughput(opt, "xor_decode_r", size, [&] {
+            sink = (unsigned int)xor_decode_r((const char*)data.data(), 0x5A, out.data(), out.size());
+        });
+        data[size] = saved;
+    }
+    static const uint8_t key[4] = {0x37, 0xFA, 0x21, 0x3D};
+    uint32_t key32;
+    memcpy(&key32, key, sizeof(key32));
+    for (int k = 0; k < WS_MASK_KERNEL_COUNT; ++k) {
+        ws_mask_kernel_fn fn = ws_mask_kernel((WsMaskKernel)k);
+        if (!fn) continue;
+        std::string name = std::string("ws_mask ") + ws_mask_kernel_name((WsMaskKernel)k);
+        for (size_t size : sizes) {
+            bench_throughput(opt, name.c_str(), size, [&] { fn((uint8_t*)out.data(), data.data(), size, key32); });
+        }
+    }
+}
+
+void run_latency(const Options& opt) {
+    sc_check_result results[SC_CHECK_COUNT];
+    printf("\n");
+    print_latency_header();
+
+    // SecurityCore.h
+    bench_latency(opt, "detect_debugger", [] { sink = detect_debugger(); });
+    bench_latency(opt, "detect_frida_thread", [] { sink = detect_frida_thread(); });
+    bench_latency(opt, "detect_memory_maps", [] { sink = detect_memory_maps(); });
+    bench_latency(opt, "check_process_name", [] { sink = check_process_name(); });
+    bench_latency(opt, "verify_integrity", [] { sink = verify_integrity(); });
+    bench_latency(opt, "verify_integrity_hot(8)", [] { sink = verify_integrity_hot(8); });
+    bench_latency(opt, "run_ios_anti_frida", [] { sink = run_ios_anti_frida(); });
+    bench_latency(opt, "run_ios_security_checks", [] { sink = run_ios_security_checks(); });
+    bench_latency(opt, "is_rooted", [] { sink = is_rooted(); });
+    bench_latency(opt, "is_rooted_ex", [&] { sink = is_rooted_ex(0, results); });
+
+    bench_latency(opt, "run_checks(advanced)", [&] { sink = run_checks(SC_ADVANCED_CHECKS_MASK, 0, false, results); });
+    bench_latency(opt, "run_checks(advanced, stop)", [&] { sink = run_checks(SC_ADVANCED_CHECKS_MASK, 0, true, results); });
+    bench_latency(opt, "run_advanced_checks", [] { sink = run_advanced_checks(); });
+    bench_latency(opt, "run_advanced_checks_ex", [&] { sink = run_advanced_checks_ex(0, results); });
+
+    // Frida detectors
+    bench_latency(opt, "detect_frida_env", [] { sink = detect_frida_env(); });
+    bench_latency(opt, "detect_frida_files", [] { sink = detect_frida_files(); });
+    bench_latency(opt, "detect_frida_symbols", [] { sink = detect_frida_symbols(); });
+    bench_latency(opt, "detect_code_injection", [] { sink = detect_code_injection(); });
+
+    // Internal layers the detectors sit on
+    bench_latency(opt, "probe_indicator_paths(all)", [] { sink = probe_indicator_paths(INDICATOR_ALL); });
+    bench_latency(opt, "detect_rw_system_mount", [] { sink = detect_rw_system_mount(); });
+}
+
+void usage(const char* argv0) {
+    printf("usage: %s [options]\n"
+           "  --iterations N   samples per latency benchmark (default 1000)\n"
+           "  --maps N         synthetic /proc/self/maps with N mappings\n"
+           "  --threads N      synthetic /proc/self/task with N threads\n"
+           "  --path-hits N    create the first N indicator paths under the fixture root\n"
+           "  --frida          plant Frida signatures in the synthetic procfs\n"
+           "  --fixture-dir D  where to generate fixtures (default: mkdtemp in $TMPDIR)\n"
+           "  --keep-fixtures  do not delete generated fixtures\n"
+           "  --cached         keep the result cache enabled between samples\n"
+           "  --filter S       only run benchmarks whose name contains S\n"
+           "  --no-latency / --no-throughput\n", argv0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    bool latency = true, throughput = true;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--iterations" && hasValue) opt.iterations = std::max(1, atoi(argv[++i]));
+        else if (arg == "--maps" && hasValue) opt.maps = (unsigned int)atoi(argv[++i]);
+        else if (arg == "--threads" && hasValue) opt.threads = (unsigned int)atoi(argv[++i]);
+        else if (arg == "--path-hits" && hasValue) opt.pathHits = (unsigned int)atoi(argv[++i]);
+        else if (arg == "--fixture-dir" && hasValue) opt.fixtureDir = argv[++i];
+        else if (arg == "--filter" && hasValue) opt.filter = argv[++i];
+        else if (arg == "--frida") opt.fridaHit = true;
+        else if (arg == "--keep-fixtures") opt.keepFixtures = true;
+        else if (arg == "--cached") opt.cached = true;
+        else if (arg == "--no-latency") latency = false;
+        else if (arg == "--no-throughput") throughput = false;
+        else {
+            usage(argv[0]);
+            return arg == "--help" || arg == "-h" ? 0 : 2;
+        }
+    }
+
+    bool useProcfsFixture = opt.maps > 0 || opt.threads > 0;
+    bool usePathFixture = opt.pathHits > 0;
+    bool generated = false;
+    if ((useProcfsFixture || usePathFixture) && opt.fixtureDir.empty()) {
+        const char* tmp = getenv("TMPDIR");
+        std::string templ = std::string(tmp ? tmp : "/tmp") + "/SecurityCoreBench.XXXXXX";
+        std::vector<char> buf(templ.begin(), templ.end());
+        buf.push_back('\0');
+        if (!mkdtemp(buf.data())) {
+            perror("mkdtemp");
+            return 1;
+        }
+        opt.fixtureDir = buf.data();
+        generated = true;
+    }
+
+    if (useProcfsFixture) {
+        std::string root = opt.fixtureDir + "/proc";
+        if (!build_procfs_fixture(opt, root)) {
+            fprintf(stderr, "failed to build procfs fixture in %s\n", root.c_str());
+            return 1;
+        }
+        procfs_set_root(root.c_str());
+    }
+    if (usePathFixture) {
+        std::string root = opt.fixtureDir + "/fs";
+        if (!build_path_fixture(opt, root)) {
+            fprintf(stderr, "failed to build path fixture in %s\n", root.c_str());
+            return 1;
+        }
+        PathProber::setRoot(root.c_str());
+    }
+
+    printf("SecurityCoreBench: %u iterations, procfs=%s, paths=%s, cache=%s\n", opt.iterations,
+           useProcfsFixture ? (std::to_string(opt.maps) + " maps / " + std::to_string(std::max(1u, opt.threads)) + " threads").c_str() : "/proc/self",
+           usePathFixture ? (std::to_string(opt.pathHits) + " hits").c_str() : "/",
+           opt.cached ? "on" : "off");
+
+    if (latency) run_latency(opt);
+    if (throughput) run_throughput(opt);
+
+    procfs_set_root(nullptr);
+    PathProber::setRoot(nullptr);
+    if (generated && !opt.keepFixtures) remove_tree(opt.fixtureDir);
+    else if (!opt.fixtureDir.empty()) printf("\nfixtures: %s\n", opt.fixtureDir.c_str());
+    return 0;
+}
@@ -7,9 +7,161 @@
 extern "C" {
 #endif
 
+// The library is built with hidden visibility; only this API is exported.
+#pragma GCC visibility push(default)
+
+// ========== Check Scheduler ==========
+// Every probe behind run_advanced_checks() and is_rooted() has an id, so
+// callers can select checks with a mask and get a result per check.
+typedef enum {
+    SC_CHECK_DEBUGGER = 0,
+    SC_CHECK_FRIDA_THREAD,
+    SC_CHECK_MEMORY_MAPS,
+    SC_CHECK_PROCESS_NAME,
+    SC_CHECK_INTEGRITY,
+    SC_CHECK_ROOT_PATHS,
+    SC_CHECK_SYSTEM_PROPS,
+    SC_CHECK_RW_SYSTEM_MOUNT,
+    SC_CHECK_FRIDA_SERVER,
+    SC_CHECK_JAILBREAK_PATHS,
+    SC_CHECK_SANDBOX_ESCAPE,
+    SC_CHECK_FRIDA_SYMBOLS,
+    SC_CHECK_FRIDA_ENV,
+    SC_CHECK_FRIDA_FILES,
+    SC_CHECK_COUNT
+} sc_check_id;
+
+#define SC_CHECK_BIT(id) (1u << (id))
+
+// Checks run by run_advanced_checks()
+#define SC_ADVANCED_CHECKS_MASK                                                     \
+    (SC_CHECK_BIT(SC_CHECK_DEBUGGER) | SC_CHECK_BIT(SC_CHECK_FRIDA_THREAD) |        \
+     SC_CHECK_BIT(SC_CHECK_MEMORY_MAPS) | SC_CHECK_BIT(SC_CHECK_PROCESS_NAME) |     \
+     SC_CHECK_BIT(SC_CHECK_INTEGRITY))
+
+// Checks run by is_rooted(); ids that do not apply to the platform are skipped
+#define SC_ROOT_CHECKS_MASK                                                         \
+    (SC_CHECK_BIT(SC_CHECK_ROOT_PATHS) | SC_CHECK_BIT(SC_CHECK_SYSTEM_PROPS) |      \
+     SC_CHECK_BIT(SC_CHECK_RW_SYSTEM_MOUNT) | SC_CHECK_BIT(SC_CHECK_FRIDA_THREAD) | \
+     SC_CHECK_BIT(SC_CHECK_MEMORY_MAPS) | SC_CHECK_BIT(SC_CHECK_FRIDA_SERVER) |     \
+     SC_CHECK_BIT(SC_CHECK_JAILBREAK_PATHS) | SC_CHECK_BIT(SC_CHECK_SANDBOX_ESCAPE) | \
+     SC_CHECK_BIT(SC_CHECK_FRIDA_SYMBOLS) | SC_CHECK_BIT(SC_CHECK_FRIDA_ENV) |      \
+     SC_CHECK_BIT(SC_CHECK_FRIDA_FILES) | SC_CHECK_BIT(SC_CHECK_DEBUGGER))
+
+typedef enum {
+    SC_STATUS_NOT_RUN = 0,   // not selected, or not available on this platform
+    SC_STATUS_CLEAN,
+    SC_STATUS_DETECTED,
+    SC_STATUS_CANCELLED,     // skipped after another check was decisive
+    SC_STATUS_TIMED_OUT      // still running when the deadline passed
+} sc_check_status;
+
+typedef struct {
+    sc_check_status status;
+    unsigned int elapsed_us;
+} sc_check_result;
+
+// Run the checks in `mask` concurrently on the shared worker pool.
+// deadline_ms == 0 waits for every check. With stop_on_detect, the call
+// returns on the first detection and checks that have not started yet are
+// cancelled. `results` (may be NULL) must hold SC_CHECK_COUNT entries and
+// is indexed by sc_check_id. Returns true if any check detected something.
+bool run_checks(unsigned int mask, unsigned int deadline_ms, bool stop_on_detect, sc_check_result* results);
+
+// ========== Async Checks ==========
+// Non-blocking run_checks(): sc_submit() returns at once and the checks run
+// on the worker pool, with deadlines and cancellation handled by one shared
+// timer thread, so no thread waits on the task. on_check (may be NULL) is
+// called for each selected check as it settles (from the cache, a probe,
+// the deadline or cancellation), then on_done exactly once with
+// SC_CHECK_COUNT results valid during the call. Callbacks of one task never
+// overlap and always run on library threads, never inside sc_submit(); they
+// may call sc_submit() and sc_cancel() but should return quickly.
+typedef unsigned long long sc_task;
+
+typedef void (*sc_check_callback)(sc_task task, sc_check_id id, sc_check_result result, void* userdata);
+typedef void (*sc_done_callback)(sc_task task, bool detected, const sc_check_result* results, void* userdata);
+
+// Returns the task handle, never 0.
+sc_task sc_submit(unsigned int mask, unsigned int deadline_ms, bool stop_on_detect,
+                  sc_check_callback on_check, sc_done_callback on_done, void* userdata);
+
+// Settle the task's unfinished checks as SC_STATUS_CANCELLED and complete
+// it; the callbacks follow shortly on the timer thread. Probes already
+// running finish in the background. Returns false if the task has already
+// completed (its on_done has run or is about to).
+bool sc_cancel(sc_task task);
+
+// ========== Result Cache ==========
+// Check results are cached per id. Volatile signals (threads, memory maps)
+// have short TTLs and are also invalidated when the thread count or mapped
+// size changes; stable ones (system props, root files) live much longer.
+// ttl_ms == 0 disables caching for that check.
+void security_core_set_cache_ttl(sc_check_id id, unsigned int ttl_ms);
+void security_core_invalidate_cache();
+
+// Per-check instrumentation, counted since load (or the last reset).
+// Bucket i of latency_buckets counts probe runs that took [2^i, 2^(i+1))
+// nanoseconds; the last bucket also holds everything slower.
+#define SC_STATS_BUCKETS 32
+
+typedef struct {
+    unsigned long long calls;       // probe runs that completed
+    unsigned long long detections;  // completed runs that detected
+    unsigned long long cache_hits;  // answered from the cache, probe not run
+    unsigned long long cancelled;   // skipped by stop_on_detect
+    unsigned long long timeouts;    // not finished at the deadline (may still complete later)
+    unsigned long long total_ns;
+    unsigned long long max_ns;
+    unsigned int latency_buckets[SC_STATS_BUCKETS];
+} sc_check_stats;
+
+// `stats` must hold SC_CHECK_COUNT entries; it is indexed by sc_check_id.
+void security_core_get_stats(sc_check_stats* stats);
+void security_core_reset_stats();
+// Short English name of a check ("Frida thread"), or NULL if out of range.
+const char* security_core_check_name(sc_check_id id);
+
+// ========== Background Monitor ==========
+// Periodic checks share one background thread. Each monitor's interval
+// doubles after every clean run up to its maximum and drops back to the
+// minimum after a detection; monitors falling due close together run on
+// the same wakeup.
+typedef enum {
+    SC_MONITOR_SELF_HEAL = 0,   // restore sensitive_function() if patched
+    SC_MONITOR_INTEGRITY,       // verify_integrity_hot() on a few pages
+    SC_MONITOR_FRIDA_THREAD,    // detect_frida_thread()
+    SC_MONITOR_MEMORY_MAPS,     // detect_memory_maps()
+    SC_MONITOR_COUNT
+} sc_monitor_id;
+
+// Called on the monitor thread after every run that detected something.
+typedef void (*sc_monitor_callback)(sc_monitor_id id, void* userdata);
+
+// Register (or re-register with new intervals) a monitor; 0 picks the
+// default interval. Monitors run once the thread is started.
+bool security_core_monitor_enable(sc_monitor_id id, unsigned int min_interval_ms, unsigned int max_interval_ms);
+void security_core_monitor_disable(sc_monitor_id id);
+void security_core_monitor_set_callback(sc_monitor_callback callback, void* userdata);
+// stop() joins the thread and keeps the enabled monitors for the next
+// start(). pause() is meant for when the app goes to the background;
+// resume() runs every monitor right away.
+void security_core_monitor_start();
+void security_core_monitor_stop();
+void security_core_monitor_pause();
+void security_core_monitor_resume();
+
+// Enable SC_MONITOR_SELF_HEAL and start the monitor.
+void start_self_heal();
+
 // Main security check function
 bool run_advanced_checks();
 
+// Same as run_advanced_checks() / is_rooted(), with a deadline and
+// per-check results. Timed-out checks do not count as detections.
+bool run_advanced_checks_ex(unsigned int deadline_ms, sc_check_result* results);
+bool is_rooted_ex(unsigned int deadline_ms, sc_check_result* results);
+
 // Individual detection functions
 bool detect_debugger();
 bool detect_frida_thread();
@@ -17,19 +169,138 @@ bool detect_memory_maps();
 bool check_process_name();
 bool verify_integrity();
 
+// Re-verify only pages flagged by earlier checks plus `sample_pages` pages
+// from a rotating cursor. Bounded cost for periodic checks.
+bool verify_integrity_hot(unsigned int sample_pages);
+
 // iOS-specific functions
 bool run_ios_anti_frida();
 bool run_ios_security_checks();
 
+// Frida detectors. The environment and file checks run everywhere; the
+// symbol and code injection checks inspect dyld images and return false on
+// other platforms.
+bool detect_frida_env();
+bool detect_frida_files();
+bool detect_frida_symbols();
+bool detect_code_injection();
+
 // Utility functions
+// Decodes into a per-thread buffer that stays valid until the calling
+// thread's next xor_decode(); any length is accepted.
 const char* xor_decode(const char* enc, char key);
-unsigned int crc32(unsigned char* data, size_t len);
+// Reentrant form: writes at most out_size - 1 bytes plus a terminator and
+// returns the full decoded length (like snprintf).
+size_t xor_decode_r(const char* enc, char key, char* out, size_t out_size);
+// CRC-32 as computed by zlib's crc32(). The sc_ prefix keeps these entry
+// points from colliding with zlib when an app links both.
+unsigned int sc_crc32(unsigned char* data, size_t len);
+
+// Incremental CRC32: init, feed any number of chunks, then finalize.
+// crc32_final(ctx) equals sc_crc32() over the concatenated chunks.
+typedef struct {
+    unsigned int state;
+    unsigned long long length;
+} crc32_ctx;
+
+void crc32_init(crc32_ctx* ctx);
+void crc32_update(crc32_ctx* ctx, const unsigned char* data, size_t len);
+unsigned int crc32_final(crc32_ctx* ctx);
+
+// CRC32 of A||B from sc_crc32(A), sc_crc32(B) and the length of B.
+unsigned int sc_crc32_combine(unsigned int crc1, unsigned int crc2, unsigned long long len2);
+
+// Split `data` across the shared worker pool and merge the partial CRCs.
+// max_threads == 0 uses every pool worker plus the calling thread.
+// Small buffers are checksummed on the calling thread.
+unsigned int crc32_parallel(const unsigned char* data, size_t len, unsigned int max_threads);
+
+// SHA-256 (OpenSSL) of `data`.
+#define SC_SHA256_LENGTH 32
+void sha256_digest(const unsigned char* data, size_t len, unsigned char out[SC_SHA256_LENGTH]);
+
+// Incremental SHA-256, like crc32_ctx. sha256_init() returns NULL if no
+// context can be allocated. sha256_final() writes the digest and always
+// frees the context, so it also ends a hash that is abandoned.
+typedef struct sha256_ctx sha256_ctx;
+
+sha256_ctx* sha256_init(void);
+bool sha256_update(sha256_ctx* ctx, const unsigned char* data, size_t len);
+bool sha256_final(sha256_ctx* ctx, unsigned char out[SC_SHA256_LENGTH]);
+
+// Checksum a whole file straight from its descriptor, so large files never
+// pass through a caller buffer. Regular files are hashed from offset 0 via
+// mmap (pread() below 1 MiB) and the descriptor's position is untouched;
+// pipes are read from the current position to EOF. The CRC of a large file
+// is split across the worker pool like crc32_parallel(). Both return false
+// if the descriptor cannot be read; the caller keeps ownership of fd.
+bool crc32_fd(int fd, unsigned int* out);
+bool sha256_fd(int fd, unsigned char out[SC_SHA256_LENGTH]);
+
+// Package file verification: are the shipped libraries and assets the
+// ones that were built? Files are hashed in parallel on the worker pool
+// (sha256_fd per file). cache_path (may be NULL) names a small cache of
+// files that already verified, keyed by device, inode, size, mtime and
+// ctime together with the expected digest; a file whose stat still matches
+// is not read again, so only the first launch after an install or update
+// pays for the hashing. The cache is replaced atomically when it changes
+// and ignored if damaged. statuses (may be NULL) gets one entry per file.
+// Returns true when every file is VERIFIED or CACHED.
+typedef struct {
+    const char* path;
+    unsigned char sha256[SC_SHA256_LENGTH];
+} sc_file_digest;
+
+typedef enum {
+    SC_FILE_VERIFIED = 0,   // hashed, digest matches
+    SC_FILE_CACHED,         // unchanged since it last verified
+    SC_FILE_MISMATCH,
+    SC_FILE_UNREADABLE
+} sc_file_status;
+
+bool verify_package_files(const sc_file_digest* files, size_t count, const char* cache_path,
+                          sc_file_status* statuses);
+
+// Signature database: the thread names, map and image substrings,
+// environment variables, symbols, package names and indicator paths the
+// detectors look for. A built-in set is compiled in; load_signatures()
+// replaces it with an image built by SecurityCoreSigGen from a text source
+// (cpp/signatures/signatures.txt), so signatures can be updated without a
+// native release. The file is mapped read-only and its checksum and
+// structure are verified once, here; replace it by renaming a new file over
+// it, never by rewriting it in place. Checks already running finish with
+// the set they started with, and the result cache is cleared. Fails,
+// keeping the active set, if the file is damaged, of another format
+// version, or has a lower revision than the active set.
+bool security_core_load_signatures(const char* path);
+// Revision of the active set; 0 for the built-in set.
+unsigned int security_core_signature_revision();
+// Exact match against the root manager / hiding app package names.
+bool security_core_is_root_package(const char* package_name);
 
 // Unified advanced root/jailbreak detection
 bool is_rooted();
 
+#pragma GCC visibility pop
+
 #ifdef __cplusplus
 }
 #endif
 
+// Deprecated spelling of sc_crc32(). It is defined here rather than
+// exported, so the library never provides a crc32 symbol that could bind
+// zlib's callers. In C++ it is an overload next to zlib's crc32(); C code
+// that includes zlib.h first, or defines SC_NO_LEGACY_CRC32, goes without.
+#if !defined(SC_NO_LEGACY_CRC32)
+#if defined(__cplusplus)
+__attribute__((deprecated("use sc_crc32()"))) static inline unsigned int crc32(unsigned char* data, size_t len) {
+    return sc_crc32(data, len);
+}
+#elif !defined(ZLIB_H)
+__attribute__((deprecated("use sc_crc32()"))) static inline unsigned int crc32(unsigned char* data, size_t len) {
+    return sc_crc32(data, len);
+}
+#endif
+#endif
+
 #endif // SECURITY_CORE_H
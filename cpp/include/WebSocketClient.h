@@ -1,25 +1,254 @@
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdint.h>
 #include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <vector>
 #include "WebSocketListener.h"
+#include "event_loop.h"
+#include "ws_deflate.h"
+#include "ws_dispatcher.h"
+#include "ws_frame_codec.h"
+#include "ws_outbound_queue.h"
 
-class WebSocketClient {
+struct ssl_st;
+struct ssl_ctx_st;
+struct ssl_session_st;
+struct x509_store_ctx_st;
+
+// permessage-deflate (RFC 7692) offer made in the upgrade request. The
+// server decides what is actually used; without its agreement messages go
+// out uncompressed.
+struct WebSocketCompression {
+    bool enabled = true;
+    int clientMaxWindowBits = 15;  // window of our compressor, 9..15
+    int serverMaxWindowBits = 15;  // largest window the server may use, 9..15
+    bool contextTakeover = true;   // keep the LZ77 history between messages
+    int level = 6;                 // zlib level, 1..9
+    size_t minSize = 64;           // smaller messages are sent uncompressed
+};
+
+// Reconnecting after a connection is lost, unless close() asked for it.
+// Attempt n waits a random time between half and all of
+// min(maxDelayMs, initialDelayMs * multiplier^n), so clients dropped
+// together do not come back in lockstep. A connection that opens resets n.
+struct WebSocketReconnect {
+    bool enabled = false;
+    int initialDelayMs = 500;
+    int maxDelayMs = 30000;
+    double multiplier = 2.0;
+};
+
+// RFC 6455 client for ws:// and wss:// URLs. All socket work happens on one
+// I/O thread per client, driven by EventLoop; connect(), send() and close()
+// only queue work and return. Listener callbacks run on a separate
+// dispatcher thread (see WsDispatcher), so a slow listener does not hold up
+// the socket.
+//
+// pubkeyBase64 pins the server: a comma-separated list of base64 SHA-256
+// digests of a certificate's SubjectPublicKeyInfo (an optional "sha256/"
+// prefix is accepted). When set, a connection is accepted only if some
+// certificate in the presented chain matches a pin, which also works with
+// self-signed servers. When empty, the chain and host name are verified
+// against the system CA store.
+//
+// The TLS context and the latest session ticket survive close(), so a
+// reconnect resumes the session instead of repeating the certificate
+// exchange and pin check.
+//
+// Messages wait in a WsOutboundQueue while the socket is busy or down; it
+// keeps WebSocketQueue::memoryBytes in memory and spills the rest to
+// memory-mapped segment files when spillPath is set. Only about 1 MiB at a
+// time is framed for the socket. Messages a dropped connection did not
+// write whole go back to the front of the queue for the next one, so only
+// what the kernel already accepted can be lost.
+class __attribute__((visibility("default"))) WebSocketClient {
 public:
     WebSocketClient(const std::string& url, const std::string& pubkeyBase64);
+    // Stops both threads; events not yet delivered are discarded. Must not be
+    // called from a listener callback.
+    ~WebSocketClient();
 
+    WebSocketClient(const WebSocketClient&) = delete;
+    WebSocketClient& operator=(const WebSocketClient&) = delete;
+
+    // Ignored while a connection is up or being retried. Called once the
+    // last connection has closed, e.g. from onClose, it starts a new one.
     void connect();
+    // Sends a text frame. Messages sent before the connection opens are
+    // delivered once it does; those the queue has no room for are dropped
+    // and counted by droppedSends().
     void send(const std::string& message);
+    void sendBinary(const char* data, size_t length);
+
+    // Streaming send: one message in pieces, each sent as its own frame.
+    // sendChunk() blocks while more than 1 MiB of the stream is waiting for
+    // the socket, so a large payload is never held in memory whole. Other
+    // messages sent meanwhile go out after endMessage(). One stream at a
+    // time. sendChunk() and endMessage() return false once the connection
+    // the stream started on is gone.
+    void beginMessage(bool binary);
+    bool sendChunk(const char* data, size_t length);
+    bool endMessage();
+    // Starts the closing handshake (code 1000) once queued messages are
+    // out, and stops reconnecting.
     void close();
 
     void setListener(WebSocketListener* listener);
+    // Takes effect on the next connect(). Compression is offered by default.
+    void setCompression(const WebSocketCompression& options);
+    // Must be called before the first connect().
+    void setDelivery(const WebSocketDelivery& options);
+    // Messages discarded under WebSocketDelivery::DROP.
+    uint64_t droppedMessages() const;
+    // Takes effect on the next connect(). Reconnecting is off by default.
+    void setReconnect(const WebSocketReconnect& options);
+    // Must be called before the first send(). spillPath must not be shared
+    // with another client.
+    void setQueue(const WebSocketQueue& options);
+    // Messages discarded because the outbound queue was full.
+    uint64_t droppedSends() const;
 
 private:
+    enum State {
+        STATE_IDLE,
+        STATE_CONNECTING,     // TCP connect in progress
+        STATE_TLS_HANDSHAKE,
+        STATE_WS_HANDSHAKE,   // upgrade request sent, waiting for 101
+        STATE_OPEN,
+        STATE_CLOSING,        // close frame sent
+        STATE_CLOSED
+    };
+
     std::string url;
     std::string pinnedPubKey;
-    WebSocketListener* listener = nullptr;
+
+    typedef WsOutgoing Outgoing;
+
+    WebSocketCompression compressionOptions;  // as set by the caller
+    WebSocketDelivery deliveryOptions;
+    WebSocketReconnect reconnectOptions;
+    WsDispatcher dispatcher;
+
+    // Parsed from url
+    std::string host;
+    std::string port;
+    std::string path;
+    bool secure = false;
+    std::vector<std::string> pins;  // raw 32-byte SPKI digests
+
+    // Shared with the calling threads
+    std::mutex outboxMutex;
+    WsOutboundQueue outbox;  // messages not yet framed by the I/O thread
+    std::atomic<uint64_t> droppedSendCount{0};
+    bool closeRequested = false;
+    bool ioFinishing = false;       // the I/O thread exits after the current connection
+    bool restartRequested = false;  // connect() arrived while it was exiting
+    std::condition_variable streamSpace;  // signalled as stream bytes are written
+    std::vector<Outgoing> held;           // sent during a stream, queued after it
+    size_t streamQueued = 0;              // stream bytes not yet written
+    bool streamOpen = false;
+    bool streamFirst = false;             // next piece starts the message
+    bool streamFailed = false;            // the connection was lost mid-stream
+    uint8_t streamOpcode = 0;
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> ioRunning{false};
+    std::thread ioThread;
+    EventLoop loop;
+
+    // Owned by the I/O thread
+    struct Address {
+        sockaddr_storage addr;
+        socklen_t len;
+    };
+
+    State state = STATE_IDLE;
+    bool opened = false;  // the current connection got past the handshake
+    // End of the opening handshake, then of the closing one once either side
+    // starts it
+    std::chrono::steady_clock::time_point deadline;
+    std::vector<Address> addresses;  // resolved, tried in order
+    size_t addressIndex = 0;
+    int fd = -1;
+    ssl_ctx_st* sslCtx = nullptr;
+    ssl_st* ssl = nullptr;
+    ssl_session_st* session = nullptr;  // resumed by the next TLS handshake
+    bool tlsWantsWrite = false;
+    std::string handshakeKey;
+    std::vector<uint8_t> recvBuffer;  // frames are parsed in place from here
+    size_t recvStart = 0;
+    size_t recvEnd = 0;
+    std::deque<Outgoing> writeQueue;  // framed, in send order
+    size_t writeQueueBytes = 0;       // unsent bytes in writeQueue
+    std::deque<Outgoing> unsent;      // unframed copies of outbox messages not yet written
+    std::string tlsChunk;       // frames coalesced for one SSL_write
+    size_t tlsOffset = 0;
+    size_t tlsChunkMessages = 0;  // outbox messages packed into tlsChunk
+    std::string fragments;      // payload of a fragmented message so far
+    uint8_t fragmentOpcode = 0;
+    bool fragmentCompressed = false;
+    bool inStream = false;        // receiving a message through onMessageChunk
+    bool inStreamCompressed = false;
+    bool inFrameFin = false;
+    uint64_t inFrameLeft = 0;     // payload bytes of the current streamed frame
+    bool outStreamStarted = false;     // part of a stream went out on this connection
+    bool outStreamWritten = false;     // part of a stream was written on this connection
+    bool outStreamCompressed = false;
+    WebSocketCompression compression;  // copy taken by takeOptions()
+    WebSocketReconnect reconnect;      // copy taken by takeOptions()
+    WsDeflater deflater;               // active once the server agreed
+    WsInflater inflater;
+    std::string compressed;            // scratch for outgoing messages
+    std::string inflated;              // scratch for incoming messages
+    bool closeReceived = false;
+    int closeCode = 1006;
+    std::string closeReason;
+
+    void ioLoop();
+    bool runConnection();
+    bool waitToReconnect(int attempt);
+    void takeOptions();
+    bool resolve(std::string& error);
+    bool connectNext(std::string& error);
+    bool finishConnect(std::string& error);
+    bool startTls(std::string& error);
+    bool stepTls(std::string& error);
+    void queueUpgradeRequest();
+    bool fillRecvBuffer();
+    bool parseHandshake(std::string& error);
+    bool parseFrames(std::string& error);
+    bool handleFrame(const WsFrame& frame, std::string& error);
+    bool streamFrame(const WsFrame& frame, std::string& error);
+    bool streamPayload(std::string& error);
+    bool flushWrites(std::string& error);
+    bool flushPlain(std::string& error);
+    bool flushTls(std::string& error);
+    long readSome(char* buf, size_t len);
+    bool writesPending() const;
+    bool negotiateCompression(const std::string& extensions, std::string& error);
+    bool emitCompressed(const char* data, size_t len, bool binary, std::string& error);
+    void queueMessage(uint8_t opcode, const char* data, size_t len);
+    void pushOutbox(Outgoing&& message);
+    bool queueStreamPiece(const char* data, size_t len, bool fin);
+    void requeueUnsent();
+    void abandonStream();
+    void releaseStreamBytes(size_t n);
+    bool takeOutbox(std::string& error);
+    void messagesWritten(size_t count);
+    void queueFrame(uint8_t opcode, const char* data, size_t len);
+    bool encodeMessage(Outgoing& message);
+    void teardown();
+
+    static int verifyCertificate(x509_store_ctx_st* ctx, void* arg);
+    static int storeSession(ssl_st* ssl, ssl_session_st* session);
 
     void emitOpen();
-    void emitMessage(const std::string& msg);
+    void emitMessage(const char* data, size_t length, bool binary);
     void emitClose(int code, const std::string& reason);
     void emitError(const std::string& error);
 };
-
@@ -1,16 +1,49 @@
 // include/WebSocketListener.h
 
 #pragma once
+#include <stddef.h>
 #include <string>
 
 typedef void (*OnOpenCallback)();
 typedef void (*OnMessageCallback)(const char* message);
 typedef void (*OnCloseCallback)(int code, const char* reason);
 typedef void (*OnErrorCallback)(const char* error);
+// Zero-copy view of a complete message, valid only during the call.
+typedef void (*OnMessageDataCallback)(const char* data, size_t length);
+
+// Binary messages, which may contain NUL bytes.
+typedef void (*OnBinaryMessageCallback)(const char* data, size_t length);
+
+struct WebSocketMessage {
+    const char* data;
+    size_t length;
+    bool binary;
+};
+// Messages queued since the last wakeup, in order; valid only during the call.
+typedef void (*OnMessageBatchCallback)(const WebSocketMessage* messages, size_t count);
+
+// Streaming receive: begin, any number of chunks (each valid only during
+// the call), then end. Messages are never assembled in memory.
+typedef void (*OnMessageBeginCallback)(bool binary);
+typedef void (*OnMessageChunkCallback)(const char* data, size_t length);
+typedef void (*OnMessageEndCallback)();
 
 struct WebSocketListener {
     OnOpenCallback onOpen;
     OnMessageCallback onMessage;
     OnCloseCallback onClose;
     OnErrorCallback onError;
+    // Optional. When set it is used instead of onMessage, and sees messages
+    // with embedded NUL bytes whole. Both get a view of the queued message,
+    // not a copy, valid only during the call.
+    OnMessageDataCallback onMessageData;
+    // Optional. Preferred over both when set.
+    OnMessageBatchCallback onMessageBatch;
+    // Optional. Receives binary messages instead of the callbacks above.
+    OnBinaryMessageCallback onBinaryMessage;
+    // Optional. When onMessageChunk is set, every message is streamed
+    // through these three instead, with no size limit.
+    OnMessageBeginCallback onMessageBegin;
+    OnMessageChunkCallback onMessageChunk;
+    OnMessageEndCallback onMessageEnd;
 };
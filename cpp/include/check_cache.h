@@ -0,0 +1,26 @@
+#pragma once
+#include <stdint.h>
+#include "SecurityCore.h"
+
+// Snapshot taken before a probe runs. The result is stored against the
+// state the probe actually observed, so a change that happens mid-probe
+// still invalidates it. The generation fences off probes that were in
+// flight when check_cache_invalidate_all() ran.
+struct CheckCacheTicket {
+    uint64_t startedNs = 0;
+    uint64_t fingerprint = 0;
+    uint64_t generation = 0;
+};
+
+// Returns true and sets *detected when a fresh result is cached.
+bool check_cache_lookup(sc_check_id id, bool* detected);
+
+CheckCacheTicket check_cache_begin(sc_check_id id);
+void check_cache_store(sc_check_id id, const CheckCacheTicket& ticket, bool detected);
+
+void check_cache_set_ttl(sc_check_id id, unsigned int ttlMs);
+// Drops every cached result and every store from a ticket taken before the
+// call. Both take effect at once: from the moment the generation is bumped
+// no older result is returned or stored, and only probes that began
+// afterwards can fill the cache.
+void check_cache_invalidate_all();
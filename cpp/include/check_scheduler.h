@@ -0,0 +1,48 @@
+#pragma once
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+#include "SecurityCore.h"
+
+// A probe returns true when it found something suspicious.
+typedef bool (*CheckProbe)();
+
+struct CheckSpec {
+    sc_check_id id;
+    const char* name;
+    CheckProbe probe;  // nullptr when the check does not apply to this platform
+};
+
+// Runs the specs selected by `mask` on the shared ThreadPool and waits until
+// all are done, the deadline passes, or (with stopOnDetect) one detects.
+// The deadline runs from the call. Called on a pool worker, it runs the
+// probes inline instead (waiting on its own pool could deadlock); those
+// cannot be cut short, and any overrun counts against the deadline.
+// `specs` must have static storage duration: probes still running at the
+// deadline finish in the background. `results` may be null, otherwise it
+// holds SC_CHECK_COUNT entries. Returns true if any check detected.
+bool schedule_checks(const CheckSpec* specs, size_t count, unsigned int mask,
+                     unsigned int deadlineMs, bool stopOnDetect, sc_check_result* results);
+
+// Callbacks of schedule_checks_async(). For one task they never overlap and
+// run on a pool worker or the scheduler's timer thread, never inside the
+// scheduling call. onCheck sees each selected check once, as it settles;
+// onDone comes last, exactly once. Either may be empty.
+struct AsyncCheckCallbacks {
+    std::function<void(uint64_t task, sc_check_id id, const sc_check_result& result)> onCheck;
+    std::function<void(uint64_t task, bool detected, const sc_check_result* results)> onDone;
+};
+
+// Non-blocking schedule_checks(): every probe goes to the shared ThreadPool
+// and the deadline is kept by a timer thread shared by all tasks. Checks in
+// presetMask are already settled, e.g. from the cache, with preset[id]
+// (SC_CHECK_COUNT entries) as their result, and are only reported. Returns
+// the task id, never 0.
+uint64_t schedule_checks_async(const CheckSpec* specs, size_t count, unsigned int mask,
+                               unsigned int presetMask, const sc_check_result* preset,
+                               unsigned int deadlineMs, bool stopOnDetect, AsyncCheckCallbacks callbacks);
+
+// Settle every unfinished check of the task as cancelled and complete it;
+// delivery happens on the timer thread. Probes already running finish in
+// the background. Returns false if the task has already completed.
+bool cancel_scheduled_checks(uint64_t task);
@@ -0,0 +1,20 @@
+#pragma once
+#include <stdint.h>
+#include "SecurityCore.h"
+
+// Per-check counters behind security_core_get_stats(). Relaxed atomics on
+// a cache line per check, so recording costs a few uncontended increments.
+
+// A probe ran to completion in `elapsedNs`.
+void check_stats_record(sc_check_id id, uint64_t elapsedNs, bool detected);
+
+// The result was served from the cache without running the probe.
+void check_stats_record_cache_hit(sc_check_id id);
+
+// The probe was cancelled before it started, or its caller stopped waiting
+// at the deadline.
+void check_stats_record_cancelled(sc_check_id id);
+void check_stats_record_timeout(sc_check_id id);
+
+void check_stats_snapshot(sc_check_stats* out);
+void check_stats_reset();
@@ -0,0 +1,48 @@
+#ifndef CRC32_ENGINE_H
+#define CRC32_ENGINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// CRC-32 (reflected polynomial 0xEDB88320, same as zlib).
+//
+// Kernels operate on the raw CRC register: callers seed it with 0xFFFFFFFF
+// and invert the final value. This lets a checksum be continued across
+// several calls without re-inverting in between.
+typedef uint32_t (*crc32_kernel_fn)(uint32_t crc, const unsigned char* data, size_t len);
+
+typedef enum {
+    CRC32_KERNEL_BITWISE = 0,  // reference, one bit per iteration
+    CRC32_KERNEL_SLICE8,       // portable, 8 bytes per iteration
+    CRC32_KERNEL_SLICE16,      // portable, 16 bytes per iteration
+    CRC32_KERNEL_PCLMUL,       // x86 carry-less multiply folding
+    CRC32_KERNEL_ARMV8,        // ARMv8 CRC32 instructions
+    CRC32_KERNEL_COUNT
+} crc32_kernel_kind;
+
+// Update the raw register using the fastest kernel supported by this CPU.
+// The kernel is selected once, on first use, and verified against the
+// bitwise reference before it is trusted.
+uint32_t crc32_engine_update(uint32_t crc, const unsigned char* data, size_t len);
+
+// CRC of A||B given crc(A), crc(B) and len(B). Operates on finalized
+// (inverted) values, like zlib's crc32_combine().
+uint32_t crc32_engine_combine(uint32_t crc1, uint32_t crc2, uint64_t len2);
+
+// Kernel currently used by crc32_engine_update().
+crc32_kernel_kind crc32_engine_active_kernel();
+
+// Returns the kernel for `kind`, or NULL if it is not available on this CPU.
+crc32_kernel_fn crc32_engine_kernel(crc32_kernel_kind kind);
+
+const char* crc32_engine_kernel_name(crc32_kernel_kind kind);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRC32_ENGINE_H
@@ -0,0 +1,39 @@
+#pragma once
+
+// Readiness notification for a single I/O thread: epoll on Linux/Android,
+// kqueue on Apple platforms. Level-triggered. wake() may be called from any
+// thread to interrupt wait().
+class EventLoop {
+public:
+    enum { READABLE = 1, WRITABLE = 2 };
+
+    struct Event {
+        int fd;
+        unsigned events;  // READABLE | WRITABLE; errors and hangups report both
+    };
+
+    EventLoop();
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    bool valid() const { return pollFd >= 0; }
+
+    // Register fd or change its interest set. Closing the fd unregisters it.
+    bool watch(int fd, unsigned events);
+    void unwatch(int fd);
+
+    // Wait up to timeoutMs (-1 blocks). Returns the number of events stored,
+    // 0 on timeout or wake(), -1 on error.
+    int wait(Event* events, int maxEvents, int timeoutMs);
+
+    void wake();
+
+private:
+    int pollFd = -1;
+    int wakeRead = -1;
+    int wakeWrite = -1;  // same as wakeRead for an eventfd
+
+    void drainWake();
+};
@@ -0,0 +1,22 @@
+#pragma once
+#include <stddef.h>
+
+// Hands the contents of a file descriptor to a callback in large pieces,
+// without copying into caller memory where the platform allows it.
+//
+// Regular files are read from offset 0 regardless of the descriptor's
+// position, which is left alone: files of at least FD_READER_MMAP_MIN bytes
+// are mapped FD_READER_WINDOW bytes at a time with sequential-access advice,
+// smaller ones are read with pread() after a readahead hint. Pipes, sockets
+// and other streams are read() from their current position to EOF.
+static const size_t FD_READER_WINDOW = 64 * 1024 * 1024;
+static const size_t FD_READER_MMAP_MIN = 1024 * 1024;
+
+// Called with consecutive pieces of the file; return false to stop early.
+// A mapped piece is only valid during the call.
+typedef bool (*FdChunkCallback)(const unsigned char* data, size_t len, void* userdata);
+
+// Returns false if the descriptor cannot be read (or fn stopped the read).
+// A file truncated by another process while mapped raises SIGBUS, as with
+// any mmap reader; use it on files the app controls.
+bool fd_read_chunks(int fd, FdChunkCallback fn, void* userdata);
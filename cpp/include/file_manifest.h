@@ -0,0 +1,29 @@
+#pragma once
+#include <stdint.h>
+#include "SecurityCore.h"
+
+// Verifier behind verify_package_files().
+//
+// Cache file layout (little-endian, native struct layout):
+//   "SCFCACH1", u32 version, u32 record count,
+//   FileCacheRecord[count], u32 CRC32 of everything before it.
+// Records are sorted by (dev, ino). A record whose stamp or digest does not
+// match the file exactly is ignored, so a stale or foreign cache can only
+// cost a re-hash, never skip a changed file.
+#define SC_FILE_CACHE_MAGIC "SCFCACH1"
+#define SC_FILE_CACHE_VERSION 1
+#define SC_FILE_CACHE_MAX_RECORDS 4096
+
+struct FileCacheRecord {
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    int64_t mtimeSec;
+    int64_t mtimeNsec;
+    int64_t ctimeSec;
+    int64_t ctimeNsec;
+    unsigned char sha256[SC_SHA256_LENGTH];
+};
+
+bool file_manifest_verify(const sc_file_digest* files, size_t count, const char* cachePath,
+                          sc_file_status* statuses);
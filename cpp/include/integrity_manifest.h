@@ -0,0 +1,60 @@
+#ifndef INTEGRITY_MANIFEST_H
+#define INTEGRITY_MANIFEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Per-page CRC32 of the library's read-only PT_LOAD segments (.text,
+// .rodata, ...). The manifest is compiled in empty and filled by
+// scripts/seal_manifest.py after linking. It lives in a writable section so
+// sealing does not change the bytes it describes.
+//
+// Layout is shared with seal_manifest.py -- keep both in sync.
+
+#define SC_MANIFEST_MAGIC "SCMANIF1"
+#define SC_MANIFEST_VERSION 1
+#define SC_MANIFEST_PAGE_SIZE 4096
+#define SC_MANIFEST_MAX_SEGMENTS 8
+#define SC_MANIFEST_MAX_PAGES 4096
+
+typedef struct {
+    uint64_t vaddr;       // p_vaddr, relative to the load bias
+    uint64_t size;        // p_filesz
+    uint32_t first_page;  // index of the segment's first entry in page_crc
+    uint32_t page_count;
+} sc_manifest_segment;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t sealed;
+    uint32_t page_size;
+    uint32_t segment_count;
+    uint32_t page_count;
+    uint32_t reserved;
+    sc_manifest_segment segments[SC_MANIFEST_MAX_SEGMENTS];
+    uint32_t page_crc[SC_MANIFEST_MAX_PAGES];
+} sc_manifest;
+
+// True once the manifest has been sealed and the library's mapping located.
+bool integrity_manifest_available();
+
+// Verify every page. Mismatching pages are marked hot.
+bool integrity_verify_all();
+
+// Verify hot pages plus the next `sample_pages` pages of a rotating cursor.
+// Pages that verify clean are cleared from the hot set.
+bool integrity_verify_hot(unsigned int sample_pages);
+
+// Mark the pages covering [addr, addr + len) for re-verification.
+void integrity_mark_hot(const void* addr, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INTEGRITY_MANIFEST_H
@@ -0,0 +1,81 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+// One background thread that runs every periodic check (self-heal,
+// integrity re-hash, thread and maps watches).
+//
+// Each task has an interval range. A run that detects nothing doubles the
+// task's interval up to maxIntervalMs, so an idle app settles on rare
+// wakeups; a detection snaps it back to minIntervalMs. Tasks that fall due
+// within an eighth of their interval of each other run on the same wakeup,
+// and on Linux the thread asks for a large timer slack so the kernel can
+// merge its wakeups with other timers.
+class Monitor {
+public:
+    // Returns true when the task detected something.
+    typedef std::function<bool()> Task;
+    // Called on the monitor thread after every run that detected.
+    typedef std::function<void(int handle)> Listener;
+
+    Monitor() = default;
+    ~Monitor();
+
+    Monitor(const Monitor&) = delete;
+    Monitor& operator=(const Monitor&) = delete;
+
+    // Register a task. It first runs on the next wakeup. Returns a handle for
+    // remove(). Tasks must not throw.
+    int add(uint32_t minIntervalMs, uint32_t maxIntervalMs, Task task);
+    // Unregister a task. A run already in progress finishes.
+    void remove(int handle);
+
+    void setListener(Listener listener);
+
+    // start() spawns the thread if needed and clears a pause. stop() joins
+    // it (or lets it exit on its own when called from a task); registered
+    // tasks are kept for the next start().
+    void start();
+    void stop();
+    // While paused the thread sleeps without timeouts. resume() makes every
+    // task due at once, as the app may have been in the background long.
+    void pause();
+    void resume();
+
+    bool running() const;
+
+    // Process-wide monitor, created on first use.
+    static Monitor& shared();
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Entry {
+        int handle;
+        uint32_t minMs;
+        uint32_t maxMs;
+        uint32_t currentMs;
+        Clock::time_point next;
+        Task task;
+        bool removed;
+    };
+
+    std::vector<std::shared_ptr<Entry>> entries;
+    Listener listener;
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+    std::mutex lifecycle;  // serializes start()/stop()
+    std::thread thread;
+    int nextHandle = 1;
+    uint32_t generation = 0;  // bumped by stop(); a thread exits when it changes
+    bool active = false;
+    bool paused = false;
+
+    void threadLoop(uint32_t gen);
+};
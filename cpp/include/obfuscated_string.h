@@ -0,0 +1,113 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Compile-time string obfuscation.
+//
+// OBF("literal") encrypts the literal while compiling, so the plaintext
+// never appears in .rodata, and decodes it into a stack buffer that is
+// wiped when it goes out of scope:
+//
+//     matcher.addPattern(OBF("frida").c_str());
+//
+// The result lives until the end of the full expression; copy it into a
+// local (auto s = OBF("...")) to keep it longer. Every literal gets its own
+// 16-byte key derived from __COUNTER__ and __LINE__. Decoding is reentrant
+// and XORs 16 bytes at a time.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// out[i] = in[i] ^ key[i % 16] for i < len. `out` may equal `in`.
+void obfuscated_xor(char* out, const char* in, const uint8_t key[16], size_t len);
+
+// memset(0) that the compiler may not drop.
+void obfuscated_wipe(void* data, size_t len);
+
+#ifdef __cplusplus
+}
+
+namespace obf {
+
+template <size_t... I> struct IndexSeq {};
+template <size_t N, size_t... I> struct MakeIndexSeq : MakeIndexSeq<N - 1, N - 1, I...> {};
+template <size_t... I> struct MakeIndexSeq<0, I...> { typedef IndexSeq<I...> type; };
+
+constexpr uint32_t mix(uint32_t x) {
+    return ((x ^ (x >> 16)) * 0x45D9F3Bu) ^ (((x ^ (x >> 16)) * 0x45D9F3Bu) >> 16);
+}
+
+constexpr uint32_t seed(uint32_t counter, uint32_t line) {
+    return mix(counter * 0x9E3779B9u + line);
+}
+
+// Never zero, so no byte is left in the clear.
+constexpr uint8_t keyByte(uint32_t seed, size_t i) {
+    return (uint8_t)(mix(seed + (uint32_t)i * 0x85EBCA6Bu) >> 24) ? (uint8_t)(mix(seed + (uint32_t)i * 0x85EBCA6Bu) >> 24)
+                                                                  : (uint8_t)0xA5;
+}
+
+template <size_t N>
+class DecodedString {
+public:
+    DecodedString(const char* cipher, const uint8_t* key) {
+        obfuscated_xor(buf, cipher, key, N - 1);
+        buf[N - 1] = '\0';
+    }
+    ~DecodedString() { obfuscated_wipe(buf, N); }
+
+    const char* c_str() const { return buf; }
+    size_t size() const { return N - 1; }
+
+private:
+    char buf[N];
+};
+
+template <size_t N, uint32_t Seed>
+class ObfuscatedString {
+public:
+    constexpr ObfuscatedString(const char (&s)[N])
+        : ObfuscatedString(s, typename MakeIndexSeq<N>::type(), typename MakeIndexSeq<16>::type()) {}
+
+    DecodedString<N> decode() const {
+        // Hide where the bytes come from, or the optimizer folds the XOR
+        // back into a plaintext constant.
+        const char* c = cipher;
+        const uint8_t* k = key;
+        __asm__("" : "+r"(c), "+r"(k));
+        return DecodedString<N>(c, k);
+    }
+
+    // Decode into a caller buffer. Returns the string length, or 0 if
+    // `size` cannot hold it and the terminator.
+    size_t decodeTo(char* out, size_t size) const {
+        if (size < N) return 0;
+        const char* c = cipher;
+        const uint8_t* k = key;
+        __asm__("" : "+r"(c), "+r"(k));
+        obfuscated_xor(out, c, k, N - 1);
+        out[N - 1] = '\0';
+        return N - 1;
+    }
+
+private:
+    char cipher[N];
+    uint8_t key[16];
+
+    template <size_t... I, size_t... K>
+    constexpr ObfuscatedString(const char (&s)[N], IndexSeq<I...>, IndexSeq<K...>)
+        : cipher{(char)(s[I] ^ keyByte(Seed, I % 16))...}, key{keyByte(Seed, K)...} {}
+};
+
+}  // namespace obf
+
+#define OBF_LITERAL(str, seed_)                                                                  \
+    (__extension__({                                                                             \
+        static constexpr ::obf::ObfuscatedString<sizeof(str), seed_> obf_literal_(str);         \
+        obf_literal_.decode();                                                                   \
+    }))
+
+#define OBF(str) OBF_LITERAL(str, ::obf::seed(__COUNTER__, __LINE__))
+
+#endif  // __cplusplus
@@ -0,0 +1,63 @@
+#pragma once
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Batched existence checks for a fixed set of absolute paths.
+//
+// Paths are grouped by parent directory. Each parent is opened once and
+// kept as a dirfd, so a probe is one faccessat() per path relative to it,
+// and a missing parent rules out all of its children without touching them.
+// On desktop Linux a large batch is submitted as IORING_OP_STATX in one
+// io_uring_enter(); Android app seccomp policies do not allow io_uring, so
+// it is never attempted there.
+//
+// Cached dirfds are reopened when the mount table changes, so a bind mount
+// over a probed directory after the first probe is still seen. Parents that
+// were missing are looked up again on a mount change or after a second.
+class PathProber {
+public:
+    static const size_t MAX_PATHS = 64;
+
+    // `paths` must outlive the prober; at most MAX_PATHS are used.
+    PathProber(const char* const* paths, size_t count);
+    ~PathProber();
+
+    PathProber(const PathProber&) = delete;
+    PathProber& operator=(const PathProber&) = delete;
+
+    // Bit i is set if paths[i] exists. Only paths whose bit is set in
+    // `select` are probed.
+    uint64_t probe(uint64_t select = ~0ULL);
+
+    size_t size() const { return entries.size(); }
+
+#if defined(SECURITY_CORE_BENCH)
+    // Resolve every prober's paths under `prefix` (nullptr or "" for the
+    // real root). For benchmarks against fixture trees: only the library
+    // build linked into SecurityCoreBench has it. Cached dirfds are reopened
+    // on the next probe.
+    static void setRoot(const char* prefix);
+#endif
+
+private:
+    struct Directory {
+        std::string path;
+        int fd = -1;
+        uint64_t openedNs = 0;  // when fd was last opened or found missing
+    };
+    struct Entry {
+        const char* path;
+        const char* name;  // points into path, after the parent's '/'
+        size_t dir;
+    };
+
+    std::vector<Directory> dirs;
+    std::vector<Entry> entries;
+    std::mutex mutex;
+    uint32_t mountGeneration = 0;
+
+    void refreshDirectories(const std::string& root);
+};
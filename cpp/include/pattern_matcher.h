@@ -0,0 +1,92 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Multi-pattern substring matcher (Aho-Corasick compiled into a DFA).
+//
+// All signatures are matched in one pass over the input; the result is a
+// bitmask of pattern ids that occurred. Input can be fed in arbitrary
+// chunks, so procfs files are scanned with large reads instead of per-line
+// fgets + strstr. Matching is case-sensitive, like strstr.
+class PatternMatcher {
+public:
+    static const size_t MAX_PATTERNS = 64;
+
+    // Called at every '\n' in line mode with the patterns seen on that line.
+    // Return false to stop scanning.
+    typedef bool (*LineCallback)(uint64_t lineHits, void* userdata);
+
+    // Streaming state; one per input stream.
+    struct Scanner {
+        uint32_t state = 0;
+        uint64_t hits = 0;
+        uint64_t lineHits = 0;
+        bool stopped = false;
+    };
+
+    // Returns the pattern id (bit index in hit masks), or -1 if the matcher
+    // is full, already compiled, or the pattern is empty.
+    int addPattern(const char* pattern, size_t len);
+    int addPattern(const char* pattern);
+
+    // Build the automaton. In line mode matches never span a '\n' and the
+    // line callback fires once per line.
+    void compile(bool lineMode = false);
+
+    bool compiled() const { return isCompiled; }
+    size_t patternCount() const { return numPatterns; }
+
+    // Compiled automaton as a flat image, so it can be built ahead of time
+    // and stored (see sig_db.h). Layout: patternCount, classCount,
+    // stateCount, lineMode (uint32 each), byteClass[256], next (uint16,
+    // zero-padded to a multiple of 8 bytes), output (uint64 per state).
+    // imageSize() is 0 until compiled.
+    size_t imageSize() const;
+    void writeImage(uint8_t* out) const;
+
+    // Match with a stored image in place; its tables are not copied, so
+    // `image` must be 8-byte aligned and outlive the matcher. Returns false,
+    // leaving the matcher uncompiled, if the image is malformed.
+    bool loadImage(const uint8_t* image, size_t len);
+
+    void feed(Scanner& scanner, const char* data, size_t len,
+              LineCallback onLine = nullptr, void* userdata = nullptr) const;
+
+    // Flush a trailing line without '\n' to the callback.
+    void finish(Scanner& scanner, LineCallback onLine = nullptr, void* userdata = nullptr) const;
+
+    // Hit mask for a complete in-memory buffer.
+    uint64_t scan(const char* data, size_t len) const;
+
+    // Scan a whole file with large reads. Returns the hit mask, or 0 if the
+    // file cannot be opened.
+    uint64_t scanFile(const char* path, LineCallback onLine = nullptr, void* userdata = nullptr) const;
+
+private:
+    std::vector<std::string> patterns;
+    bool isCompiled = false;
+    bool lineMode = false;
+    uint32_t numPatterns = 0;
+
+    // Bytes that occur in no pattern share class 0.
+    uint8_t byteClass[256] = {};
+    uint32_t classCount = 1;
+    // next[state * classCount + class]
+    std::vector<uint16_t> next;
+    // Patterns ending at each state, including suffix matches.
+    std::vector<uint64_t> output;
+    uint32_t stateCount = 0;
+    // Set by loadImage(); used instead of next / output.
+    const uint16_t* imageNext = nullptr;
+    const uint64_t* imageOutput = nullptr;
+
+    // Root-state prefilter: bytes that can leave the root state.
+    bool isStartByte[256] = {};
+    uint8_t startBytes[4] = {};
+    uint32_t startByteCount = 0;  // 0 when more than 4 distinct start bytes
+
+    void buildPrefilter(const uint16_t* table);
+    size_t skipToCandidate(const unsigned char* data, size_t len) const;
+};
@@ -0,0 +1,49 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "pattern_matcher.h"
+
+// Long-lived descriptors for the /proc/self files the detectors poll.
+//
+// Each file is opened once (and again after fork, since /proc/self is
+// resolved at open time) and re-read with pread() from offset 0 into a
+// per-thread arena that is reused across calls, so the periodic-check path
+// does no open/close and no heap allocation once warm. Not available on
+// Apple platforms, where every call fails.
+enum ProcfsFile {
+    PROCFS_MAPS,
+    PROCFS_STATUS,
+    PROCFS_MOUNTS,
+    PROCFS_CMDLINE,
+    PROCFS_STATM,
+    PROCFS_FILE_COUNT
+};
+
+// Read the whole file. Returns a NUL-terminated buffer owned by the calling
+// thread, valid until its next procfs_* call, or nullptr on failure.
+const char* procfs_read(ProcfsFile file, size_t* len);
+
+// Stream the file through `matcher` in arena-sized chunks. Returns the hit
+// mask, or 0 if the file cannot be read.
+uint64_t procfs_scan(ProcfsFile file, const PatternMatcher& matcher,
+                     PatternMatcher::LineCallback onLine = nullptr, void* userdata = nullptr);
+
+// Call fn with the name (/proc/self/task/<tid>/comm, without the trailing
+// '\n') of every thread until it returns false. Threads are listed with
+// getdents64 on a persistent task dirfd and each comm fd is kept open for
+// as long as the thread exists. Returns false if the task list is
+// unavailable.
+typedef bool (*ProcfsThreadNameCallback)(const char* name, size_t len, void* userdata);
+bool procfs_for_each_thread_name(ProcfsThreadNameCallback fn, void* userdata);
+
+// Link count of /proc/self/task (threads + 2), or 0 if unavailable.
+uint64_t procfs_task_link_count();
+
+#if defined(SECURITY_CORE_BENCH)
+// Read from `dir` (laid out like /proc/self: maps, status, mounts, cmdline,
+// statm, task/<tid>/comm) instead of /proc/self; nullptr restores it. For
+// benchmarks against fixture trees: only the library build linked into
+// SecurityCoreBench has it. Closes every cached fd, so it must not race with
+// running detectors.
+void procfs_set_root(const char* dir);
+#endif
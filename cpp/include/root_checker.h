@@ -0,0 +1,34 @@
+#ifndef ROOT_CHECKER_H
+#define ROOT_CHECKER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool check_root();
+
+// True if /proc/self/mounts has a line mentioning both "/system" and "rw".
+bool detect_rw_system_mount();
+
+// Filesystem indicators of root, jailbreak and Frida, probed as one batch
+// (see PathProber). The paths come from the active signature set (SIG_PATHS
+// in sig_db.h); each is tagged with one of these groups.
+#define INDICATOR_ROOT_BINARIES   0x01u  // su, Superuser.apk, ...
+#define INDICATOR_FRIDA_SERVER    0x02u  // /data/local/tmp/frida-server
+#define INDICATOR_JAILBREAK_BASIC 0x04u  // Cydia, MobileSubstrate, sshd, ...
+#define INDICATOR_JAILBREAK_APT   0x08u  // /private/var/lib/apt/
+#define INDICATOR_FRIDA_FILES     0x10u  // frida-gadget, frida-agent, fd-server, ...
+#define INDICATOR_JAILBREAK       (INDICATOR_JAILBREAK_BASIC | INDICATOR_JAILBREAK_APT)
+#define INDICATOR_ALL             0x1Fu
+
+// True if an indicator path in one of `groups` exists.
+bool probe_indicator_paths(unsigned int groups);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ROOT_CHECKER_H
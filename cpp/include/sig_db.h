@@ -0,0 +1,166 @@
+#pragma once
+#include "path_prober.h"
+#include "pattern_matcher.h"
+
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Signature database: every name, path and substring the detectors look
+// for, in one versioned image that can be replaced without a native
+// release.
+//
+// Image layout (little-endian, native struct layout, 8-byte aligned
+// sections, offsets from the start of the image):
+//   SigDbHeader, then one section per SigSetId.
+//   Pattern sets: a PatternMatcher image (precompiled Aho-Corasick DFA).
+//   Exact sets:   SigStringSet whose entries are in perfect-hash slot
+//                 order, followed by the bucket displacements and the pool.
+//   Lists:        SigStringSet in source order, no displacements.
+// Strings in the pool are NUL-terminated; the CRC32 covers everything after
+// the crc32 field. Images are built by SigDbBuilder, either at startup for
+// the built-in set or by SecurityCoreSigGen from a text source
+// (signatures/signatures.txt).
+#define SIG_DB_MAGIC "SCSIGDB1"
+#define SIG_DB_FORMAT_VERSION 1
+#define SIG_DB_MAX_SIZE (4u * 1024 * 1024)
+#define SIG_DB_MAX_STRING 4095
+
+enum SigSetId {
+    // Substring patterns, matched in one pass (at most 64 each)
+    SIG_THREAD_NAMES = 0,  // /proc/self/task/*/comm
+    SIG_MAPS,              // /proc/self/maps
+    SIG_IMAGE_NAMES,       // dyld image paths and Mach-O segment names
+    // Exact names, looked up by minimal perfect hash
+    SIG_ENV_VARS,          // environment variable names
+    SIG_PACKAGES,          // root manager / hiding app package names
+    // Ordered lists
+    SIG_SYMBOLS,           // symbols probed with dlsym()
+    SIG_PATHS,             // indicator paths; tag is an INDICATOR_* group
+    SIG_SET_COUNT
+};
+
+enum SigSetKind {
+    SIG_KIND_PATTERNS,
+    SIG_KIND_EXACT,
+    SIG_KIND_LIST,
+};
+
+SigSetKind sig_set_kind(SigSetId id);
+
+struct SigDbSection {
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct SigDbHeader {
+    char magic[8];
+    uint32_t crc32;
+    uint32_t formatVersion;
+    uint32_t revision;   // of the content; the built-in set is 0
+    uint32_t size;       // whole image
+    SigDbSection sections[SIG_SET_COUNT];
+};
+
+struct SigStringSet {
+    uint32_t count;
+    uint32_t seed;         // exact sets: hash seed
+    uint32_t bucketCount;  // exact sets: uint32 displacements after the entries
+    uint32_t poolSize;
+};
+
+struct SigString {
+    uint32_t offset;  // into the pool
+    uint16_t length;
+    uint16_t tag;
+};
+
+// A validated image. Immutable, and safe to share between threads; the
+// strings it hands out live as long as the SigDb.
+class SigDb {
+public:
+    // Map `path` read-only and validate it. Returns nullptr if the file
+    // cannot be mapped or is not a well-formed image of this format version.
+    static std::shared_ptr<const SigDb> open(const char* path);
+    // Validate an image in memory; the bytes are taken over, not copied.
+    static std::shared_ptr<const SigDb> fromImage(std::vector<uint64_t>&& image);
+
+    ~SigDb();
+    SigDb(const SigDb&) = delete;
+    SigDb& operator=(const SigDb&) = delete;
+
+    uint32_t revision() const { return header->revision; }
+
+    // Pattern sets
+    const PatternMatcher& matcher(SigSetId id) const { return matchers[id]; }
+
+    // Exact sets
+    bool contains(SigSetId id, const char* str, size_t len) const;
+
+    // All string sets; exact sets are in hash order
+    size_t count(SigSetId id) const { return sets[id].count; }
+    const char* string(SigSetId id, size_t index) const;
+    unsigned int tag(SigSetId id, size_t index) const;
+
+    // Bit i is set if SIG_PATHS entry i exists; only entries whose tag is in
+    // `groups` are probed (see PathProber).
+    uint64_t probePaths(unsigned int groups) const;
+
+private:
+    struct StringSet {
+        const SigString* entries = nullptr;
+        const uint32_t* displacements = nullptr;
+        const char* pool = nullptr;
+        uint32_t count = 0;
+        uint32_t seed = 0;
+        uint32_t bucketCount = 0;
+    };
+
+    SigDb() = default;
+    bool validate();
+    bool loadStrings(SigSetId id, const uint8_t* data, size_t len);
+
+    const SigDbHeader* header = nullptr;
+    const uint8_t* base = nullptr;
+    size_t size = 0;
+    void* map = nullptr;             // set when mapped from a file
+    std::vector<uint64_t> heap;      // set when built in memory
+
+    PatternMatcher matchers[SIG_ENV_VARS];  // pattern sets come first
+    StringSet sets[SIG_SET_COUNT];
+    std::unique_ptr<PathProber> prober;
+    std::vector<const char*> paths;
+};
+
+// Builds images. Entries keep their insertion order in lists.
+class SigDbBuilder {
+public:
+    void setRevision(uint32_t revision) { rev = revision; }
+
+    // Returns false if the entry cannot be stored: empty, longer than
+    // SIG_DB_MAX_STRING, containing a NUL, a duplicate in an exact set, or
+    // over a set's limit (64 patterns, PathProber::MAX_PATHS paths).
+    bool add(SigSetId id, const std::string& value, unsigned int tag = 0);
+
+    // Returns false if a pattern set is over the matcher's size limit, or
+    // if no perfect hash is found, which for distinct keys does not happen
+    // in practice.
+    bool build(std::vector<uint64_t>& image) const;
+
+private:
+    uint32_t rev = 0;
+    std::vector<std::pair<std::string, unsigned int>> entries[SIG_SET_COUNT];
+};
+
+// The set the detectors use: the last one loaded, or the built-in set.
+// Callers hold the pointer for the duration of one check, so a reload never
+// pulls a set out from under a running scan.
+std::shared_ptr<const SigDb> sig_db_active();
+
+// Load an image file and make it active. Fails, keeping the active set, if
+// the file is invalid or its revision is lower than the active one. Results
+// cached from the old set are not touched; security_core_load_signatures()
+// fences them off with check_cache_invalidate_all() after the swap.
+bool sig_db_load(const char* path);
@@ -0,0 +1,60 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+#include <vector>
+
+// Bounded single-producer/single-consumer ring. Slots are reused in place:
+// the producer fills the slot from producerSlot() and publishes it with
+// push(); the consumer reads published slots with peek(i) and hands them
+// back with pop(n). Neither side locks, and nothing is allocated after
+// construction (a T that keeps its capacity, like std::string, stops
+// allocating once the ring is warm; the consumer may trim a slot before
+// pop() to bound what idle slots hold).
+template <typename T>
+class SpscRing {
+public:
+    // capacity is rounded up to a power of two.
+    explicit SpscRing(size_t capacity) : slots(round_up(capacity)), mask(slots.size() - 1) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    size_t capacity() const { return slots.size(); }
+
+    // ========== Producer ==========
+    // Returns the next free slot, or nullptr when the ring is full.
+    T* producerSlot() {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - headCache == slots.size()) {
+            headCache = head.load(std::memory_order_acquire);
+            if (t - headCache == slots.size()) return nullptr;
+        }
+        return &slots[t & mask];
+    }
+
+    void push() { tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    // ========== Consumer ==========
+    size_t available() const { return tail.load(std::memory_order_acquire) - head.load(std::memory_order_relaxed); }
+
+    T& peek(size_t i) { return slots[(head.load(std::memory_order_relaxed) + i) & mask]; }
+
+    void pop(size_t n) { head.store(head.load(std::memory_order_relaxed) + n, std::memory_order_release); }
+
+private:
+    static size_t round_up(size_t n) {
+        size_t p = 2;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    // head and tail sit on separate cache lines so the two threads do not
+    // invalidate each other's line on every operation.
+    std::atomic<size_t> head{0};
+    char headPad[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> tail{0};
+    size_t headCache = 0;  // producer's last view of head
+    char tailPad[64 - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+    std::vector<T> slots;
+    size_t mask;
+};
@@ -0,0 +1,43 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small fixed-size worker pool shared by the parallel code paths
+// (CRC32, integrity verification, check scheduling).
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threadCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queue a task. Tasks must not throw.
+    void submit(std::function<void()> task);
+
+    // Run fn(0) .. fn(count - 1) across the pool. The calling thread takes
+    // part in the work, so this is safe to call from inside a pool task.
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+    size_t size() const { return workers.size(); }
+
+    // True when called from a worker of any ThreadPool. Code that blocks on
+    // pool work should run it inline instead, or it may wait on itself.
+    static bool isWorkerThread();
+
+    // Process-wide pool with 2-4 workers, created on first use.
+    static ThreadPool& shared();
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+
+    void workerLoop();
+};
@@ -0,0 +1,72 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <string>
+
+struct z_stream_s;
+
+// permessage-deflate (RFC 7692) codecs for one connection.
+//
+// zlib streams are expensive to set up (a deflater with a 32 KiB window
+// allocates ~256 KiB), so they come from a process-wide pool and go back
+// to it, reset, when the connection ends. Within a connection the same
+// stream is used for every message: with context takeover its history
+// carries over, without it the stream is reset, never reallocated.
+class WsDeflater {
+public:
+    WsDeflater() = default;
+    ~WsDeflater() { end(); }
+
+    WsDeflater(const WsDeflater&) = delete;
+    WsDeflater& operator=(const WsDeflater&) = delete;
+
+    // windowBits 9..15 (zlib cannot produce raw streams with an 8-bit window).
+    bool begin(int windowBits, int level, bool contextTakeover);
+    void end();
+    bool active() const { return stream != nullptr; }
+
+    // Compress one message and append it to out, without the trailing
+    // 00 00 FF FF that RFC 7692 strips. Returns false on a zlib error.
+    bool compress(const uint8_t* data, size_t len, std::string& out) { return compressChunk(data, len, true, out); }
+    // The same for a message given in pieces; last marks its final piece.
+    // Earlier pieces may produce no output yet.
+    bool compressChunk(const uint8_t* data, size_t len, bool last, std::string& out);
+
+private:
+    z_stream_s* stream = nullptr;
+    int windowBits = 0;
+    int level = 0;
+    bool takeover = true;
+};
+
+class WsInflater {
+public:
+    WsInflater() = default;
+    ~WsInflater() { end(); }
+
+    WsInflater(const WsInflater&) = delete;
+    WsInflater& operator=(const WsInflater&) = delete;
+
+    bool begin(bool contextTakeover);
+    void end();
+    bool active() const { return stream != nullptr; }
+
+    // Decompress one complete message into out (replaced). Fails on corrupt
+    // input or when the result would exceed maxSize.
+    bool decompress(const uint8_t* data, size_t len, size_t maxSize, std::string& out);
+
+    // Receives decompressed output; returning false aborts decompression.
+    typedef std::function<bool(const char* data, size_t len)> Sink;
+    // Decompress a message given in pieces, passing output to sink in
+    // pieces of at most 64 KiB, so memory stays constant whatever the
+    // message size. last marks the message's final piece.
+    bool decompressChunk(const uint8_t* data, size_t len, bool last, const Sink& sink);
+
+private:
+    bool inflateInto(const uint8_t* data, size_t len, const Sink& sink);
+
+    z_stream_s* stream = nullptr;
+    bool takeover = true;
+    std::string window;  // output buffer for decompressChunk()
+};
@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "WebSocketListener.h"
+#include "spsc_ring.h"
+
+// How received messages reach the listener.
+struct WebSocketDelivery {
+    enum Backpressure {
+        BLOCK,  // the I/O thread waits for room, so the socket stops reading
+        DROP    // the new message is discarded and counted
+    };
+    size_t capacity = 1024;  // queued events, rounded up to a power of two
+    size_t batchSize = 64;   // most messages handed over per onMessageBatch call
+    Backpressure whenFull = BLOCK;
+};
+
+// Carries listener events from the I/O thread to a dispatcher thread over
+// an SpscRing, in order. Only one thread may post at a time. Only complete
+// messages are ever dropped; every other event, streamed chunks included,
+// waits for room.
+class WsDispatcher {
+public:
+    WsDispatcher() = default;
+    ~WsDispatcher() { stop(); }
+
+    WsDispatcher(const WsDispatcher&) = delete;
+    WsDispatcher& operator=(const WsDispatcher&) = delete;
+
+    void setListener(WebSocketListener* listener);
+    // Starts the dispatcher thread; options apply only to the first call.
+    void start(const WebSocketDelivery& options);
+    // Discards queued events, releases a blocked producer and joins.
+    void stop();
+
+    // True when the listener takes messages through onMessageChunk.
+    bool streaming() const;
+
+    void postOpen();
+    // Returns false when the message was dropped.
+    bool postMessage(const char* data, size_t length, bool binary);
+    void postBegin(bool binary);
+    void postChunk(const char* data, size_t length);
+    void postEnd();
+    void postClose(int code, const std::string& reason);
+    void postError(const std::string& error);
+
+    uint64_t dropped() const { return droppedCount.load(std::memory_order_relaxed); }
+
+private:
+    enum Kind { EVENT_OPEN, EVENT_MESSAGE, EVENT_BEGIN, EVENT_CHUNK, EVENT_END, EVENT_CLOSE, EVENT_ERROR };
+
+    struct Event {
+        Kind kind;
+        int code;          // close code, or 1 for a binary message
+        std::string data;  // payload, close reason or error; keeps up to 16 KiB of capacity
+    };
+
+    void postSimple(Kind kind, int code, const char* data, size_t length);
+
+    Event* claim(bool mayDrop);
+    void publish();
+    size_t waitForEvents();
+    void release(size_t count);
+    void run();
+    void deliver(const Event& event);
+    void deliverMessages(size_t count);
+
+    std::atomic<WebSocketListener*> listener{nullptr};
+    WebSocketDelivery options;
+    std::unique_ptr<SpscRing<Event>> ring;
+    std::thread thread;
+    std::atomic<bool> stopping{false};
+    std::atomic<uint64_t> droppedCount{0};
+
+    // Only for sleeping; the ring itself is lock-free.
+    std::mutex mutex;
+    std::condition_variable readyCv;  // consumer waits for events
+    std::condition_variable spaceCv;  // producer waits for room
+    std::atomic<bool> consumerWaiting{false};
+    std::atomic<bool> producerWaiting{false};
+
+    std::vector<WebSocketMessage> batch;  // dispatcher thread only
+};
@@ -0,0 +1,73 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// RFC 6455 frame codec working on caller-owned buffers: header encoding,
+// in-place parsing and payload masking.
+
+enum WsOpcode {
+    WS_OP_CONTINUATION = 0x0,
+    WS_OP_TEXT = 0x1,
+    WS_OP_BINARY = 0x2,
+    WS_OP_CLOSE = 0x8,
+    WS_OP_PING = 0x9,
+    WS_OP_PONG = 0xA
+};
+
+// ========== Masking ==========
+// out[i] = in[i] ^ key[i % 4]. out may equal in. The key is the 4 masking
+// bytes in wire order, loaded as a native uint32_t (memcpy).
+typedef void (*ws_mask_kernel_fn)(uint8_t* out, const uint8_t* in, size_t len, uint32_t key);
+
+enum WsMaskKernel {
+    WS_MASK_KERNEL_SCALAR = 0,  // 8 bytes per iteration
+    WS_MASK_KERNEL_SSE2,
+    WS_MASK_KERNEL_AVX2,
+    WS_MASK_KERNEL_NEON,
+    WS_MASK_KERNEL_COUNT
+};
+
+// Mask (or unmask) with the fastest kernel this CPU supports, selected once
+// and checked against the scalar kernel before it is trusted.
+void ws_mask(uint8_t* out, const uint8_t* in, size_t len, const uint8_t key[4]);
+
+WsMaskKernel ws_mask_active_kernel();
+// Returns the kernel for `kind`, or nullptr if this CPU lacks it.
+ws_mask_kernel_fn ws_mask_kernel(WsMaskKernel kind);
+const char* ws_mask_kernel_name(WsMaskKernel kind);
+
+// ========== Frames ==========
+static const size_t WS_MAX_HEADER_SIZE = 14;
+
+// Writes the header of a masked (client) frame to out, which must hold
+// WS_MAX_HEADER_SIZE bytes. rsv goes into bits 4-6 of the first byte.
+// Returns the header length; the payload follows, masked with `mask`.
+size_t ws_encode_header(uint8_t* out, uint8_t opcode, bool fin, uint8_t rsv, uint64_t payloadLen,
+                        const uint8_t mask[4]);
+
+struct WsFrame {
+    uint8_t opcode;
+    uint8_t rsv;       // RSV1-3 as bits 2..0 (RSV1 = 4)
+    bool fin;
+    bool masked;
+    uint8_t* payload;  // into the parsed buffer, already unmasked
+    size_t length;
+    size_t size;       // header + payload: bytes to skip to the next frame
+};
+
+enum WsParseStatus {
+    WS_PARSE_OK,
+    WS_PARSE_INCOMPLETE,  // need more bytes
+    WS_PARSE_ERROR
+};
+
+// Parse the frame at the start of data[0..len) without copying: the frame
+// points into data, and a masked payload is unmasked in place. On error,
+// *error names the problem.
+WsParseStatus ws_parse_frame(uint8_t* data, size_t len, size_t maxPayload, WsFrame* frame, const char** error);
+
+// Parse only the header, for payloads consumed as they arrive. On OK,
+// frame->size is the header length and frame->length the full payload
+// length; frame->payload points past the header but the payload may not
+// be in data yet, and is not unmasked.
+WsParseStatus ws_parse_header(uint8_t* data, size_t len, WsFrame* frame, const char** error);
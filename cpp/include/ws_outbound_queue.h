@@ -0,0 +1,95 @@
+#pragma once
+#include <deque>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// Where outgoing messages wait while the socket is busy or down.
+struct WebSocketQueue {
+    size_t memoryBytes = 4 * 1024 * 1024;   // held in memory before spilling
+    std::string spillPath;                  // segment file prefix; empty drops what memory cannot hold
+    size_t segmentBytes = 4 * 1024 * 1024;  // size of one segment file
+    size_t spillBytes = 64 * 1024 * 1024;   // all segment files together
+};
+
+// A message on its way out. Until it is framed, bytes holds
+// WS_MAX_HEADER_SIZE bytes of headroom followed by the payload; framing
+// writes the header into the headroom and masks the payload in place.
+// offset is where the bytes still to be sent start.
+struct WsOutgoing {
+    std::string bytes;
+    size_t offset = 0;
+    uint8_t opcode = 0;
+    bool fin = true;
+    bool streamed = false;   // a piece of a beginMessage() stream
+    size_t streamBytes = 0;  // counted against the stream window until written
+    bool fromOutbox = false; // framed by the client; resent if its connection drops first
+
+    static WsOutgoing make(uint8_t opcode, const char* data, size_t len);
+};
+
+// FIFO of unframed messages. The oldest stay in memory up to memoryBytes;
+// once that is spent, newer ones are appended to memory-mapped segment
+// files, and everything keeps going to disk until the files drain, so
+// order is kept. Drained segments are deleted, except the last, which is
+// emptied and reused. Not thread-safe.
+class WsOutboundQueue {
+public:
+    WsOutboundQueue() = default;
+    // Deletes the segment files; their messages are lost.
+    ~WsOutboundQueue();
+
+    WsOutboundQueue(const WsOutboundQueue&) = delete;
+    WsOutboundQueue& operator=(const WsOutboundQueue&) = delete;
+
+    // Takes effect for messages pushed from now on.
+    void configure(const WebSocketQueue& options);
+
+    // Returns false when neither memory nor disk has room, or a segment
+    // cannot be written. force ignores both limits, for messages that are
+    // bounded some other way.
+    bool push(WsOutgoing&& message, bool force);
+
+    bool empty() const { return mem.empty() && spilledCount == 0; }
+    // The oldest message, or nullptr. The caller may move from it; pop()
+    // then removes it.
+    WsOutgoing* front();
+    void pop();
+    // Puts a message taken off the front back there, in memory whatever
+    // the limits; the caller bounds how much comes back.
+    void unshift(WsOutgoing&& message);
+
+    size_t memoryUsed() const { return memBytes; }
+    size_t spilled() const { return spilledCount; }
+    // Sum of streamBytes over the queued messages.
+    size_t streamBytes() const { return streamTotal; }
+
+private:
+    struct Segment {
+        int fd;
+        uint8_t* map;
+        size_t size;
+        size_t readPos;
+        size_t writePos;
+        std::string path;
+    };
+
+    bool spill(const WsOutgoing& message, bool force);
+    Segment* addSegment(size_t minSize, bool force);
+    void removeFrontSegment();
+    void loadHead();
+
+    WebSocketQueue options;
+    std::deque<WsOutgoing> mem;
+    size_t memBytes = 0;
+    std::deque<Segment> segments;
+    size_t segmentTotal = 0;   // mapped bytes over all segments
+    size_t spilledCount = 0;
+    unsigned nextSegment = 0;
+    size_t streamTotal = 0;
+
+    // front() of the spilled part, read out of its segment
+    WsOutgoing head;
+    bool headReady = false;
+    size_t headRecord = 0;
+};
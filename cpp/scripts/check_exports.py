@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+
+# ========== Export Collision Check ==========
+# Fails if the library defines a global symbol that zlib also exports.
+# Apps link zlib next to SecurityCore (and the library links it itself for
+# permessage-deflate), so a clash either breaks the build or silently
+# rebinds zlib's callers to our code. Shared libraries are checked through
+# their dynamic symbol table, archives through every global symbol.
+#
+# Usage: check_exports.py NM path/to/libSecurityCore.{so,a}
+
+import subprocess
+import sys
+
+# zlib 1.3 exports, exact names
+ZLIB_SYMBOLS = {
+    "adler32", "adler32_combine", "adler32_combine64", "adler32_z",
+    "compress", "compress2", "compressBound",
+    "crc32", "crc32_combine", "crc32_combine64", "crc32_combine_gen",
+    "crc32_combine_gen64", "crc32_combine_op", "crc32_z",
+    "get_crc_table", "uncompress", "uncompress2",
+    "zError", "zlibCompileFlags", "zlibVersion",
+}
+# ...and every name in these families
+ZLIB_PREFIXES = ("deflate", "inflate", "gz", "_tr_", "z_")
+
+
+def fail(message):
+    print("[❌] check_exports: " + message, file=sys.stderr)
+    sys.exit(1)
+
+
+def defined_globals(nm, path):
+    flags = ["-D"] if ".so" in path else ["-g"]
+    try:
+        out = subprocess.check_output([nm] + flags + ["--defined-only", path], universal_newlines=True)
+    except (OSError, subprocess.CalledProcessError) as e:
+        fail("cannot list symbols of %s: %s" % (path, e))
+    names = set()
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) < 3:
+            continue  # archive member headers and blank lines
+        name = parts[2].split("@")[0]
+        if sys.platform == "darwin" and name.startswith("_"):
+            name = name[1:]
+        names.add(name)
+    return names
+
+
+def main():
+    if len(sys.argv) != 3:
+        fail("usage: check_exports.py NM LIBRARY")
+    nm, path = sys.argv[1], sys.argv[2]
+    clashes = sorted(n for n in defined_globals(nm, path) if n in ZLIB_SYMBOLS or n.startswith(ZLIB_PREFIXES))
+    if clashes:
+        fail("%s defines zlib symbols: %s" % (path, ", ".join(clashes)))
+    print("[✅] No zlib symbol collisions: %s" % path)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+
+# ========== Integrity Manifest Sealer ==========
+# Post-link step for libSecurityCore.so: records the CRC32 of every 4 KiB
+# page of the read-only PT_LOAD segments into the .sc_manifest section.
+# Layout must match sc_manifest in include/integrity_manifest.h.
+#
+# Usage: seal_manifest.py path/to/libSecurityCore.so
+
+import struct
+import sys
+import zlib
+
+MAGIC = b"SCMANIF1"
+VERSION = 1
+PAGE_SIZE = 4096
+MAX_SEGMENTS = 8
+MAX_PAGES = 4096
+SECTION_NAME = b".sc_manifest"
+
+PT_LOAD = 1
+PF_W = 0x2
+
+
+def fail(message):
+    print("[❌] seal_manifest: " + message, file=sys.stderr)
+    sys.exit(1)
+
+
+def parse_elf(data):
+    if data[:4] != b"\x7fELF":
+        fail("not an ELF file")
+    is64 = data[4] == 2
+    if data[5] != 1:
+        fail("only little-endian ELF is supported")
+
+    if is64:
+        (e_phoff, e_shoff) = struct.unpack_from("<QQ", data, 0x20)
+        (e_phentsize, e_phnum, e_shentsize, e_shnum, e_shstrndx) = struct.unpack_from("<HHHHH", data, 0x36)
+    else:
+        (e_phoff, e_shoff) = struct.unpack_from("<II", data, 0x1C)
+        (e_phentsize, e_phnum, e_shentsize, e_shnum, e_shstrndx) = struct.unpack_from("<HHHHH", data, 0x2A)
+
+    segments = []
+    for i in range(e_phnum):
+        off = e_phoff + i * e_phentsize
+        if is64:
+            (p_type, p_flags, p_offset, p_vaddr, _, p_filesz, _, _) = struct.unpack_from("<IIQQQQQQ", data, off)
+        else:
+            (p_type, p_offset, p_vaddr, _, p_filesz, _, p_flags, _) = struct.unpack_from("<IIIIIIII", data, off)
+        if p_type == PT_LOAD:
+            segments.append((p_flags, p_offset, p_vaddr, p_filesz))
+
+    sections = []
+    for i in range(e_shnum):
+        off = e_shoff + i * e_shentsize
+        if is64:
+            (sh_name, _, _, _, sh_offset, sh_size) = struct.unpack_from("<IIQQQQ", data, off)
+        else:
+            (sh_name, _, _, _, sh_offset, sh_size) = struct.unpack_from("<IIIIII", data, off)
+        sections.append((sh_name, sh_offset, sh_size))
+
+    manifest_offset = None
+    if e_shstrndx < len(sections):
+        strtab_offset = sections[e_shstrndx][1]
+        for (sh_name, sh_offset, sh_size) in sections:
+            start = strtab_offset + sh_name
+            name = data[start:data.index(b"\0", start)]
+            if name == SECTION_NAME:
+                manifest_offset = sh_offset
+                break
+    if manifest_offset is None:
+        fail("section %s not found" % SECTION_NAME.decode())
+    return segments, manifest_offset
+
+
+def main():
+    if len(sys.argv) != 2:
+        fail("usage: seal_manifest.py <library.so>")
+    path = sys.argv[1]
+    with open(path, "rb") as f:
+        data = bytearray(f.read())
+
+    segments, manifest_offset = parse_elf(data)
+    if data[manifest_offset:manifest_offset + 8] != MAGIC:
+        fail("manifest magic mismatch")
+
+    records = []
+    page_crc = []
+    for (p_flags, p_offset, p_vaddr, p_filesz) in segments:
+        if p_flags & PF_W:
+            continue
+        if p_offset <= manifest_offset < p_offset + p_filesz:
+            fail("manifest must not live in a read-only segment")
+        first_page = len(page_crc)
+        for start in range(0, p_filesz, PAGE_SIZE):
+            chunk = data[p_offset + start:p_offset + min(start + PAGE_SIZE, p_filesz)]
+            page_crc.append(zlib.crc32(chunk) & 0xFFFFFFFF)
+        records.append((p_vaddr, p_filesz, first_page, len(page_crc) - first_page))
+
+    if len(records) > MAX_SEGMENTS:
+        fail("too many read-only segments (%d)" % len(records))
+    if len(page_crc) > MAX_PAGES:
+        fail("library too large for manifest (%d pages)" % len(page_crc))
+
+    header = struct.pack("<8sIIIIII", MAGIC, VERSION, 1, PAGE_SIZE, len(records), len(page_crc), 0)
+    body = b"".join(struct.pack("<QQII", *r) for r in records)
+    body += b"\0" * (24 * (MAX_SEGMENTS - len(records)))
+    body += struct.pack("<%dI" % len(page_crc), *page_crc)
+    blob = header + body
+    data[manifest_offset:manifest_offset + len(blob)] = blob
+
+    with open(path, "wb") as f:
+        f.write(data)
+    print("[✅] Sealed %d pages in %d segments: %s" % (len(page_crc), len(records), path))
+
+
+if __name__ == "__main__":
+    main()
@@ -48,7 +48,7 @@ echo "    - detect_code_injection()"
 echo ""
 echo "  🔧 Utility functions:"
 echo "    - xor_decode()"
-echo "    - crc32()"
+echo "    - sc_crc32()"
 echo "    - start_self_heal()"
 
 echo "[✅] Test completed successfully!"
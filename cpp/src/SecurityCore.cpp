@@ -1,53 +1,199 @@
 #include "SecurityCore.h"
+#include "crc32_engine.h"
+#include "fd_reader.h"
+#include "file_manifest.h"
+#include "integrity_manifest.h"
+#include "obfuscated_string.h"
+#include "pattern_matcher.h"
+#include "procfs_reader.h"
+#include "root_checker.h"
+#include "sig_db.h"
+#include "check_scheduler.h"
+#include "check_cache.h"
+#include "check_stats.h"
+#include "thread_pool.h"
+#include "monitor.h"
 
 #include <unistd.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
-#if !defined(__APPLE__) || defined(__ANDROID__)
-#include <sys/ptrace.h>
-#endif
 #include <fcntl.h>
 #include <cstring>
 #include <dirent.h>
 #include <thread>
 #include <chrono>
+#include <memory>
+#include <mutex>
 #include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+#include <openssl/evp.h>
 
 #if defined(__APPLE__) && !defined(__ANDROID__)
 #include <mach-o/dyld.h>
 #include <mach-o/getsect.h>
+#include <crt_externs.h>
 #include <dlfcn.h>
 #endif
 
 #if defined(__ANDROID__)
 #include <android/log.h>
 #include <sys/system_properties.h>
-#define LOG(...) __android_log_print(ANDROID_LOG_INFO, "SecurityCore", "%s", )
+#define LOG(...) __android_log_print(ANDROID_LOG_INFO, "SecurityCore", __VA_ARGS__)
 #else
 #define LOG(...) printf(__VA_ARGS__)
 #endif
 
 // ========== XOR Decryption ==========
+size_t xor_decode_r(const char* enc, char key, char* out, size_t out_size) {
+    uint8_t keys[16];
+    memset(keys, (unsigned char)key, sizeof(keys));
+    size_t len = strlen(enc);
+    if (out_size == 0) return len;
+    size_t n = len < out_size - 1 ? len : out_size - 1;
+    obfuscated_xor(out, enc, keys, n);
+    out[n] = '\0';
+    return len;
+}
+
+// Per-thread buffer, grown to fit: safe to call from concurrent detectors.
 const char* xor_decode(const char* enc, char key) {
-    static char buf[128];
-    int i = 0;
-    while (enc[i]) {
-        buf[i] = enc[i] ^ key;
-        i++;
-    }
-    buf[i] = '\0';
-    return buf;
+    static thread_local std::vector<char> buf;
+    buf.resize(strlen(enc) + 1);
+    xor_decode_r(enc, key, buf.data(), buf.size());
+    return buf.data();
 }
 
 // ========== CRC32 ==========
-unsigned int crc32(unsigned char* data, size_t len) {
-    unsigned int crc = 0xFFFFFFFF;
-    for (size_t i = 0; i < len; ++i) {
-        crc ^= data[i];
-        for (int j = 0; j < 8; ++j)
-            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+// Dispatches to the fastest kernel for this CPU (see crc32_engine.cpp).
+unsigned int sc_crc32(unsigned char* data, size_t len) {
+    return ~crc32_engine_update(0xFFFFFFFFu, data, len);
+}
+
+void crc32_init(crc32_ctx* ctx) {
+    ctx->state = 0xFFFFFFFFu;
+    ctx->length = 0;
+}
+
+void crc32_update(crc32_ctx* ctx, const unsigned char* data, size_t len) {
+    ctx->state = crc32_engine_update(ctx->state, data, len);
+    ctx->length += len;
+}
+
+unsigned int crc32_final(crc32_ctx* ctx) {
+    return ~ctx->state;
+}
+
+unsigned int sc_crc32_combine(unsigned int crc1, unsigned int crc2, unsigned long long len2) {
+    return crc32_engine_combine(crc1, crc2, len2);
+}
+
+// Below this size per worker, thread handoff costs more than it saves.
+static const size_t CRC32_PARALLEL_MIN_CHUNK = 256 * 1024;
+
+unsigned int crc32_parallel(const unsigned char* data, size_t len, unsigned int max_threads) {
+    ThreadPool& pool = ThreadPool::shared();
+    size_t chunks = max_threads ? max_threads : pool.size() + 1;
+    chunks = std::min(chunks, len / CRC32_PARALLEL_MIN_CHUNK);
+    if (chunks <= 1) {
+        return ~crc32_engine_update(0xFFFFFFFFu, data, len);
+    }
+
+    // Chunks are 64-byte aligned in size so every worker stays on the
+    // kernel's fast path; the last one takes the remainder.
+    size_t chunk_len = (len / chunks) & ~(size_t)63;
+    std::vector<unsigned int> partial(chunks);
+    pool.parallelFor(chunks, [&](size_t i) {
+        size_t offset = i * chunk_len;
+        size_t n = (i == chunks - 1) ? len - offset : chunk_len;
+        partial[i] = ~crc32_engine_update(0xFFFFFFFFu, data + offset, n);
+    });
+
+    unsigned int crc = partial[0];
+    for (size_t i = 1; i < chunks; ++i) {
+        size_t n = (i == chunks - 1) ? len - i * chunk_len : chunk_len;
+        crc = crc32_engine_combine(crc, partial[i], n);
+    }
+    return crc;
+}
+
+// ========== Hashing ==========
+void sha256_digest(const unsigned char* data, size_t len, unsigned char out[SC_SHA256_LENGTH]) {
+    EVP_Digest(data, len, out, nullptr, EVP_sha256(), nullptr);
+}
+
+struct Crc32FdState {
+    unsigned int crc;
+};
+
+static bool crc32_fd_chunk(const unsigned char* data, size_t len, void* userdata) {
+    Crc32FdState* state = (Crc32FdState*)userdata;
+    state->crc = crc32_engine_combine(state->crc, crc32_parallel(data, len, 0), len);
+    return true;
+}
+
+bool crc32_fd(int fd, unsigned int* out) {
+    Crc32FdState state = {0};
+    if (!fd_read_chunks(fd, crc32_fd_chunk, &state)) return false;
+    *out = state.crc;
+    return true;
+}
+
+// sha256_ctx is the EVP context itself; the struct is never defined.
+sha256_ctx* sha256_init() {
+    EVP_MD_CTX* md = EVP_MD_CTX_new();
+    if (md && EVP_DigestInit_ex(md, EVP_sha256(), nullptr) != 1) {
+        EVP_MD_CTX_free(md);
+        md = nullptr;
     }
-    return ~crc;
+    return (sha256_ctx*)md;
+}
+
+bool sha256_update(sha256_ctx* ctx, const unsigned char* data, size_t len) {
+    return EVP_DigestUpdate((EVP_MD_CTX*)ctx, data, len) == 1;
+}
+
+bool sha256_final(sha256_ctx* ctx, unsigned char out[SC_SHA256_LENGTH]) {
+    EVP_MD_CTX* md = (EVP_MD_CTX*)ctx;
+    bool ok = EVP_DigestFinal_ex(md, out, nullptr) == 1;
+    EVP_MD_CTX_free(md);
+    return ok;
+}
+
+static bool sha256_fd_chunk(const unsigned char* data, size_t len, void* userdata) {
+    return sha256_update((sha256_ctx*)userdata, data, len);
+}
+
+bool sha256_fd(int fd, unsigned char out[SC_SHA256_LENGTH]) {
+    sha256_ctx* ctx = sha256_init();
+    if (!ctx) return false;
+    bool ok = fd_read_chunks(fd, sha256_fd_chunk, ctx);
+    return sha256_final(ctx, out) && ok;
+}
+
+bool verify_package_files(const sc_file_digest* files, size_t count, const char* cache_path,
+                          sc_file_status* statuses) {
+    return file_manifest_verify(files, count, cache_path, statuses);
+}
+
+// ========== Signatures ==========
+bool security_core_load_signatures(const char* path) {
+    if (!path || !sig_db_load(path)) return false;
+    // Cached verdicts, and the stores of probes already running, were reached
+    // with the old signatures. The fence goes after the swap: a probe whose
+    // ticket carries the new generation began after it and reads the new set.
+    // Only report the update once both are fenced off.
+    check_cache_invalidate_all();
+    return true;
+}
+
+unsigned int security_core_signature_revision() {
+    return sig_db_active()->revision();
+}
+
+bool security_core_is_root_package(const char* package_name) {
+    return package_name && sig_db_active()->contains(SIG_PACKAGES, package_name, strlen(package_name));
 }
 
 // ========== Sensitive Function ==========
@@ -80,27 +226,31 @@ void sensitive_function() {
 }
 
 // ========== Frida Thread Detection ==========
-bool detect_frida_thread() {
 #if !defined(__APPLE__)
-    DIR* dir = opendir("/proc/self/task/");
-    if (!dir) return false;
-
-    struct dirent* entry;
-    char path[64], name[64];
-    while ((entry = readdir(dir)) != NULL) {
-        if (entry->d_type != DT_DIR) continue;
-        snprintf(path, sizeof(path), "/proc/self/task/%s/comm", entry->d_name);
-        FILE* f = fopen(path, "r");
-        if (!f) continue;
-        fgets(name, sizeof(name), f);
-        fclose(f);
-        if (strstr(name, "gum-js-loop")) {
-            closedir(dir);
-            return true;
-        }
+namespace {
+struct ThreadNameScan {
+    const PatternMatcher* matcher;
+    bool found;
+};
+}
+
+static bool on_thread_name(const char* name, size_t len, void* userdata) {
+    ThreadNameScan* scan = (ThreadNameScan*)userdata;
+    if (scan->matcher->scan(name, len) != 0) {
+        scan->found = true;
+        return false;
     }
-    closedir(dir);
-    return false;
+    return true;
+}
+#endif
+
+static bool probe_frida_thread() {
+#if !defined(__APPLE__)
+    // Thread names (/proc/self/task/*/comm) that Frida's agent creates
+    std::shared_ptr<const SigDb> db = sig_db_active();
+    ThreadNameScan scan = {&db->matcher(SIG_THREAD_NAMES), false};
+    procfs_for_each_thread_name(on_thread_name, &scan);
+    return scan.found;
 #else
     // iOS không có /proc/, return false
     return false;
@@ -108,31 +258,30 @@ bool detect_frida_thread() {
 }
 
 // ========== Debugger Detection ==========
-bool detect_debugger() {
-#if !defined(__APPLE__) || defined(__ANDROID__)
-    return ptrace(PTRACE_TRACEME, 0, 0, 0) == -1;
+// TracerPid in /proc/self/status is non-zero while a tracer is attached.
+// Reading it has no side effects, unlike ptrace(PTRACE_TRACEME), which
+// leaves the calling thread traced (and unreapable by anyone but the
+// parent) and fails on every later call, so the probe is repeatable and
+// safe on any thread.
+static bool probe_debugger() {
+#if !defined(__APPLE__)
+    const char* status = procfs_read(PROCFS_STATUS, nullptr);
+    if (!status) return false;
+    auto field = OBF("\nTracerPid:");
+    const char* tracer = strstr(status, field.c_str());
+    return tracer && strtol(tracer + field.size(), nullptr, 10) != 0;
 #else
-    // iOS không hỗ trợ ptrace, return false
+    // iOS không có /proc/self/status, return false
     return false;
 #endif
 }
 
 // ========== Memory Map Check ==========
-bool detect_memory_maps() {
+static bool probe_memory_maps() {
 #if !defined(__APPLE__)
-    FILE* fp = fopen("/proc/self/maps", "r");
-    if (!fp) return false;
-
-    char line[512];
-    const char* pattern = xor_decode("\xD4\xF8\xE3\xC6\xCB", 0xAA);  // "frida"
-    while (fgets(line, sizeof(line), fp)) {
-        if (strstr(line, pattern) != nullptr) {
-            fclose(fp);
-            return true;
-        }
-    }
-    fclose(fp);
-    return false;
+    // Single pass over the whole file; every signature is matched at once.
+    std::shared_ptr<const SigDb> db = sig_db_active();
+    return procfs_scan(PROCFS_MAPS, db->matcher(SIG_MAPS)) != 0;
 #else
     // iOS không có /proc/self/maps, return false
     return false;
@@ -140,14 +289,11 @@ bool detect_memory_maps() {
 }
 
 // ========== Process Name Validation ==========
-bool check_process_name() {
+static bool process_name_matches() {
 #if !defined(__APPLE__)
-    char name[256];
-    FILE* f = fopen("/proc/self/cmdline", "r");
-    if (!f) return false;
-    fgets(name, sizeof(name), f);
-    fclose(f);
-    return strstr(name, "com.app.trusted") != NULL;
+    // argv[0] is the first NUL-terminated string of cmdline
+    const char* name = procfs_read(PROCFS_CMDLINE, nullptr);
+    return name && strstr(name, OBF("com.app.trusted").c_str()) != NULL;
 #else
     // iOS không có /proc/self/cmdline, return true
     return true;
@@ -155,58 +301,168 @@ bool check_process_name() {
 }
 
 // ========== Code Integrity Check ==========
-bool verify_integrity() {
-    void* addr = (void*)&sensitive_function;
-    unsigned char expected[] = {0x90, 0x90, 0xC3}; // nop, nop, ret
-    return memcmp((unsigned char*)addr, expected, sizeof(expected)) == 0;
+// Compares every read-only page of this library against the manifest sealed
+// at build time. Unsealed builds (static archives, iOS where the code
+// signature already covers __TEXT) report intact.
+static bool probe_integrity() {
+    return !integrity_verify_all();
+}
+
+bool verify_integrity_hot(unsigned int sample_pages) {
+    return integrity_verify_hot(sample_pages);
 }
 
 // ========== Self-healing ==========
-void heal_function() {
-    unsigned char expected[] = {0x90, 0x90, 0xC3};
-    void* addr = (void*)&sensitive_function;
+// Bytes of sensitive_function() captured at load, before anything had a
+// chance to patch it; the heal task restores them.
+static const size_t HEAL_BYTES = 16;
+static unsigned char heal_snapshot[HEAL_BYTES];
+
+static unsigned char* sensitive_function_code() {
+    uintptr_t addr = (uintptr_t)&sensitive_function;
+#if defined(__arm__)
+    addr &= ~(uintptr_t)1;  // Thumb bit
+#endif
+    return (unsigned char*)addr;
+}
 
+__attribute__((constructor)) static void capture_heal_snapshot() {
+    memcpy(heal_snapshot, sensitive_function_code(), HEAL_BYTES);
+}
+
+// Pages are writable only for the duration of the copy and go back to
+// read+execute afterwards. Fails where code pages cannot be made writable
+// (iOS code signing, hardened SELinux policies).
+static bool patch_code(unsigned char* addr, const unsigned char* bytes, size_t len) {
     size_t page_size = sysconf(_SC_PAGESIZE);
-    uintptr_t page = (uintptr_t)addr & ~(page_size - 1);
-    mprotect((void*)page, page_size, PROT_READ | PROT_WRITE | PROT_EXEC);
+    uintptr_t first = (uintptr_t)addr & ~(page_size - 1);
+    size_t span = ((uintptr_t)addr + len - first + page_size - 1) & ~(page_size - 1);
+    if (mprotect((void*)first, span, PROT_READ | PROT_WRITE | PROT_EXEC) != 0) return false;
+    memcpy(addr, bytes, len);
+    __builtin___clear_cache((char*)addr, (char*)addr + len);
+    mprotect((void*)first, span, PROT_READ | PROT_EXEC);
+    return true;
+}
+
+// Monitor task: returns true when the function had been tampered with.
+static bool heal_function() {
+    unsigned char* addr = sensitive_function_code();
+    if (memcmp(addr, heal_snapshot, HEAL_BYTES) == 0) return false;
+    LOG("Function tampered! Healing...\n");
+    if (!patch_code(addr, heal_snapshot, HEAL_BYTES)) LOG("Healing failed\n");
+    return true;
+}
+
+// ========== Background Monitor ==========
+static const unsigned int MONITOR_INTEGRITY_SAMPLE_PAGES = 8;
+
+static bool monitor_integrity() {
+    return !verify_integrity_hot(MONITOR_INTEGRITY_SAMPLE_PAGES);
+}
+
+struct MonitorSpec {
+    bool (*task)();
+    unsigned int minIntervalMs;
+    unsigned int maxIntervalMs;
+};
+
+// Indexed by sc_monitor_id. Intervals double while nothing is detected.
+static const MonitorSpec monitor_table[SC_MONITOR_COUNT] = {
+    {heal_function,       1000, 16000},
+    {monitor_integrity,   5000, 60000},
+    {detect_frida_thread, 1000, 16000},
+    {detect_memory_maps,  2000, 30000},
+};
+
+namespace {
+struct MonitorState {
+    std::mutex mutex;
+    int handles[SC_MONITOR_COUNT];
+    sc_monitor_callback callback = nullptr;
+    void* userdata = nullptr;
+    MonitorState() { std::fill(handles, handles + SC_MONITOR_COUNT, 0); }
+};
+}
 
-    while (true) {
-        if (memcmp((unsigned char*)addr, expected, sizeof(expected)) != 0) {
-            LOG("Function tampered! Healing...\n");
-            memcpy((unsigned char*)addr, expected, sizeof(expected));
+static MonitorState& monitor_state() {
+    static MonitorState* state = new MonitorState();
+    return *state;
+}
+
+// Maps Monitor handles back to ids for the C callback.
+static void monitor_listener(int handle) {
+    MonitorState& st = monitor_state();
+    sc_monitor_callback cb;
+    void* userdata;
+    int id = -1;
+    {
+        std::lock_guard<std::mutex> lock(st.mutex);
+        for (int i = 0; i < SC_MONITOR_COUNT; ++i) {
+            if (st.handles[i] == handle) id = i;
         }
-        std::this_thread::sleep_for(std::chrono::seconds(2));
+        cb = st.callback;
+        userdata = st.userdata;
     }
+    if (cb && id >= 0) cb((sc_monitor_id)id, userdata);
 }
 
-// ========== Public Entry ==========
-bool run_advanced_checks() {
-    if (detect_debugger()) {
-        LOG("[!] Debugger detected.\n");
-        return false;
-    }
-    if (detect_frida_thread()) {
-        LOG("[!] Frida thread detected.\n");
-        return false;
-    }
-    if (detect_memory_maps()) {
-        LOG("[!] Memory maps show suspicious patterns.\n");
-        return false;
-    }
-    if (!check_process_name()) {
-        LOG("[!] Process name mismatch.\n");
-        return false;
-    }
-    if (!verify_integrity()) {
-        LOG("[!] Sensitive function was modified.\n");
-        return false;
-    }
-    LOG("[+] All checks passed.\n");
+bool security_core_monitor_enable(sc_monitor_id id, unsigned int min_interval_ms, unsigned int max_interval_ms) {
+    if (id >= SC_MONITOR_COUNT) return false;
+    const MonitorSpec& spec = monitor_table[id];
+    if (min_interval_ms == 0) min_interval_ms = spec.minIntervalMs;
+    if (max_interval_ms == 0) max_interval_ms = std::max(spec.maxIntervalMs, min_interval_ms);
+
+    Monitor& monitor = Monitor::shared();
+    MonitorState& st = monitor_state();
+    std::lock_guard<std::mutex> lock(st.mutex);
+    if (st.handles[id]) monitor.remove(st.handles[id]);
+    st.handles[id] = monitor.add(min_interval_ms, max_interval_ms, spec.task);
     return true;
 }
 
+void security_core_monitor_disable(sc_monitor_id id) {
+    if (id >= SC_MONITOR_COUNT) return;
+    MonitorState& st = monitor_state();
+    std::lock_guard<std::mutex> lock(st.mutex);
+    if (st.handles[id]) Monitor::shared().remove(st.handles[id]);
+    st.handles[id] = 0;
+}
+
+void security_core_monitor_set_callback(sc_monitor_callback callback, void* userdata) {
+    MonitorState& st = monitor_state();
+    std::lock_guard<std::mutex> lock(st.mutex);
+    st.callback = callback;
+    st.userdata = userdata;
+}
+
+void security_core_monitor_start() {
+    static std::once_flag listener_once;
+    std::call_once(listener_once, [] { Monitor::shared().setListener(monitor_listener); });
+    Monitor::shared().start();
+}
+
+void security_core_monitor_stop() {
+    Monitor::shared().stop();
+}
+
+void security_core_monitor_pause() {
+    Monitor::shared().pause();
+}
+
+void security_core_monitor_resume() {
+    Monitor::shared().resume();
+}
+
+// ========== Public Entry ==========
 void start_self_heal() {
-    std::thread(heal_function).detach();
+    MonitorState& st = monitor_state();
+    bool enabled;
+    {
+        std::lock_guard<std::mutex> lock(st.mutex);
+        enabled = st.handles[SC_MONITOR_SELF_HEAL] != 0;
+    }
+    if (!enabled) security_core_monitor_enable(SC_MONITOR_SELF_HEAL, 0, 0);
+    security_core_monitor_start();
 }
 
 // ========== iOS Anti-Frida Detection ==========
@@ -214,10 +470,12 @@ void start_self_heal() {
 // Check for Frida libraries in memory
 bool detect_frida_libraries() {
 #if defined(__APPLE__) && !defined(__ANDROID__)
+    std::shared_ptr<const SigDb> db = sig_db_active();
+    const PatternMatcher& matcher = db->matcher(SIG_IMAGE_NAMES);
     uint32_t count = _dyld_image_count();
     for (uint32_t i = 0; i < count; i++) {
         const char* name = _dyld_get_image_name(i);
-        if (name && (strstr(name, "frida") || strstr(name, "gum") || strstr(name, "gjs"))) {
+        if (name && matcher.scan(name, strlen(name)) != 0) {
             return true;
         }
     }
@@ -225,52 +483,41 @@ bool detect_frida_libraries() {
     return false;
 }
 
-// Check for suspicious environment variables
-bool detect_frida_env() {
-    const char* env_vars[] = {"FRIDA_DNS_SERVER", "FRIDA_EXTRA_ARGS", "FRIDA_LOADER"};
-    for (const char* var : env_vars) {
-        if (getenv(var)) {
-            return true;
-        }
+// Check for suspicious environment variables: one pass over the
+// environment, each name looked up in the perfect hash.
+static bool probe_frida_env() {
+#if defined(__APPLE__) && !defined(__ANDROID__)
+    char** env = *_NSGetEnviron();
+#else
+    char** env = environ;
+#endif
+    std::shared_ptr<const SigDb> db = sig_db_active();
+    for (; env && *env; ++env) {
+        const char* eq = strchr(*env, '=');
+        size_t len = eq ? (size_t)(eq - *env) : strlen(*env);
+        if (db->contains(SIG_ENV_VARS, *env, len)) return true;
     }
     return false;
 }
 
 // Check for suspicious files
-bool detect_frida_files() {
-    const char* suspicious_paths[] = {
-        "/usr/lib/frida",
-        "/usr/lib/frida-gadget.dylib",
-        "/usr/lib/frida-agent.dylib",
-        "/var/root/frida",
-        "/data/local/tmp/fd-server"
-    };
-    
-    for (const char* path : suspicious_paths) {
-        struct stat st;
-        int res = stat(path, &st);
-        LOG("Check path: %s, stat result: %d, errno: %d", path, res, errno);
-        if (res == 0) {
-            return true;
-        }
-    }
-    return false;
+static bool probe_frida_files() {
+    return probe_indicator_paths(INDICATOR_FRIDA_FILES);
 }
 
 // Check for suspicious symbols in memory
-bool detect_frida_symbols() {
+static bool probe_frida_symbols() {
 #if defined(__APPLE__) && !defined(__ANDROID__)
     // Check for Frida symbols in loaded libraries
     void* handle = dlopen(NULL, RTLD_NOW);
     if (handle) {
-        const char* symbols[] = {"frida_agent_main", "gum_init", "gjs_context_eval"};
-        for (const char* symbol : symbols) {
-            if (dlsym(handle, symbol)) {
-                dlclose(handle);
-                return true;
-            }
+        std::shared_ptr<const SigDb> db = sig_db_active();
+        bool found = false;
+        for (size_t i = 0; !found && i < db->count(SIG_SYMBOLS); ++i) {
+            found = dlsym(handle, db->string(SIG_SYMBOLS, i)) != NULL;
         }
         dlclose(handle);
+        if (found) return true;
     }
 #endif
     return false;
@@ -283,12 +530,14 @@ bool detect_code_injection() {
     const struct mach_header_64* header = (const struct mach_header_64*)_dyld_get_image_header(0);
     if (header) {
         // Check for suspicious segments
+        std::shared_ptr<const SigDb> db = sig_db_active();
+        const PatternMatcher& matcher = db->matcher(SIG_IMAGE_NAMES);
         struct load_command* lc = (struct load_command*)((uint8_t*)header + sizeof(struct mach_header_64));
         for (uint32_t i = 0; i < header->ncmds; i++) {
             if (lc->cmd == LC_SEGMENT_64) {
                 struct segment_command_64* seg = (struct segment_command_64*)lc;
                 // Check for suspicious segment names
-                if (strstr(seg->segname, "frida") || strstr(seg->segname, "gum")) {
+                if (matcher.scan(seg->segname, strnlen(seg->segname, sizeof(seg->segname))) != 0) {
                     return true;
                 }
             }
@@ -340,18 +589,11 @@ bool run_ios_security_checks() {
     bool secure = true;
     
     // Check for jailbreak indicators
-    const char* jailbreak_paths[] = {
-        "/Applications/Cydia.app",
-        "/Library/MobileSubstrate/MobileSubstrate.dylib",
-        "/bin/bash",
-        "/usr/sbin/sshd",
-        "/etc/apt"
-    };
-    
-    for (const char* path : jailbreak_paths) {
-        struct stat st;
-        if (stat(path, &st) == 0) {
-            LOG("[!] Jailbreak detected: %s\n", path);
+    std::shared_ptr<const SigDb> db = sig_db_active();
+    uint64_t hits = db->probePaths(INDICATOR_JAILBREAK_BASIC);
+    for (unsigned int i = 0; hits; ++i, hits >>= 1) {
+        if (hits & 1) {
+            LOG("[!] Jailbreak detected: %s\n", db->string(SIG_PATHS, i));
             secure = false;
         }
     }
@@ -359,65 +601,264 @@ bool run_ios_security_checks() {
     return secure;
 }
 
-bool is_rooted() {
+// ========== Root / Jailbreak Probes ==========
 #if defined(__ANDROID__)
-    // 1. Check for root binaries
-    const char* paths[] = {
-        "/system/xbin/su", "/system/bin/su", "/sbin/su", "/system/app/Superuser.apk",
-        "/system/bin/.ext/.su", "/system/usr/we-need-root/su.backup", "/system/xbin/mu", nullptr
-    };
-    for (int i = 0; paths[i]; ++i) {
-        if (access(paths[i], F_OK) == 0) return true;
-    }
-    // 2. Check for dangerous props
+static bool probe_root_paths() {
+    // Root packages (SIG_PACKAGES) need PackageManager; the Java side asks
+    // security_core_is_root_package().
+    return probe_indicator_paths(INDICATOR_ROOT_BINARIES);
+}
+
+static bool probe_system_props() {
     char value[PROP_VALUE_MAX];
-    if (__system_property_get("ro.debuggable", value) && strcmp(value, "1") == 0) return true;
-    if (__system_property_get("ro.secure", value) && strcmp(value, "0") == 0) return true;
-    // 3. Check for RW system
-    FILE* f = fopen("/proc/mounts", "r");
-    if (f) {
-        char line[512];
-        while (fgets(line, sizeof(line), f)) {
-            if (strstr(line, "/system") && strstr(line, "rw")) {
-                fclose(f);
-                return true;
-            }
-        }
-        fclose(f);
-    }
-    // 4. Check for root packages
-    const char* pkgs[] = { "com.noshufou.android.su", "eu.chainfire.supersu", "com.koushikdutta.superuser", "com.zachspong.temprootremovejb", "com.ramdroid.appquarantine", nullptr };
-    // (Optional: check via JNI/Java)
-    // 5. Check for Frida/Xposed
-    if (detect_frida_thread() || detect_memory_maps()) return true;
-    // 6. Check for dangerous files
-    if (access("/data/local/tmp/frida-server", F_OK) == 0) return true;
-    // 7. Anti-debug
-    if (detect_debugger()) return true;
+    if (__system_property_get(OBF("ro.debuggable").c_str(), value) && strcmp(value, "1") == 0) return true;
+    if (__system_property_get(OBF("ro.secure").c_str(), value) && strcmp(value, "0") == 0) return true;
     return false;
+}
+
+static bool probe_frida_server() {
+    return probe_indicator_paths(INDICATOR_FRIDA_SERVER);
+}
 #elif defined(__APPLE__)
-    // 1. Check for jailbreak files
-    const char* paths[] = {
-        "/Applications/Cydia.app", "/Library/MobileSubstrate/MobileSubstrate.dylib", "/bin/bash", "/usr/sbin/sshd", "/etc/apt", "/private/var/lib/apt/", nullptr
-    };
-    for (int i = 0; paths[i]; ++i) {
-        if (access(paths[i], F_OK) == 0) return true;
-    }
-    // 2. Check for sandbox escape
-    FILE* f = fopen("/private/jailbreak.txt", "w");
+static bool probe_jailbreak_paths() {
+    return probe_indicator_paths(INDICATOR_JAILBREAK);
+}
+
+static bool probe_sandbox_escape() {
+    auto probe_file = OBF("/private/jailbreak.txt");
+    FILE* f = fopen(probe_file.c_str(), "w");
     if (f) {
         fclose(f);
-        remove("/private/jailbreak.txt");
+        remove(probe_file.c_str());
         return true;
     }
-    // 3. Check for suspicious dylibs
-    // (Optional: check loaded dylibs)
-    // 4. Check for Frida
-    if (detect_frida_symbols() || detect_frida_env() || detect_frida_files()) return true;
-    // 5. Anti-debug
-    if (detect_debugger()) return true;
     return false;
+}
+#endif
+
+static bool probe_process_name() {
+    return !process_name_matches();
+}
+
+// ========== Check Scheduler ==========
+#if defined(__ANDROID__)
+#define ANDROID_PROBE(fn) fn
 #else
-    return false;
+#define ANDROID_PROBE(fn) nullptr
+#endif
+#if defined(__APPLE__) && !defined(__ANDROID__)
+#define APPLE_PROBE(fn) fn
+#define PROCFS_PROBE(fn) nullptr
+#else
+#define APPLE_PROBE(fn) nullptr
+#define PROCFS_PROBE(fn) fn
+#endif
+
+// Indexed by sc_check_id.
+static const CheckSpec check_table[SC_CHECK_COUNT] = {
+    {SC_CHECK_DEBUGGER, "Debugger", probe_debugger},
+    {SC_CHECK_FRIDA_THREAD, "Frida thread", PROCFS_PROBE(probe_frida_thread)},
+    {SC_CHECK_MEMORY_MAPS, "Suspicious memory map", PROCFS_PROBE(probe_memory_maps)},
+    {SC_CHECK_PROCESS_NAME, "Process name mismatch", probe_process_name},
+    {SC_CHECK_INTEGRITY, "Code modification", probe_integrity},
+    {SC_CHECK_ROOT_PATHS, "Root binary", ANDROID_PROBE(probe_root_paths)},
+    {SC_CHECK_SYSTEM_PROPS, "Insecure system property", ANDROID_PROBE(probe_system_props)},
+    {SC_CHECK_RW_SYSTEM_MOUNT, "RW /system mount", ANDROID_PROBE(detect_rw_system_mount)},
+    {SC_CHECK_FRIDA_SERVER, "frida-server binary", ANDROID_PROBE(probe_frida_server)},
+    {SC_CHECK_JAILBREAK_PATHS, "Jailbreak file", APPLE_PROBE(probe_jailbreak_paths)},
+    {SC_CHECK_SANDBOX_ESCAPE, "Sandbox escape", APPLE_PROBE(probe_sandbox_escape)},
+    {SC_CHECK_FRIDA_SYMBOLS, "Frida symbols", APPLE_PROBE(probe_frida_symbols)},
+    {SC_CHECK_FRIDA_ENV, "Frida environment", APPLE_PROBE(probe_frida_env)},
+    {SC_CHECK_FRIDA_FILES, "Frida files", APPLE_PROBE(probe_frida_files)},
+};
+
+// Serve what we can from the cache: hits are written to out[] and their
+// bits to *hits; the misses, returned as a mask, get a cache ticket.
+static unsigned int lookup_cached(unsigned int mask, sc_check_result* out, CheckCacheTicket* tickets,
+                                  unsigned int* hits, bool* detected) {
+    unsigned int misses = 0;
+    *hits = 0;
+    *detected = false;
+    for (int id = 0; id < SC_CHECK_COUNT; ++id) {
+        if (!(mask & SC_CHECK_BIT(id)) || !check_table[id].probe) continue;
+        bool hit;
+        if (check_cache_lookup((sc_check_id)id, &hit)) {
+            check_stats_record_cache_hit((sc_check_id)id);
+            out[id].status = hit ? SC_STATUS_DETECTED : SC_STATUS_CLEAN;
+            *hits |= SC_CHECK_BIT(id);
+            *detected |= hit;
+        } else {
+            misses |= SC_CHECK_BIT(id);
+            tickets[id] = check_cache_begin((sc_check_id)id);
+        }
+    }
+    return misses;
+}
+
+bool run_checks(unsigned int mask, unsigned int deadline_ms, bool stop_on_detect, sc_check_result* results) {
+    sc_check_result local[SC_CHECK_COUNT];
+    sc_check_result* out = results ? results : local;
+    memset(out, 0, sizeof(sc_check_result) * SC_CHECK_COUNT);
+
+    // Only the cache misses are scheduled.
+    unsigned int hits;
+    bool detected;
+    CheckCacheTicket tickets[SC_CHECK_COUNT];
+    unsigned int misses = lookup_cached(mask, out, tickets, &hits, &detected);
+    if (!misses) return detected;
+    if (detected && stop_on_detect) {
+        for (int id = 0; id < SC_CHECK_COUNT; ++id) {
+            if (!(misses & SC_CHECK_BIT(id))) continue;
+            out[id].status = SC_STATUS_CANCELLED;
+            check_stats_record_cancelled((sc_check_id)id);
+        }
+        return true;
+    }
+
+    sc_check_result fresh[SC_CHECK_COUNT];
+    detected |= schedule_checks(check_table, SC_CHECK_COUNT, misses, deadline_ms, stop_on_detect, fresh);
+    for (int id = 0; id < SC_CHECK_COUNT; ++id) {
+        if (!(misses & SC_CHECK_BIT(id))) continue;
+        out[id] = fresh[id];
+        if (fresh[id].status == SC_STATUS_CLEAN || fresh[id].status == SC_STATUS_DETECTED) {
+            check_cache_store((sc_check_id)id, tickets[id], fresh[id].status == SC_STATUS_DETECTED);
+        }
+    }
+    return detected;
+}
+
+// ========== Async Checks ==========
+namespace {
+struct SubmitContext {
+    unsigned int misses;
+    CheckCacheTicket tickets[SC_CHECK_COUNT];
+};
+}
+
+sc_task sc_submit(unsigned int mask, unsigned int deadline_ms, bool stop_on_detect,
+                  sc_check_callback on_check, sc_done_callback on_done, void* userdata) {
+    std::shared_ptr<SubmitContext> ctx = std::make_shared<SubmitContext>();
+    sc_check_result cached[SC_CHECK_COUNT];
+    memset(cached, 0, sizeof(cached));
+    unsigned int hits;
+    bool detected;
+    ctx->misses = lookup_cached(mask, cached, ctx->tickets, &hits, &detected);
+
+    // Fresh probe results go to the cache, as in run_checks().
+    AsyncCheckCallbacks callbacks;
+    callbacks.onCheck = [ctx, on_check, userdata](uint64_t task, sc_check_id id, const sc_check_result& result) {
+        bool probed = result.status == SC_STATUS_CLEAN || result.status == SC_STATUS_DETECTED;
+        if (probed && (ctx->misses & SC_CHECK_BIT(id))) {
+            check_cache_store(id, ctx->tickets[id], result.status == SC_STATUS_DETECTED);
+        }
+        if (on_check) on_check((sc_task)task, id, result, userdata);
+    };
+    callbacks.onDone = [on_done, userdata](uint64_t task, bool detected, const sc_check_result* results) {
+        if (on_done) on_done((sc_task)task, detected, results, userdata);
+    };
+    return (sc_task)schedule_checks_async(check_table, SC_CHECK_COUNT, ctx->misses, hits, cached, deadline_ms,
+                                          stop_on_detect, std::move(callbacks));
+}
+
+bool sc_cancel(sc_task task) {
+    return cancel_scheduled_checks((uint64_t)task);
+}
+
+bool run_advanced_checks_ex(unsigned int deadline_ms, sc_check_result* results) {
+    sc_check_result local[SC_CHECK_COUNT];
+    sc_check_result* out = results ? results : local;
+    bool detected = run_checks(SC_ADVANCED_CHECKS_MASK, deadline_ms, true, out);
+    for (int id = 0; id < SC_CHECK_COUNT; ++id) {
+        if (out[id].status == SC_STATUS_DETECTED) LOG("[!] %s detected.\n", check_table[id].name);
+    }
+    if (!detected) LOG("[+] All checks passed.\n");
+    return !detected;
+}
+
+bool run_advanced_checks() {
+    return run_advanced_checks_ex(0, nullptr);
+}
+
+bool is_rooted_ex(unsigned int deadline_ms, sc_check_result* results) {
+    // On platforms without root probes every id is skipped and this is false.
+    unsigned int mask = SC_ROOT_CHECKS_MASK;
+#if !defined(__ANDROID__) && !defined(__APPLE__)
+    mask = 0;
 #endif
+    return run_checks(mask, deadline_ms, true, results);
+}
+
+bool is_rooted() {
+    return is_rooted_ex(0, nullptr);
+}
+
+// ========== Cached Entry Points ==========
+// Single-check entry points share the scheduler's cache, so repeated calls
+// from JS within a check's TTL cost a lookup instead of the probe.
+static bool cached_probe(sc_check_id id, CheckProbe probe) {
+    bool detected;
+    if (check_cache_lookup(id, &detected)) {
+        check_stats_record_cache_hit(id);
+        return detected;
+    }
+    CheckCacheTicket ticket = check_cache_begin(id);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    detected = probe();
+    check_stats_record(id, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count(), detected);
+    check_cache_store(id, ticket, detected);
+    return detected;
+}
+
+bool detect_debugger() {
+    return cached_probe(SC_CHECK_DEBUGGER, probe_debugger);
+}
+
+bool detect_frida_thread() {
+    return cached_probe(SC_CHECK_FRIDA_THREAD, probe_frida_thread);
+}
+
+bool detect_memory_maps() {
+    return cached_probe(SC_CHECK_MEMORY_MAPS, probe_memory_maps);
+}
+
+bool check_process_name() {
+    return !cached_probe(SC_CHECK_PROCESS_NAME, probe_process_name);
+}
+
+bool verify_integrity() {
+    return !cached_probe(SC_CHECK_INTEGRITY, probe_integrity);
+}
+
+bool detect_frida_env() {
+    return cached_probe(SC_CHECK_FRIDA_ENV, probe_frida_env);
+}
+
+bool detect_frida_files() {
+    return cached_probe(SC_CHECK_FRIDA_FILES, probe_frida_files);
+}
+
+bool detect_frida_symbols() {
+    return cached_probe(SC_CHECK_FRIDA_SYMBOLS, probe_frida_symbols);
+}
+
+void security_core_set_cache_ttl(sc_check_id id, unsigned int ttl_ms) {
+    check_cache_set_ttl(id, ttl_ms);
+}
+
+void security_core_invalidate_cache() {
+    check_cache_invalidate_all();
+}
+
+// ========== Stats ==========
+void security_core_get_stats(sc_check_stats* stats) {
+    if (stats) check_stats_snapshot(stats);
+}
+
+void security_core_reset_stats() {
+    check_stats_reset();
+}
+
+const char* security_core_check_name(sc_check_id id) {
+    return id < SC_CHECK_COUNT ? check_table[id].name : NULL;
 }
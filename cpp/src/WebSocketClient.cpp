@@ -1,54 +1,1341 @@
 #include "WebSocketClient.h"
-#include <iostream>
-#include <openssl/x509.h>
-#include <openssl/pem.h>
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <errno.h>
+#include <math.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
 #include <openssl/sha.h>
-#include <openssl/bio.h>
-#include <openssl/buffer.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+
+static const char* const WS_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+static const char* const UNOFFERED_EXTENSION = "Server accepted a WebSocket extension that was not offered";
+static const size_t MAX_HANDSHAKE_BYTES = 16 * 1024;
+static const size_t MAX_MESSAGE_BYTES = 16 * 1024 * 1024;
+static const size_t READ_CHUNK = 16 * 1024;    // minimum free space offered to each read
+static const int READS_PER_WAKEUP = 16;       // level-triggered, so the rest comes next round
+static const size_t TLS_COALESCE_BYTES = 64 * 1024;
+static const int WRITEV_BATCH = 64;
+static const int HANDSHAKE_TIMEOUT_MS = 10000;
+static const int CLOSE_TIMEOUT_MS = 2000;
+static const size_t SPKI_CACHE_LIMIT = 64;
+static const size_t STREAM_WINDOW = 1024 * 1024;  // unsent bytes of a streamed send
+static const size_t DRAIN_BYTES = 1024 * 1024;    // framed ahead of the socket
+
+typedef std::chrono::steady_clock Clock;
+
+// ========== Helpers ==========
+static std::string base64_encode(const unsigned char* data, size_t len) {
+    std::string out(4 * ((len + 2) / 3), '\0');
+    int n = EVP_EncodeBlock((unsigned char*)&out[0], data, (int)len);
+    out.resize(n < 0 ? 0 : (size_t)n);
+    return out;
+}
+
+static bool base64_decode(const std::string& in, std::string& out) {
+    if (in.empty() || in.size() % 4 != 0) return false;
+    out.resize(in.size() / 4 * 3);
+    int n = EVP_DecodeBlock((unsigned char*)&out[0], (const unsigned char*)in.data(), (int)in.size());
+    if (n < 0) return false;
+    size_t pad = (in[in.size() - 1] == '=') + (in[in.size() - 2] == '=');
+    out.resize((size_t)n - pad);
+    return true;
+}
+
+static std::string trim(const std::string& s) {
+    size_t b = s.find_first_not_of(" \t");
+    if (b == std::string::npos) return std::string();
+    return s.substr(b, s.find_last_not_of(" \t") - b + 1);
+}
 
-// Dummy logic cho demo
+static std::string lower(std::string s) {
+    for (char& c : s) {
+        if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+    }
+    return s;
+}
+
+static int clamp(int value, int lo, int hi) {
+    return std::max(lo, std::min(hi, value));
+}
+
+static bool is_ip_literal(const std::string& host) {
+    unsigned char buf[sizeof(struct in6_addr)];
+    return inet_pton(AF_INET, host.c_str(), buf) == 1 || inet_pton(AF_INET6, host.c_str(), buf) == 1;
+}
+
+static bool parse_url(const std::string& url, bool& secure, std::string& host, std::string& port,
+                      std::string& path) {
+    size_t rest;
+    if (url.compare(0, 6, "wss://") == 0) {
+        secure = true;
+        rest = 6;
+    } else if (url.compare(0, 5, "ws://") == 0) {
+        secure = false;
+        rest = 5;
+    } else {
+        return false;
+    }
+
+    size_t end = url.find_first_of("/?#", rest);
+    std::string authority = url.substr(rest, end == std::string::npos ? std::string::npos : end - rest);
+    path = end == std::string::npos ? "/" : url.substr(end);
+    path.resize(std::min(path.size(), path.find('#')));
+    if (path.empty() || path[0] != '/') path.insert(0, "/");
+
+    size_t at = authority.rfind('@');
+    if (at != std::string::npos) authority.erase(0, at + 1);
+    size_t portSep;
+    if (!authority.empty() && authority[0] == '[') {
+        size_t close = authority.find(']');
+        if (close == std::string::npos) return false;
+        host = authority.substr(1, close - 1);
+        portSep = authority.find(':', close);
+    } else {
+        portSep = authority.rfind(':');
+        host = authority.substr(0, portSep);
+    }
+    port = portSep == std::string::npos ? std::string(secure ? "443" : "80") : authority.substr(portSep + 1);
+    return !host.empty() && !port.empty();
+}
+
+static std::vector<std::string> parse_pins(const std::string& spec) {
+    std::vector<std::string> pins;
+    size_t pos = 0;
+    while (pos <= spec.size()) {
+        size_t comma = std::min(spec.find(',', pos), spec.size());
+        std::string pin = trim(spec.substr(pos, comma - pos));
+        if (pin.compare(0, 7, "sha256/") == 0) pin.erase(0, 7);
+        std::string digest;
+        if (base64_decode(pin, digest) && digest.size() == SHA256_DIGEST_LENGTH) pins.push_back(digest);
+        pos = comma + 1;
+    }
+    return pins;
+}
+
+// SPKI digests of certificates already seen, keyed by the SHA-256 of the
+// whole certificate, so reconnecting to the same server (from any client)
+// skips extracting and re-encoding its public key.
+namespace {
+struct SpkiCache {
+    std::mutex mutex;
+    std::unordered_map<std::string, std::string> digests;
+};
+}
+
+static SpkiCache& spki_cache() {
+    // Intentionally leaked: the I/O thread of a client that outlives main()
+    // may still check a certificate during static destruction.
+    static SpkiCache* cache = new SpkiCache();
+    return *cache;
+}
+
+static bool spki_digest(X509* cert, std::string& out) {
+    unsigned char certDigest[SHA256_DIGEST_LENGTH];
+    unsigned int certLen = 0;
+    if (X509_digest(cert, EVP_sha256(), certDigest, &certLen) != 1) return false;
+    std::string key((const char*)certDigest, certLen);
+    SpkiCache& cache = spki_cache();
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        std::unordered_map<std::string, std::string>::const_iterator it = cache.digests.find(key);
+        if (it != cache.digests.end()) {
+            out = it->second;
+            return true;
+        }
+    }
+
+    unsigned char* der = nullptr;
+    int len = i2d_X509_PUBKEY(X509_get_X509_PUBKEY(cert), &der);
+    if (len <= 0) return false;
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    SHA256(der, (size_t)len, digest);
+    OPENSSL_free(der);
+    out.assign((const char*)digest, sizeof(digest));
+
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (cache.digests.size() >= SPKI_CACHE_LIMIT) cache.digests.clear();
+    cache.digests[key] = out;
+    return true;
+}
+
+static bool spki_matches(X509* cert, const std::vector<std::string>& pins) {
+    std::string digest;
+    if (!spki_digest(cert, digest)) return false;
+    for (const std::string& pin : pins) {
+        if (pin == digest) return true;
+    }
+    return false;
+}
+
+static std::string tls_error(const char* what) {
+    char buf[256];
+    unsigned long code = ERR_get_error();
+    if (code == 0) return what;
+    ERR_error_string_n(code, buf, sizeof(buf));
+    return std::string(what) + ": " + buf;
+}
+
+// ========== Public API ==========
 WebSocketClient::WebSocketClient(const std::string& url, const std::string& pubkeyBase64)
-    : url(url), pinnedPubKey(pubkeyBase64) {}
+    : url(url), pinnedPubKey(pubkeyBase64), pins(parse_pins(pubkeyBase64)) {}
+
+WebSocketClient::~WebSocketClient() {
+    stopping = true;
+    loop.wake();
+    dispatcher.stop();  // also frees an I/O thread waiting for queue space
+    if (ioThread.joinable()) ioThread.join();
+    if (session) SSL_SESSION_free(session);
+    if (sslCtx) SSL_CTX_free(sslCtx);
+}
 
 void WebSocketClient::connect() {
-    std::cout << "Connecting to: " << url << std::endl;
-    std::cout << "Pinning with: " << pinnedPubKey << std::endl;
+    if (ioThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(outboxMutex);
+            if (ioRunning) {
+                // The last connection is over but its thread has not exited
+                // yet, typically when called from onClose; it starts another.
+                if (ioFinishing) restartRequested = true;
+                return;
+            }
+        }
+        ioThread.join();
+    }
+    dispatcher.start(deliveryOptions);
+    if (!parse_url(url, secure, host, port, path)) {
+        emitError("Invalid WebSocket URL: " + url);
+        return;
+    }
+    if (!pinnedPubKey.empty() && pins.empty()) {
+        emitError("Invalid public key pin");
+        return;
+    }
+    if (!loop.valid()) {
+        emitError("Cannot create event loop");
+        return;
+    }
+    takeOptions();
+    {
+        std::lock_guard<std::mutex> lock(outboxMutex);
+        closeRequested = false;
+        ioFinishing = false;
+    }
+    ioRunning = true;
+    ioThread = std::thread(&WebSocketClient::ioLoop, this);
+}
+
+// Copies the caller's options for the I/O thread, clamped to valid ranges.
+void WebSocketClient::takeOptions() {
+    compression = compressionOptions;
+    compression.clientMaxWindowBits = clamp(compression.clientMaxWindowBits, 9, 15);
+    compression.serverMaxWindowBits = clamp(compression.serverMaxWindowBits, 9, 15);
+    compression.level = clamp(compression.level, 1, 9);
+    reconnect = reconnectOptions;
+    reconnect.initialDelayMs = std::max(reconnect.initialDelayMs, 1);
+    reconnect.maxDelayMs = std::max(reconnect.maxDelayMs, reconnect.initialDelayMs);
+    reconnect.multiplier = std::max(reconnect.multiplier, 1.0);
 }
 
 void WebSocketClient::send(const std::string& msg) {
-    std::cout << "Sending: " << msg << std::endl;
+    queueMessage(WS_OP_TEXT, msg.data(), msg.size());
+}
+
+void WebSocketClient::sendBinary(const char* data, size_t length) {
+    queueMessage(WS_OP_BINARY, data, length);
+}
+
+void WebSocketClient::beginMessage(bool binary) {
+    std::lock_guard<std::mutex> lock(outboxMutex);
+    if (streamOpen) return;
+    streamOpen = true;
+    streamFirst = true;
+    streamFailed = false;
+    streamOpcode = binary ? WS_OP_BINARY : WS_OP_TEXT;
+}
+
+bool WebSocketClient::sendChunk(const char* data, size_t length) {
+    {
+        std::unique_lock<std::mutex> lock(outboxMutex);
+        while (streamOpen && !streamFailed && streamQueued > STREAM_WINDOW && ioRunning) streamSpace.wait(lock);
+        // Without an I/O thread nothing drains the window, so refuse rather
+        // than wait forever.
+        if (!streamOpen || streamFailed || streamQueued > STREAM_WINDOW) return false;
+        if (!queueStreamPiece(data, length, false)) return false;
+    }
+    loop.wake();
+    return true;
+}
+
+bool WebSocketClient::endMessage() {
+    bool ok;
+    {
+        std::lock_guard<std::mutex> lock(outboxMutex);
+        if (!streamOpen) return false;
+        ok = !streamFailed;
+        if (ok) ok = queueStreamPiece("", 0, true);
+        streamOpen = false;
+        for (Outgoing& m : held) pushOutbox(std::move(m));
+        held.clear();
+    }
+    loop.wake();
+    return ok;
 }
 
 void WebSocketClient::close() {
-    std::cout << "Closing connection" << std::endl;
+    {
+        std::lock_guard<std::mutex> lock(outboxMutex);
+        closeRequested = true;
+    }
+    loop.wake();
 }
 
 void WebSocketClient::setListener(WebSocketListener* l) {
-    listener = l;
+    dispatcher.setListener(l);
 }
 
-void WebSocketClient::emitOpen() {
-    if (listener && listener->onOpen) {
-        listener->onOpen();
+void WebSocketClient::setCompression(const WebSocketCompression& options) {
+    compressionOptions = options;
+}
+
+void WebSocketClient::setDelivery(const WebSocketDelivery& options) {
+    deliveryOptions = options;
+}
+
+uint64_t WebSocketClient::droppedMessages() const {
+    return dispatcher.dropped();
+}
+
+void WebSocketClient::setReconnect(const WebSocketReconnect& options) {
+    reconnectOptions = options;
+}
+
+void WebSocketClient::setQueue(const WebSocketQueue& options) {
+    std::lock_guard<std::mutex> lock(outboxMutex);
+    outbox.configure(options);
+}
+
+uint64_t WebSocketClient::droppedSends() const {
+    return droppedSendCount.load(std::memory_order_relaxed);
+}
+
+// Framing waits for the I/O thread, which knows whether the server agreed
+// to compression and compresses messages in send order.
+void WebSocketClient::queueMessage(uint8_t opcode, const char* data, size_t len) {
+    Outgoing message = WsOutgoing::make(opcode, data, len);
+    {
+        std::lock_guard<std::mutex> lock(outboxMutex);
+        // A message must not land between the frames of a stream.
+        if (streamOpen) {
+            held.push_back(std::move(message));
+        } else {
+            pushOutbox(std::move(message));
+        }
     }
+    loop.wake();
 }
 
-void WebSocketClient::emitMessage(const std::string& msg) {
-    if (listener && listener->onMessage) {
-        listener->onMessage(msg.c_str());
+// Called with outboxMutex held.
+void WebSocketClient::pushOutbox(Outgoing&& message) {
+    if (!outbox.push(std::move(message), false)) droppedSendCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Called with outboxMutex held. Pieces bypass the queue limits, since the
+// stream window already bounds them, and are never dropped; if even that
+// fails, the stream fails.
+bool WebSocketClient::queueStreamPiece(const char* data, size_t len, bool fin) {
+    Outgoing piece = WsOutgoing::make(streamFirst ? streamOpcode : (uint8_t)WS_OP_CONTINUATION, data, len);
+    piece.fin = fin;
+    piece.streamed = true;
+    piece.streamBytes = len;
+    if (!outbox.push(std::move(piece), true)) {
+        streamFailed = true;
+        return false;
     }
+    streamQueued += len;
+    streamFirst = false;
+    return true;
 }
 
-void WebSocketClient::emitClose(int code, const std::string& reason) {
-    if (listener && listener->onClose) {
-        listener->onClose(code, reason.c_str());
+// Runs on the I/O thread as a connection ends. Messages framed for it but
+// not written whole go back to the front of the outbox, to be framed again
+// by the next connection's deflater. The pieces of a stream that was
+// partly written are not; abandonStream() drops what is left of it.
+void WebSocketClient::requeueUnsent() {
+    size_t skip = 0;
+    bool finished = false;
+    if (outStreamWritten) {
+        while (!finished && skip < unsent.size() && unsent[skip].streamed) finished = unsent[skip++].fin;
     }
+    outStreamStarted = outStreamWritten && !finished;
+    outStreamWritten = false;
+    {
+        std::lock_guard<std::mutex> lock(outboxMutex);
+        while (unsent.size() > skip) {
+            outbox.unshift(std::move(unsent.back()));
+            unsent.pop_back();
+        }
+    }
+    unsent.clear();
 }
 
-void WebSocketClient::emitError(const std::string& error) {
-    if (listener && listener->onError) {
-        listener->onError(error.c_str());
+// Runs on the I/O thread as a connection ends. A stream that already
+// started going out cannot be continued on another connection, so its
+// remaining pieces are dropped and the sender is told through sendChunk()
+// and endMessage(). A stream not yet started waits for the next one.
+void WebSocketClient::abandonStream() {
+    {
+        std::lock_guard<std::mutex> lock(outboxMutex);
+        if (outStreamStarted) {
+            bool finished = false;
+            Outgoing* m;
+            while (!finished && (m = outbox.front()) && m->streamed) {
+                finished = m->fin;
+                outbox.pop();
+            }
+            if (!finished && streamOpen) streamFailed = true;
+            outStreamStarted = false;
+        }
+        streamQueued = outbox.streamBytes();
+    }
+    streamSpace.notify_all();
+}
+
+void WebSocketClient::releaseStreamBytes(size_t n) {
+    if (n == 0) return;
+    {
+        std::lock_guard<std::mutex> lock(outboxMutex);
+        streamQueued -= std::min(n, streamQueued);
+    }
+    streamSpace.notify_all();
+}
+
+// ========== I/O Thread ==========
+void WebSocketClient::ioLoop() {
+    // A reset peer must surface as EPIPE, not kill the process. SIGPIPE from
+    // a write goes to the writing thread, so blocking it here also covers
+    // the writes OpenSSL makes through its socket BIO.
+    sigset_t pipeMask;
+    sigemptyset(&pipeMask);
+    sigaddset(&pipeMask, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipeMask, nullptr);
+
+    int failures = 0;
+    for (;;) {
+        if (runConnection()) failures = 0;
+        bool finishing;
+        {
+            std::lock_guard<std::mutex> lock(outboxMutex);
+            finishing = ioFinishing;
+        }
+        if (!finishing && waitToReconnect(failures++)) continue;
+        // Under the lock, so a sendChunk() about to wait or a connect()
+        // about to ask for a restart sees the outcome.
+        std::lock_guard<std::mutex> lock(outboxMutex);
+        if (stopping || !restartRequested) {
+            ioRunning = false;
+            break;
+        }
+        // connect() was called while the last connection closed. The
+        // options it would have copied are read here, after its lock.
+        restartRequested = false;
+        closeRequested = false;
+        ioFinishing = false;
+        takeOptions();
+        failures = 0;
+    }
+    streamSpace.notify_all();
+}
+
+// Waits out the backoff before reconnect attempt n (0-based). Returns false
+// when close() or the destructor cuts the wait short.
+bool WebSocketClient::waitToReconnect(int attempt) {
+    double delayMs = std::min(reconnect.initialDelayMs * pow(reconnect.multiplier, attempt),
+                              (double)reconnect.maxDelayMs);
+    uint32_t r = 0;
+    RAND_bytes((unsigned char*)&r, sizeof(r));
+    delayMs = delayMs / 2 + delayMs / 2 * (r / 4294967296.0);
+    Clock::time_point deadline = Clock::now() + std::chrono::milliseconds((long long)delayMs);
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(outboxMutex);
+            if (closeRequested) return false;
+        }
+        if (stopping) return false;
+        long long left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+        if (left <= 0) return true;
+        EventLoop::Event event;
+        if (loop.wait(&event, 1, (int)left) < 0) return false;  // nothing is watched; only wake() ends it early
+    }
+}
+
+// One connection, from resolving the host to reporting its close. Returns
+// true if it got past the handshake.
+bool WebSocketClient::runConnection() {
+    recvStart = recvEnd = 0;
+    writeQueue.clear();
+    writeQueueBytes = 0;
+    unsent.clear();
+    tlsChunk.clear();
+    tlsOffset = 0;
+    tlsChunkMessages = 0;
+    tlsWantsWrite = false;
+    fragments.clear();
+    fragmentOpcode = 0;
+    fragmentCompressed = false;
+    inStream = false;
+    inFrameLeft = 0;
+    outStreamStarted = false;
+    outStreamWritten = false;
+    closeReceived = false;
+    closeCode = 1006;
+    closeReason.clear();
+    opened = false;
+
+    std::string error;
+    bool ok = resolve(error) && connectNext(error);
+    bool done = false;
+    deadline = Clock::now() + std::chrono::milliseconds(HANDSHAKE_TIMEOUT_MS);
+
+    while (ok && !done && !stopping) {
+        bool wantClose;
+        bool drained;
+        {
+            std::lock_guard<std::mutex> lock(outboxMutex);
+            wantClose = closeRequested;
+            drained = outbox.empty();
+        }
+        if (state == STATE_OPEN) {
+            if (!takeOutbox(error)) break;
+            // Messages sent before close() go out first.
+            if (wantClose && drained) {
+                const char normal[2] = {(char)(1000 >> 8), (char)(1000 & 0xFF)};
+                queueFrame(WS_OP_CLOSE, normal, sizeof(normal));
+                state = STATE_CLOSING;
+                deadline = Clock::now() + std::chrono::milliseconds(CLOSE_TIMEOUT_MS);
+            }
+        } else if (wantClose && state < STATE_OPEN) {
+            break;  // abandoned before the handshake finished
+        }
+        if (state == STATE_CLOSING && closeReceived && !writesPending()) break;
+
+        unsigned interest = EventLoop::READABLE;
+        if (state == STATE_CONNECTING || tlsWantsWrite || writesPending()) interest |= EventLoop::WRITABLE;
+        loop.watch(fd, interest);
+
+        int timeoutMs = -1;
+        if (state != STATE_OPEN) {
+            long long left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+            timeoutMs = (int)std::max(0LL, left);
+        }
+        EventLoop::Event event;
+        int n = loop.wait(&event, 1, timeoutMs);
+        if (n < 0) {
+            error = "Event loop failed";
+            break;
+        }
+        if (n == 0) {
+            if (state != STATE_OPEN && Clock::now() >= deadline) {
+                if (state != STATE_CLOSING) error = "WebSocket handshake timed out";
+                break;
+            }
+            continue;
+        }
+
+        switch (state) {
+        case STATE_CONNECTING:
+            ok = finishConnect(error);
+            break;
+        case STATE_TLS_HANDSHAKE:
+            ok = stepTls(error);
+            break;
+        default: {
+            ok = flushWrites(error);
+            bool eof = ok && !fillRecvBuffer();
+            if (ok && state == STATE_WS_HANDSHAKE) ok = parseHandshake(error);
+            if (ok && state >= STATE_OPEN) ok = parseFrames(error);
+            if (ok) ok = flushWrites(error);
+            if (ok && eof) {
+                if (state == STATE_WS_HANDSHAKE) error = "Connection closed during WebSocket handshake";
+                done = true;
+            }
+            break;
+        }
+        }
+    }
+
+    teardown();
+    requeueUnsent();
+    abandonStream();
+    state = STATE_CLOSED;
+    {
+        // Settled before the close is reported, so a connect() made in
+        // response knows this thread is about to exit.
+        std::lock_guard<std::mutex> lock(outboxMutex);
+        ioFinishing = stopping || !reconnect.enabled || closeRequested;
+    }
+    if (!stopping) {
+        if (!error.empty()) emitError(error);
+        emitClose(closeReceived ? closeCode : 1006, closeReceived ? closeReason : std::string());
     }
+    return opened;
+}
+
+bool WebSocketClient::resolve(std::string& error) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* res = nullptr;
+    int rc = getaddrinfo(host.c_str(), port.c_str(), &hints, &res);
+    if (rc != 0) {
+        error = "Cannot resolve " + host + ": " + gai_strerror(rc);
+        return false;
+    }
+    addresses.clear();
+    for (struct addrinfo* ai = res; ai; ai = ai->ai_next) {
+        Address a;
+        memcpy(&a.addr, ai->ai_addr, ai->ai_addrlen);
+        a.len = (socklen_t)ai->ai_addrlen;
+        addresses.push_back(a);
+    }
+    freeaddrinfo(res);
+    addressIndex = 0;
+    return true;
+}
+
+// Starts a non-blocking connect to the next resolved address.
+bool WebSocketClient::connectNext(std::string& error) {
+    for (; addressIndex < addresses.size(); ++addressIndex) {
+        const Address& a = addresses[addressIndex];
+        fd = socket(a.addr.ss_family, SOCK_STREAM, 0);
+        if (fd < 0) continue;
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        int one = 1;
+        // Frames are already coalesced before they reach the socket.
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#ifdef SO_NOSIGPIPE
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+        if (::connect(fd, (const struct sockaddr*)&a.addr, a.len) == 0 || errno == EINPROGRESS) {
+            state = STATE_CONNECTING;
+            return true;
+        }
+        ::close(fd);
+        fd = -1;
+    }
+    error = "Cannot connect to " + host + ":" + port;
+    return false;
+}
+
+bool WebSocketClient::finishConnect(std::string& error) {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0) err = errno;
+    if (err != 0) {
+        loop.unwatch(fd);
+        ::close(fd);
+        fd = -1;
+        ++addressIndex;
+        if (connectNext(error)) return true;
+        error += std::string(": ") + strerror(err);
+        return false;
+    }
+    if (secure) return startTls(error) && stepTls(error);
+    queueUpgradeRequest();
+    return flushWrites(error);
+}
+
+// ========== TLS ==========
+bool WebSocketClient::startTls(std::string& error) {
+    if (!sslCtx) {
+        sslCtx = SSL_CTX_new(TLS_client_method());
+        if (!sslCtx) {
+            error = tls_error("Cannot create TLS context");
+            return false;
+        }
+        SSL_CTX_set_min_proto_version(sslCtx, TLS1_2_VERSION);
+        SSL_CTX_set_mode(sslCtx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+        SSL_CTX_set_default_verify_paths(sslCtx);
+        SSL_CTX_set_verify(sslCtx, SSL_VERIFY_PEER, nullptr);
+        SSL_CTX_set_cert_verify_callback(sslCtx, verifyCertificate, this);
+        // Sessions are kept by storeSession() rather than OpenSSL's cache:
+        // TLS 1.3 tickets arrive after the handshake, inside SSL_read().
+        SSL_CTX_set_session_cache_mode(sslCtx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(sslCtx, storeSession);
+        SSL_CTX_set_app_data(sslCtx, this);
+    }
+    ssl = SSL_new(sslCtx);
+    if (!ssl || SSL_set_fd(ssl, fd) != 1) {
+        error = tls_error("Cannot create TLS session");
+        return false;
+    }
+    // Resuming skips the certificate exchange and its verification; the
+    // session was only issued after the pins were checked.
+    if (session && SSL_SESSION_is_resumable(session)) SSL_set_session(ssl, session);
+    if (is_ip_literal(host)) {
+        X509_VERIFY_PARAM_set1_ip_asc(SSL_get0_param(ssl), host.c_str());
+    } else {
+        SSL_set_tlsext_host_name(ssl, host.c_str());
+        SSL_set1_host(ssl, host.c_str());
+    }
+    state = STATE_TLS_HANDSHAKE;
+    return true;
+}
+
+bool WebSocketClient::stepTls(std::string& error) {
+    ERR_clear_error();
+    int rc = SSL_connect(ssl);
+    if (rc == 1) {
+        tlsWantsWrite = false;
+        queueUpgradeRequest();
+        return flushWrites(error);
+    }
+    int err = SSL_get_error(ssl, rc);
+    if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) {
+        tlsWantsWrite = err == SSL_ERROR_WANT_WRITE;
+        return true;
+    }
+    if (session) {
+        SSL_SESSION_free(session);  // do not offer it again
+        session = nullptr;
+    }
+    long verify = SSL_get_verify_result(ssl);
+    if (verify == X509_V_ERR_APPLICATION_VERIFICATION) {
+        error = "Server public key does not match the pin";
+    } else if (verify != X509_V_OK) {
+        error = std::string("Certificate rejected: ") + X509_verify_cert_error_string(verify);
+    } else {
+        error = tls_error("TLS handshake failed");
+    }
+    return false;
+}
+
+// Runs inside SSL_connect() in place of OpenSSL's chain verification.
+int WebSocketClient::verifyCertificate(x509_store_ctx_st* ctx, void* arg) {
+    const WebSocketClient* self = (const WebSocketClient*)arg;
+    if (self->pins.empty()) return X509_verify_cert(ctx);
+
+    // The handshake proves the server holds the leaf key, so a leaf pin
+    // needs no chain. A pinned CA key only counts in a chain that verifies.
+    if (spki_matches(X509_STORE_CTX_get0_cert(ctx), self->pins)) return 1;
+    if (X509_verify_cert(ctx) == 1) {
+        STACK_OF(X509)* chain = X509_STORE_CTX_get0_chain(ctx);
+        for (int i = 0; chain && i < sk_X509_num(chain); ++i) {
+            if (spki_matches(sk_X509_value(chain, i), self->pins)) return 1;
+        }
+    }
+    X509_STORE_CTX_set_error(ctx, X509_V_ERR_APPLICATION_VERIFICATION);
+    return 0;
+}
+
+// Keeps the newest session for the next connect(). Runs on the I/O thread.
+int WebSocketClient::storeSession(ssl_st* ssl, ssl_session_st* newSession) {
+    WebSocketClient* self = (WebSocketClient*)SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl));
+    if (self->session) SSL_SESSION_free(self->session);
+    self->session = newSession;
+    return 1;  // the reference is ours now
+}
+
+// ========== Handshake ==========
+void WebSocketClient::queueUpgradeRequest() {
+    unsigned char nonce[16];
+    RAND_bytes(nonce, sizeof(nonce));
+    handshakeKey = base64_encode(nonce, sizeof(nonce));
+
+    std::string hostHeader = host.find(':') != std::string::npos ? "[" + host + "]" : host;
+    if (port != (secure ? "443" : "80")) hostHeader += ":" + port;
+    Outgoing request;
+    request.bytes = "GET " + path + " HTTP/1.1\r\n"
+                    "Host: " + hostHeader + "\r\n"
+                    "Upgrade: websocket\r\n"
+                    "Connection: Upgrade\r\n"
+                    "Sec-WebSocket-Key: " + handshakeKey + "\r\n"
+                    "Sec-WebSocket-Version: 13\r\n";
+    if (compression.enabled) {
+        request.bytes += "Sec-WebSocket-Extensions: permessage-deflate; client_max_window_bits";
+        if (compression.clientMaxWindowBits < 15) request.bytes += "=" + std::to_string(compression.clientMaxWindowBits);
+        if (compression.serverMaxWindowBits < 15) {
+            request.bytes += "; server_max_window_bits=" + std::to_string(compression.serverMaxWindowBits);
+        }
+        if (!compression.contextTakeover) request.bytes += "; client_no_context_takeover; server_no_context_takeover";
+        request.bytes += "\r\n";
+    }
+    request.bytes += "\r\n";
+    writeQueueBytes += request.bytes.size();
+    writeQueue.push_back(std::move(request));
+    state = STATE_WS_HANDSHAKE;
+}
+
+bool WebSocketClient::parseHandshake(std::string& error) {
+    static const char terminator[] = "\r\n\r\n";
+    const char* begin = (const char*)recvBuffer.data() + recvStart;
+    const char* end = (const char*)recvBuffer.data() + recvEnd;
+    const char* found = std::search(begin, end, terminator, terminator + 4);
+    if (found == end) {
+        if (recvEnd - recvStart > MAX_HANDSHAKE_BYTES) {
+            error = "WebSocket handshake response too large";
+            return false;
+        }
+        return true;
+    }
+    std::string head(begin, found + 2);
+    recvStart += (size_t)(found - begin) + 4;
+
+    size_t lineEnd = head.find("\r\n");
+    std::string status = head.substr(0, lineEnd);
+    if (status.compare(0, 9, "HTTP/1.1 ") != 0 || status.compare(9, 3, "101") != 0) {
+        error = "Unexpected handshake response: " + status;
+        return false;
+    }
+
+    std::string keyed = handshakeKey + WS_GUID;
+    unsigned char digest[SHA_DIGEST_LENGTH];
+    SHA1((const unsigned char*)keyed.data(), keyed.size(), digest);
+    std::string expectedAccept = base64_encode(digest, sizeof(digest));
+
+    bool upgrade = false, connection = false, accepted = false;
+    std::string extensions;
+    for (size_t pos = lineEnd + 2; pos < head.size();) {
+        size_t eol = head.find("\r\n", pos);
+        std::string line = head.substr(pos, eol - pos);
+        pos = eol + 2;
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        std::string name = lower(trim(line.substr(0, colon)));
+        std::string value = trim(line.substr(colon + 1));
+        if (name == "upgrade") {
+            upgrade = lower(value) == "websocket";
+        } else if (name == "connection") {
+            connection = lower(value).find("upgrade") != std::string::npos;
+        } else if (name == "sec-websocket-accept") {
+            accepted = value == expectedAccept;
+        } else if (name == "sec-websocket-extensions") {
+            extensions += (extensions.empty() ? "" : ", ") + value;
+        }
+    }
+    if (!upgrade || !connection || !accepted) {
+        error = "Invalid WebSocket handshake response";
+        return false;
+    }
+    if (!negotiateCompression(extensions, error)) return false;
+
+    state = STATE_OPEN;
+    opened = true;
+    emitOpen();
+    return takeOutbox(error);
+}
+
+// Checks the server's permessage-deflate response (RFC 7692 section 7)
+// against the offer and sets up the codecs. Only one extension is offered,
+// so anything else fails the connection.
+bool WebSocketClient::negotiateCompression(const std::string& extensions, std::string& error) {
+    deflater.end();
+    inflater.end();
+    if (extensions.empty()) return true;
+    if (!compression.enabled || extensions.find(',') != std::string::npos) {
+        error = UNOFFERED_EXTENSION;
+        return false;
+    }
+
+    // The response decides for the server; our own compressor may always
+    // drop its history, so the offer alone decides for us.
+    bool clientTakeover = compression.contextTakeover;
+    bool serverTakeover = true;
+    int clientBits = compression.clientMaxWindowBits;
+    unsigned seen = 0;
+    for (size_t pos = 0, index = 0; pos <= extensions.size(); ++index) {
+        size_t semi = std::min(extensions.find(';', pos), extensions.size());
+        std::string param = lower(trim(extensions.substr(pos, semi - pos)));
+        pos = semi + 1;
+        if (index == 0) {
+            if (param != "permessage-deflate") {
+                error = UNOFFERED_EXTENSION;
+                return false;
+            }
+            continue;
+        }
+        std::string name = param, value;
+        size_t eq = param.find('=');
+        if (eq != std::string::npos) {
+            name = trim(param.substr(0, eq));
+            value = trim(param.substr(eq + 1));
+            if (value.size() >= 2 && value[0] == '"' && value[value.size() - 1] == '"') {
+                value = value.substr(1, value.size() - 2);
+            }
+        }
+        int bits = value.empty() ? 0 : atoi(value.c_str());
+        unsigned flag;
+        if (name == "server_no_context_takeover" && eq == std::string::npos) {
+            flag = 1;
+            serverTakeover = false;
+        } else if (name == "client_no_context_takeover" && eq == std::string::npos) {
+            flag = 2;
+            clientTakeover = false;
+        } else if (name == "server_max_window_bits" && bits >= 8 && bits <= compression.serverMaxWindowBits) {
+            flag = 4;  // a 15-bit inflater decodes any smaller window
+        } else if (name == "client_max_window_bits" && bits >= 8 && bits <= compression.clientMaxWindowBits) {
+            flag = 8;
+            clientBits = bits;
+        } else {
+            error = "Invalid permessage-deflate response: " + param;
+            return false;
+        }
+        if (seen & flag) {
+            error = "Invalid permessage-deflate response: " + param;
+            return false;
+        }
+        seen |= flag;
+    }
+
+    if (!inflater.begin(serverTakeover)) {
+        error = "Cannot set up WebSocket compression";
+        return false;
+    }
+    // zlib has no raw 8-bit window. Compression is per message, so without
+    // a deflater messages simply go out uncompressed.
+    if (clientBits >= 9) deflater.begin(clientBits, compression.level, clientTakeover);
+    return true;
+}
+
+// ========== Framing ==========
+// Compresses data messages when the server agreed to it, then writes the
+// header into the headroom and masks the payload where it lies.
+bool WebSocketClient::encodeMessage(Outgoing& message) {
+    uint8_t rsv = 0;
+    size_t len = message.bytes.size() - WS_MAX_HEADER_SIZE;
+    bool first = message.opcode == WS_OP_TEXT || message.opcode == WS_OP_BINARY;
+    bool compress;
+    if (message.streamed) {
+        // A stream is compressed or not as a whole, decided by its first piece.
+        if (first) outStreamCompressed = deflater.active();
+        compress = outStreamCompressed;
+        outStreamStarted = !message.fin;
+    } else {
+        compress = first && deflater.active() && len >= compression.minSize;
+    }
+    if (compress) {
+        compressed.assign(WS_MAX_HEADER_SIZE, '\0');
+        const uint8_t* payload = (const uint8_t*)message.bytes.data() + WS_MAX_HEADER_SIZE;
+        if (!deflater.compressChunk(payload, len, message.fin, compressed)) return false;
+        message.bytes.swap(compressed);  // the old buffer is reused next time
+        len = message.bytes.size() - WS_MAX_HEADER_SIZE;
+        if (first) rsv = 4;  // RSV1: compressed message
+    }
+
+    // Client frames are masked with a fresh unpredictable key (RFC 6455 5.3).
+    uint8_t mask[4];
+    RAND_bytes(mask, sizeof(mask));
+    uint8_t header[WS_MAX_HEADER_SIZE];
+    size_t headerLen = ws_encode_header(header, message.opcode, message.fin, rsv, len, mask);
+    uint8_t* out = (uint8_t*)&message.bytes[0];
+    message.offset = WS_MAX_HEADER_SIZE - headerLen;
+    memcpy(out + message.offset, header, headerLen);
+    ws_mask(out + WS_MAX_HEADER_SIZE, out + WS_MAX_HEADER_SIZE, len, mask);
+    return true;
+}
+
+// Control frames are never compressed, so encoding cannot fail.
+void WebSocketClient::queueFrame(uint8_t opcode, const char* data, size_t len) {
+    writeQueue.push_back(WsOutgoing::make(opcode, data, len));
+    encodeMessage(writeQueue.back());
+    writeQueueBytes += writeQueue.back().bytes.size() - writeQueue.back().offset;
+}
+
+// Frames the next DRAIN_BYTES or so of the outbox. The rest stays queued,
+// so a backlog drains in large batches as the socket takes them. Framing
+// compresses and masks in place, so an unframed copy of each message is
+// kept in unsent until it is written.
+bool WebSocketClient::takeOutbox(std::string& error) {
+    if (writeQueueBytes >= DRAIN_BYTES) return true;
+    std::vector<Outgoing> messages;
+    {
+        std::lock_guard<std::mutex> lock(outboxMutex);
+        size_t taken = writeQueueBytes;
+        Outgoing* m;
+        while (taken < DRAIN_BYTES && (m = outbox.front())) {
+            taken += m->bytes.size();
+            messages.push_back(std::move(*m));
+            outbox.pop();
+        }
+    }
+    for (Outgoing& m : messages) {
+        unsent.push_back(m);
+        m.fromOutbox = true;
+        if (!encodeMessage(m)) {
+            error = "Cannot compress WebSocket message";
+            return false;
+        }
+        writeQueueBytes += m.bytes.size() - m.offset;
+        writeQueue.push_back(std::move(m));
+    }
+    return true;
+}
+
+// Forgets the copies of the next count outbox messages, now written whole.
+void WebSocketClient::messagesWritten(size_t count) {
+    for (; count > 0; --count) {
+        const Outgoing& m = unsent.front();
+        if (m.streamed) outStreamWritten = !m.fin;
+        unsent.pop_front();
+    }
+}
+
+// Frames are handled straight from recvBuffer; only fragmented messages
+// are copied, to reassemble them. When the listener streams, data frames
+// are passed on as their bytes arrive instead, whatever their size.
+bool WebSocketClient::parseFrames(std::string& error) {
+    while ((state == STATE_OPEN || state == STATE_CLOSING) && !closeReceived) {
+        if (inFrameLeft > 0) {
+            if (recvStart == recvEnd) break;
+            if (!streamPayload(error)) return false;
+            continue;
+        }
+        uint8_t* data = recvBuffer.data() + recvStart;
+        size_t available = recvEnd - recvStart;
+        WsFrame frame;
+        const char* parseError = nullptr;
+        WsParseStatus status = ws_parse_header(data, available, &frame, &parseError);
+        if (status == WS_PARSE_OK) {
+            // With permessage-deflate on, RSV1 marks a compressed message.
+            if (frame.rsv & ~(inflater.active() ? 4 : 0)) {
+                error = "WebSocket frame uses reserved bits";
+                return false;
+            }
+            if (frame.masked) {
+                error = "Server sent a masked frame";
+                return false;
+            }
+            bool dataFrame = (frame.opcode & 0x8) == 0;
+            bool startsMessage = frame.opcode != WS_OP_CONTINUATION && !fragmentOpcode;
+            if (dataFrame && (inStream || (startsMessage && dispatcher.streaming()))) {
+                recvStart += frame.size;
+                if (!streamFrame(frame, error)) return false;
+                continue;
+            }
+            status = ws_parse_frame(data, available, MAX_MESSAGE_BYTES, &frame, &parseError);
+        }
+        if (status == WS_PARSE_INCOMPLETE) break;
+        if (status == WS_PARSE_ERROR) {
+            error = parseError;
+            return false;
+        }
+        recvStart += frame.size;
+        if (!handleFrame(frame, error)) return false;
+    }
+    if (recvStart == recvEnd) recvStart = recvEnd = 0;
+    return true;
+}
+
+// Starts a data frame of a streamed message; its header has been consumed.
+bool WebSocketClient::streamFrame(const WsFrame& frame, std::string& error) {
+    bool compressedFrame = (frame.rsv & 4) != 0;
+    if (frame.opcode == WS_OP_CONTINUATION) {
+        if (compressedFrame) {
+            error = "RSV1 set on a frame that does not start a message";
+            return false;
+        }
+    } else {
+        if (inStream) {
+            error = "Expected a continuation frame";
+            return false;
+        }
+        inStream = true;
+        inStreamCompressed = compressedFrame;
+        dispatcher.postBegin(frame.opcode == WS_OP_BINARY);
+    }
+    inFrameLeft = frame.length;
+    inFrameFin = frame.fin;
+    return streamPayload(error);
+}
+
+// Passes on whatever part of the current frame's payload has arrived.
+// Compressed messages are inflated piece by piece.
+bool WebSocketClient::streamPayload(std::string& error) {
+    size_t n = (size_t)std::min<uint64_t>(inFrameLeft, recvEnd - recvStart);
+    const uint8_t* data = recvBuffer.data() + recvStart;
+    recvStart += n;
+    inFrameLeft -= n;
+    bool last = inFrameLeft == 0 && inFrameFin;
+    if (inStreamCompressed) {
+        WsDispatcher& d = dispatcher;
+        bool ok = inflater.decompressChunk(data, n, last, [&d](const char* piece, size_t len) {
+            d.postChunk(piece, len);
+            return true;
+        });
+        if (!ok) {
+            error = "Cannot decompress WebSocket message";
+            return false;
+        }
+    } else if (n > 0) {
+        dispatcher.postChunk((const char*)data, n);
+    }
+    if (last) {
+        dispatcher.postEnd();
+        inStream = false;
+    }
+    return true;
+}
+
+bool WebSocketClient::handleFrame(const WsFrame& frame, std::string& error) {
+    const char* payload = (const char*)frame.payload;
+    bool compressedFrame = (frame.rsv & 4) != 0;
+    if (compressedFrame && frame.opcode != WS_OP_TEXT && frame.opcode != WS_OP_BINARY) {
+        error = "RSV1 set on a frame that does not start a message";
+        return false;
+    }
+    switch (frame.opcode) {
+    case WS_OP_TEXT:
+    case WS_OP_BINARY:
+        if (fragmentOpcode) {
+            error = "Expected a continuation frame";
+            return false;
+        }
+        if (frame.fin) {
+            if (compressedFrame) return emitCompressed(payload, frame.length, frame.opcode == WS_OP_BINARY, error);
+            emitMessage(payload, frame.length, frame.opcode == WS_OP_BINARY);
+        } else {
+            fragmentOpcode = frame.opcode;
+            fragmentCompressed = compressedFrame;
+            fragments.assign(payload, frame.length);
+        }
+        return true;
+    case WS_OP_CONTINUATION:
+        if (!fragmentOpcode) {
+            error = "Unexpected continuation frame";
+            return false;
+        }
+        if (fragments.size() + frame.length > MAX_MESSAGE_BYTES) {
+            error = "WebSocket message too large";
+            return false;
+        }
+        fragments.append(payload, frame.length);
+        if (frame.fin) {
+            bool ok = true;
+            bool binary = fragmentOpcode == WS_OP_BINARY;
+            if (fragmentCompressed) {
+                ok = emitCompressed(fragments.data(), fragments.size(), binary, error);
+            } else {
+                emitMessage(fragments.data(), fragments.size(), binary);
+            }
+            fragments.clear();
+            fragmentOpcode = 0;
+            return ok;
+        }
+        return true;
+    case WS_OP_PING:
+        queueFrame(WS_OP_PONG, payload, frame.length);
+        return true;
+    case WS_OP_PONG:
+        return true;
+    case WS_OP_CLOSE:
+        closeReceived = true;
+        closeCode = 1005;
+        closeReason.clear();
+        if (frame.length >= 2) {
+            closeCode = (frame.payload[0] << 8) | frame.payload[1];
+            closeReason.assign(payload + 2, frame.length - 2);
+        }
+        if (state == STATE_OPEN) {
+            // Echo the status code, then close once it is flushed. The
+            // handshake deadline has long passed, so the echo gets its own.
+            queueFrame(WS_OP_CLOSE, payload, std::min<size_t>(frame.length, 2));
+            state = STATE_CLOSING;
+            deadline = Clock::now() + std::chrono::milliseconds(CLOSE_TIMEOUT_MS);
+        }
+        return true;
+    default:
+        error = "Unknown WebSocket opcode";
+        return false;
+    }
+}
+
+bool WebSocketClient::emitCompressed(const char* data, size_t len, bool binary, std::string& error) {
+    if (!inflater.decompress((const uint8_t*)data, len, MAX_MESSAGE_BYTES, inflated)) {
+        error = "Cannot decompress WebSocket message";
+        return false;
+    }
+    emitMessage(inflated.data(), inflated.size(), binary);
+    return true;
+}
+
+// ========== Socket I/O ==========
+// Returns the number of bytes read, 0 when nothing is available yet, or -1
+// on end of stream or error.
+long WebSocketClient::readSome(char* buf, size_t len) {
+    if (ssl) {
+        ERR_clear_error();
+        int n = SSL_read(ssl, buf, (int)len);
+        if (n > 0) {
+            tlsWantsWrite = false;
+            return n;
+        }
+        int err = SSL_get_error(ssl, n);
+        if (err == SSL_ERROR_WANT_READ) return 0;
+        if (err == SSL_ERROR_WANT_WRITE) {
+            tlsWantsWrite = true;
+            return 0;
+        }
+        return -1;
+    }
+    ssize_t n = recv(fd, buf, len, 0);
+    if (n > 0) return (long)n;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return 0;
+    return -1;
+}
+
+// Reads straight into recvBuffer, behind any partial frame left from the
+// last round. Returns false once the peer has closed the stream.
+bool WebSocketClient::fillRecvBuffer() {
+    for (int i = 0; i < READS_PER_WAKEUP; ++i) {
+        if (recvBuffer.size() - recvEnd < READ_CHUNK) {
+            if (recvStart > 0) {
+                memmove(recvBuffer.data(), recvBuffer.data() + recvStart, recvEnd - recvStart);
+                recvEnd -= recvStart;
+                recvStart = 0;
+            }
+            if (recvBuffer.size() - recvEnd < READ_CHUNK) recvBuffer.resize(recvEnd + std::max(READ_CHUNK, recvEnd));
+        }
+        long n = readSome((char*)recvBuffer.data() + recvEnd, recvBuffer.size() - recvEnd);
+        if (n < 0) return false;
+        if (n == 0) break;
+        recvEnd += (size_t)n;
+    }
+    return true;
+}
+
+bool WebSocketClient::writesPending() const {
+    return !writeQueue.empty() || tlsOffset < tlsChunk.size();
+}
+
+bool WebSocketClient::flushWrites(std::string& error) {
+    return ssl ? flushTls(error) : flushPlain(error);
+}
+
+// Queued frames go out in one writev() per batch.
+bool WebSocketClient::flushPlain(std::string& error) {
+    while (!writeQueue.empty()) {
+        struct iovec iov[WRITEV_BATCH];
+        int count = 0;
+        for (std::deque<Outgoing>::const_iterator it = writeQueue.begin();
+             it != writeQueue.end() && count < WRITEV_BATCH; ++it, ++count) {
+            iov[count].iov_base = (void*)(it->bytes.data() + it->offset);
+            iov[count].iov_len = it->bytes.size() - it->offset;
+        }
+        ssize_t n = writev(fd, iov, count);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+            error = std::string("Write failed: ") + strerror(errno);
+            return false;
+        }
+        size_t left = (size_t)n;
+        size_t streamWritten = 0;
+        size_t written = 0;
+        writeQueueBytes -= left;
+        while (left > 0) {
+            Outgoing& front = writeQueue.front();
+            size_t remaining = front.bytes.size() - front.offset;
+            if (left < remaining) {
+                front.offset += left;
+                break;
+            }
+            left -= remaining;
+            streamWritten += front.streamBytes;
+            if (front.fromOutbox) ++written;
+            writeQueue.pop_front();
+        }
+        messagesWritten(written);
+        if (streamWritten) releaseStreamBytes(streamWritten);
+    }
+    return true;
+}
+
+// TLS has no gather write, so frames are packed into records of up to
+// TLS_COALESCE_BYTES before SSL_write().
+bool WebSocketClient::flushTls(std::string& error) {
+    for (;;) {
+        if (tlsOffset == tlsChunk.size()) {
+            messagesWritten(tlsChunkMessages);
+            tlsChunkMessages = 0;
+            tlsChunk.clear();
+            tlsOffset = 0;
+            size_t streamWritten = 0;
+            while (!writeQueue.empty() && tlsChunk.size() < TLS_COALESCE_BYTES) {
+                const Outgoing& front = writeQueue.front();
+                tlsChunk.append(front.bytes, front.offset, std::string::npos);
+                writeQueueBytes -= front.bytes.size() - front.offset;
+                streamWritten += front.streamBytes;
+                if (front.fromOutbox) ++tlsChunkMessages;
+                writeQueue.pop_front();
+            }
+            // Counted as written once handed to TLS; the window only has to
+            // bound memory, and tlsChunk is bounded by itself.
+            if (streamWritten) releaseStreamBytes(streamWritten);
+            if (tlsChunk.empty()) return true;
+        }
+        ERR_clear_error();
+        int n = SSL_write(ssl, tlsChunk.data() + tlsOffset, (int)(tlsChunk.size() - tlsOffset));
+        if (n > 0) {
+            tlsOffset += (size_t)n;
+            continue;
+        }
+        int err = SSL_get_error(ssl, n);
+        if (err == SSL_ERROR_WANT_WRITE || err == SSL_ERROR_WANT_READ) return true;
+        error = tls_error("TLS write failed");
+        return false;
+    }
+}
+
+void WebSocketClient::teardown() {
+    if (ssl) {
+        if (SSL_is_init_finished(ssl)) SSL_shutdown(ssl);  // best-effort close_notify
+        SSL_free(ssl);
+        ssl = nullptr;
+    }
+    if (fd >= 0) {
+        loop.unwatch(fd);
+        ::close(fd);
+        fd = -1;
+    }
+    tlsWantsWrite = false;
+    deflater.end();  // back to the pool for the next connection
+    inflater.end();
+}
+
+// ========== Listener ==========
+// Events are queued for the dispatcher thread. The I/O thread is the only
+// poster while it runs; connect() posts only after joining the last one.
+void WebSocketClient::emitOpen() {
+    dispatcher.postOpen();
+}
+
+void WebSocketClient::emitMessage(const char* data, size_t length, bool binary) {
+    dispatcher.postMessage(data, length, binary);
+}
+
+void WebSocketClient::emitClose(int code, const std::string& reason) {
+    dispatcher.postClose(code, reason);
+}
+
+void WebSocketClient::emitError(const std::string& error) {
+    dispatcher.postError(error);
 }
 
 
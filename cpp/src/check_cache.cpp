@@ -0,0 +1,150 @@
+#include "check_cache.h"
+#include "procfs_reader.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdlib.h>
+
+namespace {
+enum Fingerprint {
+    FP_NONE,
+    FP_THREADS,   // link count of /proc/self/task (threads + 2)
+    FP_MAPPINGS,  // total mapped size from /proc/self/statm
+};
+
+struct CachePolicy {
+    unsigned int ttlMs;
+    Fingerprint fingerprint;
+};
+
+struct CacheEntry {
+    std::mutex mutex;
+    bool valid = false;
+    bool detected = false;
+    uint64_t expiresNs = 0;
+    uint64_t fingerprint = 0;
+    uint64_t generation = 0;  // of the ticket the result was stored with
+};
+}
+
+// Indexed by sc_check_id. Volatile signals get short TTLs and a cheap
+// change detector; values that only change across reboots live longest.
+static const CachePolicy default_policy[SC_CHECK_COUNT] = {
+    {500, FP_NONE},           // SC_CHECK_DEBUGGER
+    {2000, FP_THREADS},       // SC_CHECK_FRIDA_THREAD
+    {2000, FP_MAPPINGS},      // SC_CHECK_MEMORY_MAPS
+    {60000, FP_NONE},         // SC_CHECK_PROCESS_NAME
+    {5000, FP_NONE},          // SC_CHECK_INTEGRITY
+    {60000, FP_NONE},         // SC_CHECK_ROOT_PATHS
+    {300000, FP_NONE},        // SC_CHECK_SYSTEM_PROPS
+    {30000, FP_NONE},         // SC_CHECK_RW_SYSTEM_MOUNT
+    {30000, FP_NONE},         // SC_CHECK_FRIDA_SERVER
+    {60000, FP_NONE},         // SC_CHECK_JAILBREAK_PATHS
+    {60000, FP_NONE},         // SC_CHECK_SANDBOX_ESCAPE
+    {5000, FP_MAPPINGS},      // SC_CHECK_FRIDA_SYMBOLS
+    {60000, FP_NONE},         // SC_CHECK_FRIDA_ENV
+    {60000, FP_NONE},         // SC_CHECK_FRIDA_FILES
+};
+
+static CacheEntry entries[SC_CHECK_COUNT];
+// Bumped by check_cache_invalidate_all(); entries and stores from older
+// generations are ignored, so the bump alone invalidates everything.
+static std::atomic<uint64_t> generation(0);
+static std::atomic<unsigned int> ttl_ms[SC_CHECK_COUNT];
+static std::once_flag ttl_once;
+
+static void init_ttls() {
+    for (int id = 0; id < SC_CHECK_COUNT; ++id) {
+        ttl_ms[id].store(default_policy[id].ttlMs, std::memory_order_relaxed);
+    }
+}
+
+static unsigned int current_ttl(sc_check_id id) {
+    std::call_once(ttl_once, init_ttls);
+    return ttl_ms[id].load(std::memory_order_relaxed);
+}
+
+static uint64_t now_ns() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t read_fingerprint(Fingerprint kind) {
+#if !defined(__APPLE__)
+    if (kind == FP_THREADS) {
+        return procfs_task_link_count();
+    }
+    if (kind == FP_MAPPINGS) {
+        const char* statm = procfs_read(PROCFS_STATM, nullptr);
+        return statm ? strtoull(statm, nullptr, 10) : 0;
+    }
+#else
+    (void)kind;
+#endif
+    return 0;
+}
+
+bool check_cache_lookup(sc_check_id id, bool* detected) {
+    if (id >= SC_CHECK_COUNT || current_ttl(id) == 0) return false;
+    CacheEntry& entry = entries[id];
+    uint64_t now = now_ns();
+    bool hit;
+    uint64_t fingerprint;
+    {
+        std::lock_guard<std::mutex> lock(entry.mutex);
+        hit = entry.valid && now < entry.expiresNs &&
+              entry.generation == generation.load(std::memory_order_acquire);
+        fingerprint = entry.fingerprint;
+        *detected = entry.detected;
+    }
+    if (!hit) return false;
+
+    Fingerprint kind = default_policy[id].fingerprint;
+    if (kind != FP_NONE && read_fingerprint(kind) != fingerprint) {
+        std::lock_guard<std::mutex> lock(entry.mutex);
+        entry.valid = false;
+        return false;
+    }
+    return true;
+}
+
+CheckCacheTicket check_cache_begin(sc_check_id id) {
+    CheckCacheTicket ticket;
+    ticket.generation = generation.load(std::memory_order_acquire);
+    ticket.startedNs = now_ns();
+    if (id < SC_CHECK_COUNT) ticket.fingerprint = read_fingerprint(default_policy[id].fingerprint);
+    return ticket;
+}
+
+void check_cache_store(sc_check_id id, const CheckCacheTicket& ticket, bool detected) {
+    if (id >= SC_CHECK_COUNT) return;
+    unsigned int ttl = current_ttl(id);
+    if (ttl == 0) return;
+    CacheEntry& entry = entries[id];
+    std::lock_guard<std::mutex> lock(entry.mutex);
+    // Checked under the entry lock: an invalidation either bumped the
+    // generation first, or clears this entry once the lock is released.
+    if (ticket.generation != generation.load(std::memory_order_acquire)) return;
+    entry.valid = true;
+    entry.detected = detected;
+    entry.fingerprint = ticket.fingerprint;
+    entry.generation = ticket.generation;
+    entry.expiresNs = ticket.startedNs + (uint64_t)ttl * 1000000ULL;
+}
+
+void check_cache_set_ttl(sc_check_id id, unsigned int ttlMs) {
+    if (id >= SC_CHECK_COUNT) return;
+    current_ttl(id);
+    ttl_ms[id].store(ttlMs, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(entries[id].mutex);
+    entries[id].valid = false;
+}
+
+void check_cache_invalidate_all() {
+    generation.fetch_add(1, std::memory_order_acq_rel);
+    for (int id = 0; id < SC_CHECK_COUNT; ++id) {
+        std::lock_guard<std::mutex> lock(entries[id].mutex);
+        entries[id].valid = false;
+    }
+}
@@ -0,0 +1,336 @@
+#include "check_scheduler.h"
+#include "check_stats.h"
+#include "thread_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string.h>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+struct ScheduleState {
+    std::mutex mutex;
+    std::condition_variable cv;
+    sc_check_result results[SC_CHECK_COUNT];
+    bool finished[SC_CHECK_COUNT];
+    size_t pending = 0;
+    bool detected = false;
+    bool stopOnDetect = false;
+    std::atomic<bool> cancelled{false};
+
+    ScheduleState() {
+        memset(results, 0, sizeof(results));
+        memset(finished, 0, sizeof(finished));
+    }
+};
+}
+
+static void run_probe(const std::shared_ptr<ScheduleState>& state, const CheckSpec* spec) {
+    sc_check_result result = {SC_STATUS_CANCELLED, 0};
+    bool hit = false;
+    if (!state->cancelled.load(std::memory_order_acquire)) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        hit = spec->probe();
+        uint64_t elapsedNs = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        check_stats_record(spec->id, elapsedNs, hit);
+        result.elapsed_us = (unsigned int)(elapsedNs / 1000);
+        result.status = hit ? SC_STATUS_DETECTED : SC_STATUS_CLEAN;
+    } else {
+        check_stats_record_cancelled(spec->id);
+    }
+
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->results[spec->id] = result;
+    state->finished[spec->id] = true;
+    --state->pending;
+    if (hit) {
+        state->detected = true;
+        if (state->stopOnDetect) state->cancelled.store(true, std::memory_order_release);
+    }
+    if (state->pending == 0 || (hit && state->stopOnDetect)) state->cv.notify_all();
+}
+
+bool schedule_checks(const CheckSpec* specs, size_t count, unsigned int mask,
+                     unsigned int deadlineMs, bool stopOnDetect, sc_check_result* results) {
+    std::shared_ptr<ScheduleState> state = std::make_shared<ScheduleState>();
+    state->stopOnDetect = stopOnDetect;
+
+    const CheckSpec* selected[SC_CHECK_COUNT];
+    size_t selectedCount = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const CheckSpec* spec = &specs[i];
+        if (!spec->probe || spec->id >= SC_CHECK_COUNT || !(mask & SC_CHECK_BIT(spec->id))) continue;
+        selected[selectedCount++] = spec;
+    }
+    state->pending = selectedCount;
+
+    // The deadline starts before any inline probe, so its time counts.
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(deadlineMs);
+    // A pool worker waiting on its own pool could deadlock; run inline.
+    bool runInline = ThreadPool::isWorkerThread();
+    ThreadPool& pool = ThreadPool::shared();
+    for (size_t i = 0; i < selectedCount; ++i) {
+        const CheckSpec* spec = selected[i];
+        if (runInline) {
+            run_probe(state, spec);
+        } else {
+            pool.submit([state, spec] { run_probe(state, spec); });
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    auto done = [&state] {
+        return state->pending == 0 || (state->stopOnDetect && state->detected);
+    };
+    if (deadlineMs) {
+        state->cv.wait_until(lock, deadline, done);
+    } else {
+        state->cv.wait(lock, done);
+    }
+    // Anything not started yet is skipped; running probes finish on their own.
+    state->cancelled.store(true, std::memory_order_release);
+
+    if (results) memset(results, 0, sizeof(sc_check_result) * SC_CHECK_COUNT);
+    bool stopped = state->stopOnDetect && state->detected;
+    for (size_t i = 0; i < selectedCount; ++i) {
+        sc_check_id id = selected[i]->id;
+        if (state->finished[id]) {
+            if (results) results[id] = state->results[id];
+            continue;
+        }
+        if (!stopped) check_stats_record_timeout(id);
+        if (results) results[id].status = stopped ? SC_STATUS_CANCELLED : SC_STATUS_TIMED_OUT;
+    }
+    return state->detected;
+}
+
+// ========== Async ==========
+namespace {
+struct AsyncTask {
+    uint64_t id = 0;
+    std::mutex mutex;           // also held while callbacks run
+    AsyncCheckCallbacks callbacks;
+    sc_check_result results[SC_CHECK_COUNT];
+    unsigned int selected = 0;  // ids reported by this task
+    unsigned int settled = 0;
+    bool detected = false;
+    bool stopOnDetect = false;
+    bool done = false;
+    std::atomic<bool> cancelled{false};  // probes not started yet are skipped
+
+    AsyncTask() { memset(results, 0, sizeof(results)); }
+};
+
+// One thread for every task's deadline and for cancellations, so neither
+// needs a waiting thread per task. Entries hold weak references: a task
+// that completes early is not kept alive until its deadline.
+class CheckTimer {
+public:
+    void schedule(std::chrono::steady_clock::time_point when, const std::shared_ptr<AsyncTask>& task,
+                  sc_check_status status);
+
+    // Started on first use. Intentionally leaked: its detached thread keeps
+    // running through static destruction.
+    static CheckTimer& shared();
+
+private:
+    typedef std::pair<std::weak_ptr<AsyncTask>, sc_check_status> Entry;
+    std::multimap<std::chrono::steady_clock::time_point, Entry> entries;
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    void loop();
+};
+}
+
+static std::mutex registry_mutex;
+static std::atomic<uint64_t> next_task_id(1);
+
+// Owns every task until it completes, so a cancelled task whose probes
+// were all skipped is still there when the timer thread settles it.
+static std::unordered_map<uint64_t, std::shared_ptr<AsyncTask>>& registry() {
+    // Intentionally leaked: pool workers and the timer thread may still
+    // complete tasks during static destruction.
+    static std::unordered_map<uint64_t, std::shared_ptr<AsyncTask>>* tasks =
+        new std::unordered_map<uint64_t, std::shared_ptr<AsyncTask>>();
+    return *tasks;
+}
+
+// The helpers below are called with task->mutex held.
+static void complete(AsyncTask* task) {
+    task->done = true;
+    task->cancelled.store(true, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        registry().erase(task->id);
+    }
+    if (task->callbacks.onDone) task->callbacks.onDone(task->id, task->detected, task->results);
+}
+
+static void finish_remaining(AsyncTask* task, sc_check_status status) {
+    task->cancelled.store(true, std::memory_order_release);
+    for (int id = 0; id < SC_CHECK_COUNT; ++id) {
+        if (!(task->selected & SC_CHECK_BIT(id)) || (task->settled & SC_CHECK_BIT(id))) continue;
+        if (status == SC_STATUS_TIMED_OUT) check_stats_record_timeout((sc_check_id)id);
+        task->settled |= SC_CHECK_BIT(id);
+        task->results[id].status = status;
+        if (task->callbacks.onCheck) task->callbacks.onCheck(task->id, (sc_check_id)id, task->results[id]);
+    }
+    complete(task);
+}
+
+static void settle(AsyncTask* task, sc_check_id id, const sc_check_result& result) {
+    if (task->done || (task->settled & SC_CHECK_BIT(id))) return;
+    task->settled |= SC_CHECK_BIT(id);
+    task->results[id] = result;
+    bool hit = result.status == SC_STATUS_DETECTED;
+    task->detected |= hit;
+    if (task->callbacks.onCheck) task->callbacks.onCheck(task->id, id, result);
+    if (hit && task->stopOnDetect) {
+        finish_remaining(task, SC_STATUS_CANCELLED);
+    } else if (task->settled == task->selected) {
+        complete(task);
+    }
+}
+
+void CheckTimer::schedule(std::chrono::steady_clock::time_point when, const std::shared_ptr<AsyncTask>& task,
+                          sc_check_status status) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.insert(std::make_pair(when, Entry(task, status)));
+    }
+    cv.notify_one();
+}
+
+void CheckTimer::loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        if (entries.empty()) {
+            cv.wait(lock);
+            continue;
+        }
+        std::chrono::steady_clock::time_point first = entries.begin()->first;
+        if (std::chrono::steady_clock::now() < first) {
+            cv.wait_until(lock, first);
+            continue;
+        }
+        Entry entry = entries.begin()->second;
+        entries.erase(entries.begin());
+        lock.unlock();
+        if (std::shared_ptr<AsyncTask> task = entry.first.lock()) {
+            std::lock_guard<std::mutex> taskLock(task->mutex);
+            if (!task->done) finish_remaining(task.get(), entry.second);
+        }
+        lock.lock();
+    }
+}
+
+CheckTimer& CheckTimer::shared() {
+    static CheckTimer* timer = [] {
+        CheckTimer* t = new CheckTimer();
+        std::thread(&CheckTimer::loop, t).detach();
+        return t;
+    }();
+    return *timer;
+}
+
+static void run_async_probe(const std::shared_ptr<AsyncTask>& task, const CheckSpec* spec) {
+    if (task->cancelled.load(std::memory_order_acquire)) {
+        // Settled by whoever cancelled the task.
+        check_stats_record_cancelled(spec->id);
+        return;
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool hit = spec->probe();
+    uint64_t elapsedNs = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    check_stats_record(spec->id, elapsedNs, hit);
+    sc_check_result result = {hit ? SC_STATUS_DETECTED : SC_STATUS_CLEAN, (unsigned int)(elapsedNs / 1000)};
+
+    std::lock_guard<std::mutex> lock(task->mutex);
+    settle(task.get(), spec->id, result);
+}
+
+uint64_t schedule_checks_async(const CheckSpec* specs, size_t count, unsigned int mask,
+                               unsigned int presetMask, const sc_check_result* preset,
+                               unsigned int deadlineMs, bool stopOnDetect, AsyncCheckCallbacks callbacks) {
+    std::shared_ptr<AsyncTask> task = std::make_shared<AsyncTask>();
+    task->id = next_task_id.fetch_add(1, std::memory_order_relaxed);
+    task->callbacks = std::move(callbacks);
+    task->stopOnDetect = stopOnDetect;
+
+    sc_check_result presetResults[SC_CHECK_COUNT];
+    memset(presetResults, 0, sizeof(presetResults));
+    bool presetDetected = false;
+    for (int id = 0; id < SC_CHECK_COUNT; ++id) {
+        if (!(presetMask & SC_CHECK_BIT(id))) continue;
+        task->selected |= SC_CHECK_BIT(id);
+        presetResults[id] = preset[id];
+        presetDetected |= preset[id].status == SC_STATUS_DETECTED;
+    }
+    const CheckSpec* probes[SC_CHECK_COUNT];
+    size_t probeCount = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const CheckSpec* spec = &specs[i];
+        if (!spec->probe || spec->id >= SC_CHECK_COUNT || !(mask & SC_CHECK_BIT(spec->id))) continue;
+        if (task->selected & SC_CHECK_BIT(spec->id)) continue;
+        task->selected |= SC_CHECK_BIT(spec->id);
+        probes[probeCount++] = spec;
+    }
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        registry()[task->id] = task;
+    }
+
+    ThreadPool& pool = ThreadPool::shared();
+    // A preset detection already decides a stop-on-detect task: its probes
+    // are never started and are reported cancelled after the presets.
+    if (stopOnDetect && presetDetected) {
+        for (size_t i = 0; i < probeCount; ++i) check_stats_record_cancelled(probes[i]->id);
+    } else {
+        for (size_t i = 0; i < probeCount; ++i) {
+            const CheckSpec* spec = probes[i];
+            pool.submit([task, spec] { run_async_probe(task, spec); });
+        }
+        if (deadlineMs && probeCount) {
+            CheckTimer::shared().schedule(std::chrono::steady_clock::now() + std::chrono::milliseconds(deadlineMs),
+                                          task, SC_STATUS_TIMED_OUT);
+        }
+    }
+    if (presetMask || task->selected == 0) {
+        pool.submit([task, presetMask, presetResults] {
+            std::lock_guard<std::mutex> lock(task->mutex);
+            // Detections last, so a stop-on-detect task still reports the
+            // other presets with their results rather than as cancelled.
+            for (int pass = 0; pass < 2; ++pass) {
+                for (int id = 0; id < SC_CHECK_COUNT && !task->done; ++id) {
+                    if (!(presetMask & SC_CHECK_BIT(id))) continue;
+                    if ((presetResults[id].status == SC_STATUS_DETECTED) != (pass == 1)) continue;
+                    settle(task.get(), (sc_check_id)id, presetResults[id]);
+                }
+            }
+            if (!task->done && task->selected == 0) complete(task.get());
+        });
+    }
+    return task->id;
+}
+
+bool cancel_scheduled_checks(uint64_t id) {
+    std::shared_ptr<AsyncTask> task;
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        auto it = registry().find(id);
+        if (it == registry().end()) return false;
+        task = it->second;
+    }
+    task->cancelled.store(true, std::memory_order_release);
+    CheckTimer::shared().schedule(std::chrono::steady_clock::now(), task, SC_STATUS_CANCELLED);
+    return true;
+}
@@ -0,0 +1,86 @@
+#include "check_stats.h"
+
+#include <atomic>
+#include <string.h>
+
+namespace {
+struct alignas(64) CheckCounters {
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> detections{0};
+    std::atomic<uint64_t> cacheHits{0};
+    std::atomic<uint64_t> cancelled{0};
+    std::atomic<uint64_t> timeouts{0};
+    std::atomic<uint64_t> totalNs{0};
+    std::atomic<uint64_t> maxNs{0};
+    std::atomic<uint32_t> buckets[SC_STATS_BUCKETS];
+
+    CheckCounters() {
+        for (std::atomic<uint32_t>& b : buckets) b.store(0, std::memory_order_relaxed);
+    }
+};
+}
+
+static CheckCounters counters[SC_CHECK_COUNT];
+
+// Bucket i holds latencies in [2^i, 2^(i+1)) ns; the last one is open-ended.
+static unsigned int bucket_for(uint64_t ns) {
+    unsigned int b = ns ? 63 - (unsigned int)__builtin_clzll(ns) : 0;
+    return b < SC_STATS_BUCKETS ? b : SC_STATS_BUCKETS - 1;
+}
+
+void check_stats_record(sc_check_id id, uint64_t elapsedNs, bool detected) {
+    if (id >= SC_CHECK_COUNT) return;
+    CheckCounters& c = counters[id];
+    c.calls.fetch_add(1, std::memory_order_relaxed);
+    if (detected) c.detections.fetch_add(1, std::memory_order_relaxed);
+    c.totalNs.fetch_add(elapsedNs, std::memory_order_relaxed);
+    c.buckets[bucket_for(elapsedNs)].fetch_add(1, std::memory_order_relaxed);
+    uint64_t max = c.maxNs.load(std::memory_order_relaxed);
+    while (elapsedNs > max && !c.maxNs.compare_exchange_weak(max, elapsedNs, std::memory_order_relaxed)) {
+    }
+}
+
+void check_stats_record_cache_hit(sc_check_id id) {
+    if (id < SC_CHECK_COUNT) counters[id].cacheHits.fetch_add(1, std::memory_order_relaxed);
+}
+
+void check_stats_record_cancelled(sc_check_id id) {
+    if (id < SC_CHECK_COUNT) counters[id].cancelled.fetch_add(1, std::memory_order_relaxed);
+}
+
+void check_stats_record_timeout(sc_check_id id) {
+    if (id < SC_CHECK_COUNT) counters[id].timeouts.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Counters are read one by one, so a snapshot taken while probes run may
+// mix values from before and after a probe; each field is exact.
+void check_stats_snapshot(sc_check_stats* out) {
+    for (int id = 0; id < SC_CHECK_COUNT; ++id) {
+        const CheckCounters& c = counters[id];
+        sc_check_stats& s = out[id];
+        memset(&s, 0, sizeof(s));
+        s.calls = c.calls.load(std::memory_order_relaxed);
+        s.detections = c.detections.load(std::memory_order_relaxed);
+        s.cache_hits = c.cacheHits.load(std::memory_order_relaxed);
+        s.cancelled = c.cancelled.load(std::memory_order_relaxed);
+        s.timeouts = c.timeouts.load(std::memory_order_relaxed);
+        s.total_ns = c.totalNs.load(std::memory_order_relaxed);
+        s.max_ns = c.maxNs.load(std::memory_order_relaxed);
+        for (int b = 0; b < SC_STATS_BUCKETS; ++b) {
+            s.latency_buckets[b] = c.buckets[b].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void check_stats_reset() {
+    for (CheckCounters& c : counters) {
+        c.calls.store(0, std::memory_order_relaxed);
+        c.detections.store(0, std::memory_order_relaxed);
+        c.cacheHits.store(0, std::memory_order_relaxed);
+        c.cancelled.store(0, std::memory_order_relaxed);
+        c.timeouts.store(0, std::memory_order_relaxed);
+        c.totalNs.store(0, std::memory_order_relaxed);
+        c.maxNs.store(0, std::memory_order_relaxed);
+        for (std::atomic<uint32_t>& b : c.buckets) b.store(0, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,396 @@
+#include "crc32_engine.h"
+
+#include <atomic>
+#include <mutex>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CRC32_HAVE_PCLMUL 1
+#include <cpuid.h>
+#include <emmintrin.h>
+#include <smmintrin.h>
+#include <wmmintrin.h>
+#endif
+
+#if defined(__aarch64__)
+#define CRC32_HAVE_ARMV8 1
+#include <arm_acle.h>
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#else
+#include <sys/auxv.h>
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#endif
+#endif
+
+#define CRC32_POLY 0xEDB88320u
+
+// ========== Bitwise (reference) ==========
+static uint32_t crc32_bitwise(uint32_t crc, const unsigned char* data, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        crc ^= data[i];
+        for (int j = 0; j < 8; ++j)
+            crc = (crc >> 1) ^ (CRC32_POLY & -(crc & 1));
+    }
+    return crc;
+}
+
+// ========== Slicing-by-8 / Slicing-by-16 ==========
+// crc_table[k][b] is the CRC of byte b followed by k zero bytes.
+static uint32_t crc_table[16][256];
+
+static void build_tables() {
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int j = 0; j < 8; ++j)
+            c = (c >> 1) ^ (CRC32_POLY & -(c & 1));
+        crc_table[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; ++i) {
+        for (int k = 1; k < 16; ++k) {
+            uint32_t prev = crc_table[k - 1][i];
+            crc_table[k][i] = (prev >> 8) ^ crc_table[0][prev & 0xFF];
+        }
+    }
+}
+
+static inline uint32_t load_le32(const unsigned char* p) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+#else
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+#endif
+}
+
+static inline uint32_t crc32_tail(uint32_t crc, const unsigned char* data, size_t len) {
+    while (len--)
+        crc = (crc >> 8) ^ crc_table[0][(crc ^ *data++) & 0xFF];
+    return crc;
+}
+
+static uint32_t crc32_slice8(uint32_t crc, const unsigned char* data, size_t len) {
+    while (len >= 8) {
+        uint32_t a = load_le32(data) ^ crc;
+        uint32_t b = load_le32(data + 4);
+        crc = crc_table[7][a & 0xFF] ^ crc_table[6][(a >> 8) & 0xFF] ^
+              crc_table[5][(a >> 16) & 0xFF] ^ crc_table[4][a >> 24] ^
+              crc_table[3][b & 0xFF] ^ crc_table[2][(b >> 8) & 0xFF] ^
+              crc_table[1][(b >> 16) & 0xFF] ^ crc_table[0][b >> 24];
+        data += 8;
+        len -= 8;
+    }
+    return crc32_tail(crc, data, len);
+}
+
+static uint32_t crc32_slice16(uint32_t crc, const unsigned char* data, size_t len) {
+    while (len >= 16) {
+        uint32_t a = load_le32(data) ^ crc;
+        uint32_t b = load_le32(data + 4);
+        uint32_t c = load_le32(data + 8);
+        uint32_t d = load_le32(data + 12);
+        crc = crc_table[15][a & 0xFF] ^ crc_table[14][(a >> 8) & 0xFF] ^
+              crc_table[13][(a >> 16) & 0xFF] ^ crc_table[12][a >> 24] ^
+              crc_table[11][b & 0xFF] ^ crc_table[10][(b >> 8) & 0xFF] ^
+              crc_table[9][(b >> 16) & 0xFF] ^ crc_table[8][b >> 24] ^
+              crc_table[7][c & 0xFF] ^ crc_table[6][(c >> 8) & 0xFF] ^
+              crc_table[5][(c >> 16) & 0xFF] ^ crc_table[4][c >> 24] ^
+              crc_table[3][d & 0xFF] ^ crc_table[2][(d >> 8) & 0xFF] ^
+              crc_table[1][(d >> 16) & 0xFF] ^ crc_table[0][d >> 24];
+        data += 16;
+        len -= 16;
+    }
+    return crc32_slice8(crc, data, len);
+}
+
+// ========== x86 PCLMULQDQ folding ==========
+// Folds 4x128-bit lanes in parallel, then reduces with Barrett reduction.
+// Constants are x^k mod P(x) for the bit-reflected CRC-32 polynomial
+// (Intel, "Fast CRC Computation Using PCLMULQDQ Instruction").
+#if defined(CRC32_HAVE_PCLMUL)
+alignas(16) static const uint64_t k1k2[] = {0x0154442bd4ULL, 0x01c6e41596ULL};
+alignas(16) static const uint64_t k3k4[] = {0x01751997d0ULL, 0x00ccaa009eULL};
+alignas(16) static const uint64_t k5k0[] = {0x0163cd6124ULL, 0x0000000000ULL};
+alignas(16) static const uint64_t poly[] = {0x01db710641ULL, 0x01f7011641ULL};
+
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t crc32_pclmul_blocks(uint32_t crc, const unsigned char* buf, size_t len) {
+    // Requires len >= 64 and len % 16 == 0.
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+    __m128i y5, y6, y7, y8;
+
+    x1 = _mm_loadu_si128((const __m128i*)(buf + 0x00));
+    x2 = _mm_loadu_si128((const __m128i*)(buf + 0x10));
+    x3 = _mm_loadu_si128((const __m128i*)(buf + 0x20));
+    x4 = _mm_loadu_si128((const __m128i*)(buf + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+    x0 = _mm_load_si128((const __m128i*)k1k2);
+    buf += 64;
+    len -= 64;
+
+    // Parallel fold 64-byte blocks
+    while (len >= 64) {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+        y5 = _mm_loadu_si128((const __m128i*)(buf + 0x00));
+        y6 = _mm_loadu_si128((const __m128i*)(buf + 0x10));
+        y7 = _mm_loadu_si128((const __m128i*)(buf + 0x20));
+        y8 = _mm_loadu_si128((const __m128i*)(buf + 0x30));
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+        buf += 64;
+        len -= 64;
+    }
+
+    // Fold the four lanes into one
+    x0 = _mm_load_si128((const __m128i*)k3k4);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    // Single fold remaining 16-byte blocks
+    while (len >= 16) {
+        x2 = _mm_loadu_si128((const __m128i*)buf);
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+        buf += 16;
+        len -= 16;
+    }
+
+    // Fold 128 -> 64 bits
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_srli_si128(x1, 8);
+    x1 = _mm_xor_si128(x1, x2);
+    x0 = _mm_loadl_epi64((const __m128i*)k5k0);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, x3);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett reduction to 32 bits
+    x0 = _mm_load_si128((const __m128i*)poly);
+    x2 = _mm_and_si128(x1, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+    return (uint32_t)_mm_extract_epi32(x1, 1);
+}
+
+static uint32_t crc32_pclmul(uint32_t crc, const unsigned char* data, size_t len) {
+    if (len < 64) return crc32_slice16(crc, data, len);
+    size_t blocks = len & ~(size_t)15;
+    crc = crc32_pclmul_blocks(crc, data, blocks);
+    return crc32_slice16(crc, data + blocks, len - blocks);
+}
+
+static bool cpu_has_pclmul() {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+    return (ecx & bit_PCLMUL) && (ecx & bit_SSE4_1);
+}
+#endif
+
+// ========== ARMv8 CRC32 instructions ==========
+#if defined(CRC32_HAVE_ARMV8)
+#if defined(__clang__)
+__attribute__((target("crc")))
+#else
+__attribute__((target("+crc")))
+#endif
+static uint32_t crc32_armv8(uint32_t crc, const unsigned char* data, size_t len) {
+    while (len && ((uintptr_t)data & 7)) {
+        crc = __crc32b(crc, *data++);
+        len--;
+    }
+    while (len >= 32) {
+        uint64_t a, b, c, d;
+        memcpy(&a, data, 8);
+        memcpy(&b, data + 8, 8);
+        memcpy(&c, data + 16, 8);
+        memcpy(&d, data + 24, 8);
+        crc = __crc32d(crc, a);
+        crc = __crc32d(crc, b);
+        crc = __crc32d(crc, c);
+        crc = __crc32d(crc, d);
+        data += 32;
+        len -= 32;
+    }
+    while (len >= 8) {
+        uint64_t a;
+        memcpy(&a, data, 8);
+        crc = __crc32d(crc, a);
+        data += 8;
+        len -= 8;
+    }
+    while (len--)
+        crc = __crc32b(crc, *data++);
+    return crc;
+}
+
+static bool cpu_has_armv8_crc() {
+#if defined(__APPLE__)
+    int value = 0;
+    size_t size = sizeof(value);
+    if (sysctlbyname("hw.optional.armv8_crc32", &value, &size, NULL, 0) != 0) return false;
+    return value != 0;
+#else
+    return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+#endif
+}
+#endif
+
+// ========== Combine ==========
+// Arithmetic in GF(2)[x] modulo the reflected polynomial: bit 31 is x^0.
+static uint32_t multmodp(uint32_t a, uint32_t b) {
+    uint32_t m = 1u << 31;
+    uint32_t p = 0;
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0) break;
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ CRC32_POLY : b >> 1;
+    }
+    return p;
+}
+
+// x2n_table[k] = x^(2^k) mod P(x)
+static uint32_t x2n_table[32];
+static std::once_flag x2n_once;
+
+static void build_x2n_table() {
+    uint32_t p = 1u << 30;  // x^1
+    x2n_table[0] = p;
+    for (int k = 1; k < 32; ++k)
+        x2n_table[k] = p = multmodp(p, p);
+}
+
+// x^(n * 2^k) mod P(x)
+static uint32_t x2nmodp(uint64_t n, unsigned k) {
+    uint32_t p = 1u << 31;  // x^0
+    while (n) {
+        if (n & 1) p = multmodp(x2n_table[k & 31], p);
+        n >>= 1;
+        k++;
+    }
+    return p;
+}
+
+uint32_t crc32_engine_combine(uint32_t crc1, uint32_t crc2, uint64_t len2) {
+    std::call_once(x2n_once, build_x2n_table);
+    return multmodp(x2nmodp(len2, 3), crc1) ^ crc2;
+}
+
+// ========== Runtime dispatch ==========
+static std::once_flag tables_once;
+static std::atomic<crc32_kernel_kind> active_kind(CRC32_KERNEL_SLICE16);
+static std::atomic<crc32_kernel_fn> active_kernel(nullptr);
+
+static void ensure_tables() {
+    std::call_once(tables_once, build_tables);
+}
+
+// Run the candidate over unaligned buffers of every length that exercises
+// its block/tail split and compare with the bitwise reference.
+static bool kernel_matches_reference(crc32_kernel_fn fn) {
+    unsigned char buf[512 + 16];
+    uint32_t seed = 0x12345678u;
+    for (size_t i = 0; i < sizeof(buf); ++i) {
+        seed = seed * 1103515245u + 12345u;
+        buf[i] = (unsigned char)(seed >> 16);
+    }
+    static const size_t lengths[] = {0, 1, 7, 15, 16, 17, 63, 64, 65, 127, 128, 200, 255, 256, 511, 512};
+    for (size_t off = 0; off < 3; ++off) {
+        for (size_t len : lengths) {
+            if (fn(0xFFFFFFFFu, buf + off, len) != crc32_bitwise(0xFFFFFFFFu, buf + off, len))
+                return false;
+        }
+    }
+    return true;
+}
+
+crc32_kernel_fn crc32_engine_kernel(crc32_kernel_kind kind) {
+    ensure_tables();
+    switch (kind) {
+        case CRC32_KERNEL_BITWISE: return crc32_bitwise;
+        case CRC32_KERNEL_SLICE8: return crc32_slice8;
+        case CRC32_KERNEL_SLICE16: return crc32_slice16;
+#if defined(CRC32_HAVE_PCLMUL)
+        case CRC32_KERNEL_PCLMUL: return cpu_has_pclmul() ? crc32_pclmul : nullptr;
+#endif
+#if defined(CRC32_HAVE_ARMV8)
+        case CRC32_KERNEL_ARMV8: return cpu_has_armv8_crc() ? crc32_armv8 : nullptr;
+#endif
+        default: return nullptr;
+    }
+}
+
+static crc32_kernel_fn select_kernel() {
+    static const crc32_kernel_kind preferred[] = {CRC32_KERNEL_ARMV8, CRC32_KERNEL_PCLMUL};
+    for (crc32_kernel_kind kind : preferred) {
+        crc32_kernel_fn fn = crc32_engine_kernel(kind);
+        if (fn && kernel_matches_reference(fn)) {
+            active_kind.store(kind, std::memory_order_relaxed);
+            return fn;
+        }
+    }
+    active_kind.store(CRC32_KERNEL_SLICE16, std::memory_order_relaxed);
+    return crc32_engine_kernel(CRC32_KERNEL_SLICE16);
+}
+
+static crc32_kernel_fn resolve_kernel() {
+    crc32_kernel_fn fn = active_kernel.load(std::memory_order_acquire);
+    if (!fn) {
+        static std::once_flag select_once;
+        std::call_once(select_once, [] { active_kernel.store(select_kernel(), std::memory_order_release); });
+        fn = active_kernel.load(std::memory_order_acquire);
+    }
+    return fn;
+}
+
+// Pick the kernel when the library is loaded so the first checksum on the
+// JS thread does not pay for table generation and the self-test.
+__attribute__((constructor)) static void crc32_engine_init() {
+    resolve_kernel();
+}
+
+uint32_t crc32_engine_update(uint32_t crc, const unsigned char* data, size_t len) {
+    return resolve_kernel()(crc, data, len);
+}
+
+crc32_kernel_kind crc32_engine_active_kernel() {
+    resolve_kernel();
+    return active_kind.load(std::memory_order_relaxed);
+}
+
+const char* crc32_engine_kernel_name(crc32_kernel_kind kind) {
+    switch (kind) {
+        case CRC32_KERNEL_BITWISE: return "bitwise";
+        case CRC32_KERNEL_SLICE8: return "slice8";
+        case CRC32_KERNEL_SLICE16: return "slice16";
+        case CRC32_KERNEL_PCLMUL: return "pclmul";
+        case CRC32_KERNEL_ARMV8: return "armv8";
+        default: return "unknown";
+    }
+}
@@ -0,0 +1,155 @@
+#include "event_loop.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#if defined(__APPLE__)
+#include <sys/event.h>
+#include <sys/time.h>
+#else
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+static const int MAX_NATIVE_EVENTS = 16;
+
+#if defined(__APPLE__)
+// ========== kqueue ==========
+EventLoop::EventLoop() {
+    pollFd = kqueue();
+    int fds[2];
+    if (pollFd < 0 || pipe(fds) != 0) return;
+    for (int fd : fds) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    wakeRead = fds[0];
+    wakeWrite = fds[1];
+    struct kevent change;
+    EV_SET(&change, wakeRead, EVFILT_READ, EV_ADD, 0, 0, nullptr);
+    kevent(pollFd, &change, 1, nullptr, 0, nullptr);
+}
+
+bool EventLoop::watch(int fd, unsigned events) {
+    // EV_ADD on an existing filter just updates it, so no state is needed.
+    struct kevent changes[2];
+    EV_SET(&changes[0], fd, EVFILT_READ, EV_ADD | ((events & READABLE) ? EV_ENABLE : EV_DISABLE), 0, 0, nullptr);
+    EV_SET(&changes[1], fd, EVFILT_WRITE, EV_ADD | ((events & WRITABLE) ? EV_ENABLE : EV_DISABLE), 0, 0, nullptr);
+    return kevent(pollFd, changes, 2, nullptr, 0, nullptr) == 0;
+}
+
+void EventLoop::unwatch(int fd) {
+    struct kevent changes[2];
+    EV_SET(&changes[0], fd, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+    EV_SET(&changes[1], fd, EVFILT_WRITE, EV_DELETE, 0, 0, nullptr);
+    kevent(pollFd, changes, 2, nullptr, 0, nullptr);
+}
+
+int EventLoop::wait(Event* events, int maxEvents, int timeoutMs) {
+    struct kevent native[MAX_NATIVE_EVENTS];
+    struct timespec ts;
+    if (timeoutMs >= 0) {
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = (long)(timeoutMs % 1000) * 1000000L;
+    }
+    int n = kevent(pollFd, nullptr, 0, native, MAX_NATIVE_EVENTS, timeoutMs >= 0 ? &ts : nullptr);
+    if (n < 0) return errno == EINTR ? 0 : -1;
+
+    // kqueue reports read and write readiness as separate events.
+    int count = 0;
+    for (int i = 0; i < n; ++i) {
+        int fd = (int)native[i].ident;
+        if (fd == wakeRead) {
+            drainWake();
+            continue;
+        }
+        unsigned ev = native[i].filter == EVFILT_READ ? READABLE : WRITABLE;
+        if (native[i].flags & (EV_EOF | EV_ERROR)) ev = READABLE | WRITABLE;
+        int j = 0;
+        while (j < count && events[j].fd != fd) ++j;
+        if (j < count) {
+            events[j].events |= ev;
+        } else if (count < maxEvents) {
+            events[count].fd = fd;
+            events[count].events = ev;
+            ++count;
+        }
+    }
+    return count;
+}
+
+void EventLoop::wake() {
+    char byte = 1;
+    (void)!write(wakeWrite, &byte, 1);
+}
+
+void EventLoop::drainWake() {
+    char buf[64];
+    while (read(wakeRead, buf, sizeof(buf)) > 0) {
+    }
+}
+
+#else
+// ========== epoll ==========
+EventLoop::EventLoop() {
+    pollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeRead = wakeWrite = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (pollFd < 0 || wakeRead < 0) return;
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = wakeRead;
+    epoll_ctl(pollFd, EPOLL_CTL_ADD, wakeRead, &ev);
+}
+
+bool EventLoop::watch(int fd, unsigned events) {
+    struct epoll_event ev = {};
+    ev.events = ((events & READABLE) ? (uint32_t)EPOLLIN : 0u) | ((events & WRITABLE) ? (uint32_t)EPOLLOUT : 0u);
+    ev.data.fd = fd;
+    if (epoll_ctl(pollFd, EPOLL_CTL_MOD, fd, &ev) == 0) return true;
+    return errno == ENOENT && epoll_ctl(pollFd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+void EventLoop::unwatch(int fd) {
+    epoll_ctl(pollFd, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+int EventLoop::wait(Event* events, int maxEvents, int timeoutMs) {
+    struct epoll_event native[MAX_NATIVE_EVENTS];
+    int n = epoll_wait(pollFd, native, MAX_NATIVE_EVENTS, timeoutMs);
+    if (n < 0) return errno == EINTR ? 0 : -1;
+
+    int count = 0;
+    for (int i = 0; i < n; ++i) {
+        if (native[i].data.fd == wakeRead) {
+            drainWake();
+            continue;
+        }
+        if (count == maxEvents) break;  // level-triggered: reported again next time
+        uint32_t e = native[i].events;
+        unsigned ev = ((e & EPOLLIN) ? READABLE : 0) | ((e & EPOLLOUT) ? WRITABLE : 0);
+        if (e & (EPOLLERR | EPOLLHUP)) ev = READABLE | WRITABLE;
+        events[count].fd = native[i].data.fd;
+        events[count].events = ev;
+        ++count;
+    }
+    return count;
+}
+
+void EventLoop::wake() {
+    uint64_t one = 1;
+    (void)!write(wakeWrite, &one, sizeof(one));
+}
+
+void EventLoop::drainWake() {
+    uint64_t value;
+    (void)!read(wakeRead, &value, sizeof(value));
+}
+#endif
+
+EventLoop::~EventLoop() {
+    if (wakeWrite >= 0 && wakeWrite != wakeRead) close(wakeWrite);
+    if (wakeRead >= 0) close(wakeRead);
+    if (pollFd >= 0) close(pollFd);
+}
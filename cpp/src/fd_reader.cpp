@@ -0,0 +1,71 @@
+#include "fd_reader.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+// Buffer for the pread()/read() paths.
+static const size_t READ_BUFFER = 256 * 1024;
+
+static void advise_sequential(int fd) {
+#if defined(__APPLE__)
+    fcntl(fd, F_RDAHEAD, 1);
+#else
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+}
+
+enum MapResult { MAP_DONE, MAP_STOPPED, MAP_UNSUPPORTED };
+
+// MAP_UNSUPPORTED only when the first window cannot be mapped (some FUSE
+// and network filesystems), before anything was handed to fn.
+static MapResult read_mapped(int fd, size_t size, FdChunkCallback fn, void* userdata) {
+    for (size_t offset = 0; offset < size; offset += FD_READER_WINDOW) {
+        size_t len = size - offset < FD_READER_WINDOW ? size - offset : FD_READER_WINDOW;
+        void* map = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, (off_t)offset);
+        if (map == MAP_FAILED) return offset == 0 ? MAP_UNSUPPORTED : MAP_STOPPED;
+        madvise(map, len, MADV_SEQUENTIAL);
+        bool more = fn((const unsigned char*)map, len, userdata);
+        munmap(map, len);
+        if (!more) return MAP_STOPPED;
+    }
+    return MAP_DONE;
+}
+
+// pread() from offset 0, or read() from the current position when the
+// descriptor is not seekable.
+static bool read_buffered(int fd, bool seekable, FdChunkCallback fn, void* userdata) {
+    std::vector<unsigned char> buf(READ_BUFFER);
+    off_t offset = 0;
+    for (;;) {
+        ssize_t n = seekable ? pread(fd, buf.data(), buf.size(), offset) : read(fd, buf.data(), buf.size());
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == ESPIPE && seekable) {
+                seekable = false;
+                continue;
+            }
+            return false;
+        }
+        if (n == 0) return true;
+        offset += n;
+        if (!fn(buf.data(), (size_t)n, userdata)) return false;
+    }
+}
+
+bool fd_read_chunks(int fd, FdChunkCallback fn, void* userdata) {
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) return false;
+    if (!S_ISREG(st.st_mode)) return read_buffered(fd, false, fn, userdata);
+
+    advise_sequential(fd);
+    size_t size = (size_t)st.st_size;
+    if (size >= FD_READER_MMAP_MIN) {
+        MapResult mapped = read_mapped(fd, size, fn, userdata);
+        if (mapped != MAP_UNSUPPORTED) return mapped == MAP_DONE;
+    }
+    return read_buffered(fd, true, fn, userdata);
+}
@@ -0,0 +1,184 @@
+#include "file_manifest.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#if defined(__APPLE__)
+#define SC_ST_MTIM st_mtimespec
+#define SC_ST_CTIM st_ctimespec
+#else
+#define SC_ST_MTIM st_mtim
+#define SC_ST_CTIM st_ctim
+#endif
+
+static const size_t CACHE_HEADER = 16;
+
+// Serializes cache rewrites; readers only ever see a complete file.
+static std::mutex cache_mutex;
+
+static bool record_less(const FileCacheRecord& a, const FileCacheRecord& b) {
+    return a.dev != b.dev ? a.dev < b.dev : a.ino < b.ino;
+}
+
+static bool same_stamp(const FileCacheRecord& a, const FileCacheRecord& b) {
+    return a.dev == b.dev && a.ino == b.ino && a.size == b.size && a.mtimeSec == b.mtimeSec &&
+           a.mtimeNsec == b.mtimeNsec && a.ctimeSec == b.ctimeSec && a.ctimeNsec == b.ctimeNsec;
+}
+
+static FileCacheRecord stamp_of(const struct stat& st) {
+    FileCacheRecord r;
+    memset(&r, 0, sizeof(r));
+    r.dev = (uint64_t)st.st_dev;
+    r.ino = (uint64_t)st.st_ino;
+    r.size = (uint64_t)st.st_size;
+    r.mtimeSec = (int64_t)st.SC_ST_MTIM.tv_sec;
+    r.mtimeNsec = (int64_t)st.SC_ST_MTIM.tv_nsec;
+    r.ctimeSec = (int64_t)st.SC_ST_CTIM.tv_sec;
+    r.ctimeNsec = (int64_t)st.SC_ST_CTIM.tv_nsec;
+    return r;
+}
+
+static bool read_all(int fd, std::string& out) {
+    char buf[16 * 1024];
+    for (;;) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n < 0) return false;
+        if (n == 0) return true;
+        out.append(buf, (size_t)n);
+        if (out.size() > CACHE_HEADER + SC_FILE_CACHE_MAX_RECORDS * sizeof(FileCacheRecord) + 4) return false;
+    }
+}
+
+// Empty on any damage: the cache is only an optimization.
+static std::vector<FileCacheRecord> load_cache(const char* path) {
+    std::vector<FileCacheRecord> records;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return records;
+    std::string data;
+    bool ok = read_all(fd, data);
+    close(fd);
+    if (!ok || data.size() < CACHE_HEADER + 4) return records;
+
+    const unsigned char* p = (const unsigned char*)data.data();
+    uint32_t version, count, crc;
+    memcpy(&version, p + 8, 4);
+    memcpy(&count, p + 12, 4);
+    if (memcmp(p, SC_FILE_CACHE_MAGIC, 8) != 0 || version != SC_FILE_CACHE_VERSION) return records;
+    if (count > SC_FILE_CACHE_MAX_RECORDS || data.size() != CACHE_HEADER + count * sizeof(FileCacheRecord) + 4) {
+        return records;
+    }
+    memcpy(&crc, p + data.size() - 4, 4);
+    if (crc != sc_crc32((unsigned char*)p, data.size() - 4)) return records;
+
+    records.resize(count);
+    if (count) memcpy(records.data(), p + CACHE_HEADER, count * sizeof(FileCacheRecord));
+    return records;
+}
+
+// Written to a temporary file and renamed over the old cache.
+static void store_cache(const char* path, const std::vector<FileCacheRecord>& records) {
+    std::string data(SC_FILE_CACHE_MAGIC, 8);
+    uint32_t version = SC_FILE_CACHE_VERSION;
+    uint32_t count = (uint32_t)records.size();
+    data.append((const char*)&version, 4);
+    data.append((const char*)&count, 4);
+    if (count) data.append((const char*)records.data(), count * sizeof(FileCacheRecord));
+    uint32_t crc = sc_crc32((unsigned char*)&data[0], data.size());
+    data.append((const char*)&crc, 4);
+
+    std::string tmp = std::string(path) + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) return;
+    bool ok = write(fd, data.data(), data.size()) == (ssize_t)data.size();
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(tmp.c_str(), path) != 0) unlink(tmp.c_str());
+}
+
+static const FileCacheRecord* find_record(const std::vector<FileCacheRecord>& sorted, const FileCacheRecord& key) {
+    auto it = std::lower_bound(sorted.begin(), sorted.end(), key, record_less);
+    return it != sorted.end() && it->dev == key.dev && it->ino == key.ino ? &*it : nullptr;
+}
+
+bool file_manifest_verify(const sc_file_digest* files, size_t count, const char* cachePath,
+                          sc_file_status* statuses) {
+    std::vector<FileCacheRecord> cached;
+    if (cachePath) {
+        cached = load_cache(cachePath);
+        std::sort(cached.begin(), cached.end(), record_less);
+    }
+
+    std::vector<sc_file_status> status(count, SC_FILE_UNREADABLE);
+    std::vector<FileCacheRecord> stamps(count);
+    std::vector<char> stable(count, 0);
+    ThreadPool::shared().parallelFor(count, [&](size_t i) {
+        int fd = open(files[i].path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return;
+        struct stat before, after;
+        if (fstat(fd, &before) != 0 || !S_ISREG(before.st_mode)) {
+            close(fd);
+            return;
+        }
+        stamps[i] = stamp_of(before);
+        memcpy(stamps[i].sha256, files[i].sha256, SC_SHA256_LENGTH);
+
+        const FileCacheRecord* hit = find_record(cached, stamps[i]);
+        if (hit && same_stamp(*hit, stamps[i]) && memcmp(hit->sha256, files[i].sha256, SC_SHA256_LENGTH) == 0) {
+            close(fd);
+            status[i] = SC_FILE_CACHED;
+            stable[i] = true;
+            return;
+        }
+
+        unsigned char digest[SC_SHA256_LENGTH];
+        if (sha256_fd(fd, digest)) {
+            status[i] = memcmp(digest, files[i].sha256, SC_SHA256_LENGTH) == 0 ? SC_FILE_VERIFIED : SC_FILE_MISMATCH;
+            // Modified while being hashed: the result stands, but it is
+            // not remembered against either version of the file.
+            stable[i] = fstat(fd, &after) == 0 && same_stamp(stamp_of(after), stamps[i]);
+        }
+        close(fd);
+    });
+
+    bool ok = true;
+    for (size_t i = 0; i < count; ++i) {
+        if (statuses) statuses[i] = status[i];
+        if (status[i] != SC_FILE_VERIFIED && status[i] != SC_FILE_CACHED) ok = false;
+    }
+    if (!cachePath) return ok;
+
+    // Files in this call replace whatever the cache held for their inode;
+    // records for other files (another manifest sharing the cache) stay.
+    std::vector<FileCacheRecord> next;
+    std::vector<FileCacheRecord> seen;
+    for (size_t i = 0; i < count; ++i) {
+        if (status[i] == SC_FILE_UNREADABLE) continue;
+        seen.push_back(stamps[i]);
+        bool good = status[i] == SC_FILE_VERIFIED || status[i] == SC_FILE_CACHED;
+        if (good && stable[i]) next.push_back(stamps[i]);
+    }
+    std::sort(seen.begin(), seen.end(), record_less);
+    for (const FileCacheRecord& r : cached) {
+        if (next.size() >= SC_FILE_CACHE_MAX_RECORDS) break;
+        if (!find_record(seen, r)) next.push_back(r);
+    }
+    if (next.size() > SC_FILE_CACHE_MAX_RECORDS) next.resize(SC_FILE_CACHE_MAX_RECORDS);
+    std::sort(next.begin(), next.end(), record_less);
+    next.erase(std::unique(next.begin(), next.end(),
+                           [](const FileCacheRecord& a, const FileCacheRecord& b) { return !record_less(a, b) && !record_less(b, a); }),
+               next.end());
+
+    if (next.size() != cached.size() ||
+        (!next.empty() && memcmp(next.data(), cached.data(), next.size() * sizeof(FileCacheRecord)) != 0)) {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        store_cache(cachePath, next);
+    }
+    return ok;
+}
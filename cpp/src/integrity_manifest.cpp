@@ -0,0 +1,178 @@
+#include "integrity_manifest.h"
+#include "crc32_engine.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string.h>
+#include <vector>
+
+#if defined(__linux__) || defined(__ANDROID__)
+#include <link.h>
+#define SC_MANIFEST_ELF 1
+#endif
+
+// Filled in by scripts/seal_manifest.py; see integrity_manifest.h.
+#if defined(SC_MANIFEST_ELF)
+extern "C" {
+__attribute__((used, section(".sc_manifest"), visibility("hidden")))
+sc_manifest sc_embedded_manifest = {
+    {'S', 'C', 'M', 'A', 'N', 'I', 'F', '1'}, SC_MANIFEST_VERSION, 0, SC_MANIFEST_PAGE_SIZE, 0, 0, 0, {}, {}
+};
+}
+#endif
+
+// Pages per parallel work item (128 KiB with 4 KiB pages).
+static const size_t PAGES_PER_CHUNK = 32;
+
+namespace {
+struct PageRange {
+    const unsigned char* addr;
+    uint32_t len;
+};
+
+struct IntegrityState {
+    bool available = false;
+    const sc_manifest* manifest = nullptr;
+    std::vector<PageRange> pages;
+};
+}
+
+static IntegrityState state;
+static std::once_flag state_once;
+static std::atomic<uint32_t> hot_bits[SC_MANIFEST_MAX_PAGES / 32];
+static std::atomic<uint32_t> sample_cursor(0);
+
+#if defined(SC_MANIFEST_ELF)
+struct FindSelfArg {
+    uintptr_t target;
+    uintptr_t bias;
+    bool found;
+};
+
+static int find_self_callback(struct dl_phdr_info* info, size_t, void* data) {
+    FindSelfArg* arg = (FindSelfArg*)data;
+    for (int i = 0; i < info->dlpi_phnum; ++i) {
+        const ElfW(Phdr)& ph = info->dlpi_phdr[i];
+        if (ph.p_type != PT_LOAD) continue;
+        uintptr_t start = info->dlpi_addr + ph.p_vaddr;
+        if (arg->target >= start && arg->target < start + ph.p_memsz) {
+            arg->bias = info->dlpi_addr;
+            arg->found = true;
+            return 1;
+        }
+    }
+    return 0;
+}
+#endif
+
+static void load_state() {
+#if defined(SC_MANIFEST_ELF)
+    // Hide the manifest's origin from the optimizer: it is never written by
+    // this program, but its contents are patched in the file after linking.
+    const sc_manifest* m = &sc_embedded_manifest;
+    __asm__ volatile("" : "+r"(m));
+
+    if (!m->sealed || m->version != SC_MANIFEST_VERSION || m->page_size != SC_MANIFEST_PAGE_SIZE) return;
+    if (m->segment_count > SC_MANIFEST_MAX_SEGMENTS || m->page_count > SC_MANIFEST_MAX_PAGES) return;
+
+    FindSelfArg arg = {(uintptr_t)m, 0, false};
+    dl_iterate_phdr(find_self_callback, &arg);
+    if (!arg.found) return;
+
+    state.pages.resize(m->page_count);
+    for (uint32_t s = 0; s < m->segment_count; ++s) {
+        const sc_manifest_segment& seg = m->segments[s];
+        if (seg.first_page + seg.page_count > m->page_count) return;
+        const unsigned char* base = (const unsigned char*)(arg.bias + seg.vaddr);
+        for (uint32_t p = 0; p < seg.page_count; ++p) {
+            uint64_t offset = (uint64_t)p * m->page_size;
+            uint64_t remaining = seg.size - offset;
+            PageRange& range = state.pages[seg.first_page + p];
+            range.addr = base + offset;
+            range.len = (uint32_t)(remaining < m->page_size ? remaining : m->page_size);
+        }
+    }
+    state.manifest = m;
+    state.available = true;
+#endif
+}
+
+static bool ensure_state() {
+    std::call_once(state_once, load_state);
+    return state.available;
+}
+
+static void set_hot(uint32_t page, bool hot) {
+    uint32_t bit = 1u << (page & 31);
+    if (hot) {
+        hot_bits[page >> 5].fetch_or(bit, std::memory_order_relaxed);
+    } else {
+        hot_bits[page >> 5].fetch_and(~bit, std::memory_order_relaxed);
+    }
+}
+
+static bool verify_page(uint32_t page) {
+    const PageRange& range = state.pages[page];
+    uint32_t crc = ~crc32_engine_update(0xFFFFFFFFu, range.addr, range.len);
+    bool ok = crc == state.manifest->page_crc[page];
+    set_hot(page, !ok);
+    return ok;
+}
+
+static bool verify_pages(const std::vector<uint32_t>& pages) {
+    std::atomic<bool> ok(true);
+    size_t chunks = (pages.size() + PAGES_PER_CHUNK - 1) / PAGES_PER_CHUNK;
+    ThreadPool::shared().parallelFor(chunks, [&](size_t c) {
+        size_t end = std::min(pages.size(), (c + 1) * PAGES_PER_CHUNK);
+        for (size_t i = c * PAGES_PER_CHUNK; i < end; ++i) {
+            if (!verify_page(pages[i])) ok.store(false, std::memory_order_relaxed);
+        }
+    });
+    return ok.load();
+}
+
+bool integrity_manifest_available() {
+    return ensure_state();
+}
+
+bool integrity_verify_all() {
+    if (!ensure_state()) return true;
+    std::vector<uint32_t> pages(state.pages.size());
+    for (uint32_t i = 0; i < pages.size(); ++i) pages[i] = i;
+    return verify_pages(pages);
+}
+
+bool integrity_verify_hot(unsigned int sample_pages) {
+    if (!ensure_state()) return true;
+    uint32_t total = (uint32_t)state.pages.size();
+    if (total == 0) return true;
+
+    std::vector<uint32_t> pages;
+    for (uint32_t w = 0; w < (total + 31) / 32; ++w) {
+        uint32_t bits = hot_bits[w].load(std::memory_order_relaxed);
+        while (bits) {
+            uint32_t b = __builtin_ctz(bits);
+            pages.push_back(w * 32 + b);
+            bits &= bits - 1;
+        }
+    }
+
+    if (sample_pages > total) sample_pages = total;
+    uint32_t start = sample_cursor.fetch_add(sample_pages, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < sample_pages; ++i) {
+        pages.push_back((start + i) % total);
+    }
+    return verify_pages(pages);
+}
+
+void integrity_mark_hot(const void* addr, size_t len) {
+    if (!ensure_state() || len == 0) return;
+    const unsigned char* begin = (const unsigned char*)addr;
+    const unsigned char* end = begin + len;
+    for (uint32_t i = 0; i < state.pages.size(); ++i) {
+        const PageRange& range = state.pages[i];
+        if (range.addr < end && begin < range.addr + range.len) set_hot(i, true);
+    }
+}
@@ -0,0 +1,156 @@
+#include "monitor.h"
+
+#include <algorithm>
+#if defined(__linux__)
+#include <sys/prctl.h>
+#endif
+
+// Timer slack requested for the monitor thread. Periodic checks do not care
+// about a few tens of milliseconds, and a large slack lets the kernel batch
+// our wakeups with other timers instead of waking the CPU just for us.
+static const unsigned long TIMER_SLACK_NS = 50UL * 1000 * 1000;
+
+Monitor::~Monitor() {
+    stop();
+}
+
+int Monitor::add(uint32_t minIntervalMs, uint32_t maxIntervalMs, Task task) {
+    std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+    entry->minMs = std::max<uint32_t>(minIntervalMs, 1);
+    entry->maxMs = std::max(maxIntervalMs, entry->minMs);
+    entry->currentMs = entry->minMs;
+    entry->next = Clock::now();
+    entry->task = std::move(task);
+    entry->removed = false;
+    int handle;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        handle = entry->handle = nextHandle++;
+        entries.push_back(entry);
+    }
+    cv.notify_all();
+    return handle;
+}
+
+void Monitor::remove(int handle) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i]->handle == handle) {
+            entries[i]->removed = true;
+            entries.erase(entries.begin() + i);
+            return;
+        }
+    }
+}
+
+void Monitor::setListener(Listener l) {
+    std::lock_guard<std::mutex> lock(mutex);
+    listener = std::move(l);
+}
+
+void Monitor::start() {
+    std::lock_guard<std::mutex> guard(lifecycle);
+    uint32_t gen;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        paused = false;
+        if (active) {
+            cv.notify_all();
+            return;
+        }
+        active = true;
+        gen = generation;
+    }
+    thread = std::thread(&Monitor::threadLoop, this, gen);
+}
+
+void Monitor::stop() {
+    std::lock_guard<std::mutex> guard(lifecycle);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!active) return;
+        active = false;
+        ++generation;
+    }
+    cv.notify_all();
+    // A task may stop the monitor it runs on; the loop exits after it returns.
+    if (thread.get_id() == std::this_thread::get_id()) {
+        thread.detach();
+    } else if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void Monitor::pause() {
+    std::lock_guard<std::mutex> lock(mutex);
+    paused = true;
+}
+
+void Monitor::resume() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!paused) return;
+        paused = false;
+        Clock::time_point now = Clock::now();
+        for (const std::shared_ptr<Entry>& e : entries) e->next = now;
+    }
+    cv.notify_all();
+}
+
+bool Monitor::running() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return active && !paused;
+}
+
+void Monitor::threadLoop(uint32_t gen) {
+#if defined(__linux__)
+    prctl(PR_SET_TIMERSLACK, TIMER_SLACK_NS, 0, 0, 0);
+#endif
+    std::vector<std::shared_ptr<Entry>> due;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (generation == gen) {
+        if (paused || entries.empty()) {
+            cv.wait(lock);
+            continue;
+        }
+
+        Clock::time_point wake = entries[0]->next;
+        for (const std::shared_ptr<Entry>& e : entries) wake = std::min(wake, e->next);
+        Clock::time_point now = Clock::now();
+        if (wake > now) {
+            cv.wait_until(lock, wake);
+            continue;
+        }
+
+        // Everything due now, plus tasks close enough to share this wakeup.
+        due.clear();
+        for (const std::shared_ptr<Entry>& e : entries) {
+            if (e->next <= now + std::chrono::milliseconds(e->currentMs / 8)) due.push_back(e);
+        }
+        Listener notify = listener;
+        lock.unlock();
+
+        std::vector<bool> detected(due.size());
+        for (size_t i = 0; i < due.size(); ++i) {
+            detected[i] = due[i]->task();
+            if (detected[i] && notify) notify(due[i]->handle);
+        }
+
+        lock.lock();
+        now = Clock::now();
+        for (size_t i = 0; i < due.size(); ++i) {
+            Entry& e = *due[i];
+            if (e.removed) continue;
+            e.currentMs = detected[i] ? e.minMs : (uint32_t)std::min<uint64_t>((uint64_t)e.currentMs * 2, e.maxMs);
+            e.next = now + std::chrono::milliseconds(e.currentMs);
+        }
+        due.clear();
+    }
+}
+
+Monitor& Monitor::shared() {
+    // Intentionally leaked: the monitor thread may still be running during
+    // static destruction.
+    static Monitor* monitor = new Monitor();
+    return *monitor;
+}
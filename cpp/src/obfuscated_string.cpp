@@ -0,0 +1,35 @@
+#include "obfuscated_string.h"
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define OBF_SIMD_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define OBF_SIMD_NEON 1
+#endif
+
+void obfuscated_xor(char* out, const char* in, const uint8_t key[16], size_t len) {
+    size_t i = 0;
+#if defined(OBF_SIMD_SSE2)
+    const __m128i k = _mm_loadu_si128((const __m128i*)key);
+    for (; i + 16 <= len; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(in + i));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_xor_si128(x, k));
+    }
+#elif defined(OBF_SIMD_NEON)
+    const uint8x16_t k = vld1q_u8(key);
+    for (; i + 16 <= len; i += 16) {
+        vst1q_u8((uint8_t*)(out + i), veorq_u8(vld1q_u8((const uint8_t*)(in + i)), k));
+    }
+#endif
+    for (; i < len; ++i) {
+        out[i] = (char)(in[i] ^ key[i & 15]);
+    }
+}
+
+void obfuscated_wipe(void* data, size_t len) {
+    memset(data, 0, len);
+    __asm__ __volatile__("" : : "r"(data) : "memory");
+}
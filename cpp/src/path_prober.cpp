@@ -0,0 +1,352 @@
+#include "path_prober.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <poll.h>
+#endif
+
+#if defined(__linux__) && !defined(__ANDROID__)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define PROBER_HAVE_IO_URING 1
+#endif
+#endif
+
+#if defined(O_PATH)
+#define PROBER_DIR_FLAGS (O_PATH | O_DIRECTORY | O_CLOEXEC)
+#else
+#define PROBER_DIR_FLAGS (O_RDONLY | O_DIRECTORY | O_CLOEXEC)
+#endif
+
+// Directory fd states besides a valid descriptor
+static const int DIR_MISSING = -1;      // parent does not exist: no child can
+static const int DIR_UNAVAILABLE = -2;  // exists but cannot be opened: probe by absolute path
+
+// IORING_OP_STATX completes on an io-wq worker, so one or two lookups are
+// cheaper as plain faccessat() calls. The indicator groups probed together
+// are 5-7 paths, which already go out in one io_uring_enter().
+static const size_t IO_URING_MIN_BATCH = 4;
+
+// Parents that were missing or could not be opened are retried after this
+// long even when the mount table has not changed, so a directory created
+// later is seen.
+static const uint64_t MISSING_DIR_RETRY_NS = 1000ULL * 1000 * 1000;
+
+// ========== Mount Change Detection ==========
+// /proc/self/mounts reports POLLPRI once per change of the mount table.
+// setRoot() also bumps the generation so cached dirfds are reopened.
+static std::atomic<uint32_t> mount_generation(0);
+
+#if defined(SECURITY_CORE_BENCH)
+static std::mutex root_mutex;
+static std::string root_prefix;
+
+static std::string current_root() {
+    std::lock_guard<std::mutex> lock(root_mutex);
+    return root_prefix;
+}
+#else
+static std::string current_root() {
+    return std::string();
+}
+#endif
+
+static uint32_t current_mount_generation() {
+#if defined(__linux__)
+    static int mounts_fd = open("/proc/self/mounts", O_RDONLY | O_CLOEXEC);
+    if (mounts_fd >= 0) {
+        struct pollfd pfd = {mounts_fd, POLLPRI, 0};
+        if (poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLPRI | POLLERR))) {
+            mount_generation.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+#endif
+    return mount_generation.load(std::memory_order_relaxed);
+}
+
+// ========== io_uring (desktop Linux) ==========
+#if defined(PROBER_HAVE_IO_URING)
+namespace {
+class StatxRing {
+public:
+    // Returns false if io_uring or IORING_OP_STATX is unavailable; the
+    // caller then falls back to faccessat().
+    bool statxBatch(const int* dirfds, const char* const* names, size_t count, bool* exists) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!ensureRing()) return false;
+
+        size_t done = 0;
+        while (done < count) {
+            size_t batch = std::min(count - done, (size_t)sqEntries);
+            unsigned tail = *sqTail;
+            for (size_t i = 0; i < batch; ++i) {
+                unsigned idx = tail & *sqMask;
+                struct io_uring_sqe* sqe = &sqes[idx];
+                memset(sqe, 0, sizeof(*sqe));
+                sqe->opcode = IORING_OP_STATX;
+                sqe->fd = dirfds[done + i];
+                sqe->addr = (uint64_t)(uintptr_t)names[done + i];
+                sqe->len = 0x1;  // STATX_TYPE; existence is all we need
+                sqe->off = (uint64_t)(uintptr_t)&statxBuf[256 * i];
+                sqe->user_data = done + i;
+                sqArray[idx] = idx;
+                tail++;
+            }
+            __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+
+            // Nothing is in flight after a failed submit; the ring goes away
+            // with the unsubmitted entries.
+            long submitted = syscall(__NR_io_uring_enter, ringFd, (unsigned)batch, (unsigned)batch,
+                                     IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (submitted <= 0) {
+                disable();
+                return false;
+            }
+            // The kernel writes into statxBuf until every submitted entry has
+            // completed, so all of them are reaped before giving up.
+            bool unsupported = false;
+            if (!reap((size_t)submitted, exists, &unsupported)) {
+                usable = false;  // still in flight: keep the ring and buffer mapped
+                return false;
+            }
+            if (unsupported || (size_t)submitted < batch) {
+                disable();
+                return false;
+            }
+            done += batch;
+        }
+        return true;
+    }
+
+private:
+    std::mutex mutex;
+    bool initialized = false;
+    bool usable = false;
+    int ringFd = -1;
+    void* sqRing = nullptr;
+    void* cqRing = nullptr;
+    size_t sqRingSize = 0, cqRingSize = 0, sqesSize = 0;
+    unsigned sqEntries = 0;
+    unsigned *sqHead = nullptr, *sqTail = nullptr, *sqMask = nullptr, *sqArray = nullptr;
+    unsigned *cqHead = nullptr, *cqTail = nullptr, *cqMask = nullptr;
+    struct io_uring_sqe* sqes = nullptr;
+    struct io_uring_cqe* cqes = nullptr;
+    // STATX results, one 256-byte struct statx per SQ entry. The ring is
+    // never freed, so neither is this.
+    std::vector<unsigned char> statxBuf;
+
+    // Wait for `inFlight` completions. Sets *unsupported on -EINVAL (kernel
+    // older than 5.6: no IORING_OP_STATX). Returns false if the wait fails
+    // with requests still outstanding.
+    bool reap(size_t inFlight, bool* exists, bool* unsupported) {
+        unsigned head = *cqHead;
+        while (inFlight > 0) {
+            unsigned cqTailValue = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+            if (head == cqTailValue) {
+                __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+                if (syscall(__NR_io_uring_enter, ringFd, 0u, (unsigned)inFlight, IORING_ENTER_GETEVENTS,
+                            nullptr, 0) < 0 && errno != EINTR) {
+                    return false;
+                }
+                continue;
+            }
+            struct io_uring_cqe* cqe = &cqes[head & *cqMask];
+            if (cqe->res == -EINVAL) *unsupported = true;
+            exists[cqe->user_data] = cqe->res == 0;
+            head++;
+            inFlight--;
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    bool ensureRing() {
+        if (initialized) return usable;
+        initialized = true;
+
+        struct io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        ringFd = (int)syscall(__NR_io_uring_setup, 32, &params);
+        if (ringFd < 0) return false;
+
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+        }
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED) {
+            sqRing = nullptr;
+            disable();
+            return false;
+        }
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            cqRing = sqRing;
+        } else {
+            cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+            if (cqRing == MAP_FAILED) {
+                cqRing = nullptr;
+                disable();
+                return false;
+            }
+        }
+        sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+        void* sqesMap = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+        if (sqesMap == MAP_FAILED) {
+            disable();
+            return false;
+        }
+
+        char* sq = (char*)sqRing;
+        char* cq = (char*)cqRing;
+        sqHead = (unsigned*)(sq + params.sq_off.head);
+        sqTail = (unsigned*)(sq + params.sq_off.tail);
+        sqMask = (unsigned*)(sq + params.sq_off.ring_mask);
+        sqArray = (unsigned*)(sq + params.sq_off.array);
+        cqHead = (unsigned*)(cq + params.cq_off.head);
+        cqTail = (unsigned*)(cq + params.cq_off.tail);
+        cqMask = (unsigned*)(cq + params.cq_off.ring_mask);
+        cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+        sqes = (struct io_uring_sqe*)sqesMap;
+        sqEntries = params.sq_entries;
+        statxBuf.resize(256 * sqEntries);
+        usable = true;
+        return true;
+    }
+
+    void disable() {
+        usable = false;
+        if (sqes) munmap(sqes, sqesSize);
+        if (cqRing && cqRing != sqRing) munmap(cqRing, cqRingSize);
+        if (sqRing) munmap(sqRing, sqRingSize);
+        if (ringFd >= 0) close(ringFd);
+        sqes = nullptr;
+        sqRing = cqRing = nullptr;
+        ringFd = -1;
+    }
+};
+}
+
+static StatxRing& statx_ring() {
+    static StatxRing* ring = new StatxRing();
+    return *ring;
+}
+#endif
+
+// ========== PathProber ==========
+PathProber::PathProber(const char* const* paths, size_t count) {
+    if (count > MAX_PATHS) count = MAX_PATHS;
+    entries.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const char* path = paths[i];
+        size_t len = strlen(path);
+        // Ignore a trailing '/' when splitting ("/private/var/lib/apt/")
+        size_t end = (len > 1 && path[len - 1] == '/') ? len - 1 : len;
+        size_t slash = end;
+        while (slash > 0 && path[slash - 1] != '/') --slash;
+        std::string parent = slash > 1 ? std::string(path, slash - 1) : std::string("/");
+
+        size_t dir = 0;
+        while (dir < dirs.size() && dirs[dir].path != parent) ++dir;
+        if (dir == dirs.size()) {
+            Directory d;
+            d.path = parent;
+            dirs.push_back(d);
+        }
+
+        Entry e;
+        e.path = path;
+        e.name = path + slash;
+        e.dir = dir;
+        entries.push_back(e);
+    }
+}
+
+PathProber::~PathProber() {
+    for (Directory& d : dirs) {
+        if (d.fd >= 0) close(d.fd);
+    }
+}
+
+void PathProber::refreshDirectories(const std::string& root) {
+    uint32_t generation = current_mount_generation();
+    bool remount = generation != mountGeneration;
+    mountGeneration = generation;
+
+    uint64_t now = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    for (Directory& d : dirs) {
+        bool opened = d.openedNs != 0;
+        if (opened && !remount && (d.fd >= 0 || now - d.openedNs < MISSING_DIR_RETRY_NS)) continue;
+        if (d.fd >= 0) close(d.fd);
+        d.fd = open(root.empty() ? d.path.c_str() : (root + d.path).c_str(), PROBER_DIR_FLAGS);
+        if (d.fd < 0) {
+            d.fd = (errno == ENOENT || errno == ENOTDIR) ? DIR_MISSING : DIR_UNAVAILABLE;
+        }
+        d.openedNs = now;
+    }
+}
+
+#if defined(SECURITY_CORE_BENCH)
+void PathProber::setRoot(const char* prefix) {
+    {
+        std::lock_guard<std::mutex> lock(root_mutex);
+        root_prefix = prefix ? prefix : "";
+    }
+    mount_generation.fetch_add(1, std::memory_order_relaxed);
+}
+#endif
+
+uint64_t PathProber::probe(uint64_t select) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::string root = current_root();
+    refreshDirectories(root);
+
+    int fds[MAX_PATHS];
+    const char* names[MAX_PATHS];
+    size_t indices[MAX_PATHS];
+    size_t batch = 0;
+    uint64_t hits = 0;
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (!(select & (1ULL << i))) continue;
+        const Entry& e = entries[i];
+        int fd = dirs[e.dir].fd;
+        if (fd == DIR_MISSING) continue;
+        if (fd == DIR_UNAVAILABLE) {
+            std::string path = root + e.path;
+            if (faccessat(AT_FDCWD, path.c_str(), F_OK, 0) == 0) hits |= 1ULL << i;
+            continue;
+        }
+        fds[batch] = fd;
+        names[batch] = e.name;
+        indices[batch] = i;
+        batch++;
+    }
+    if (batch == 0) return hits;
+
+    bool exists[MAX_PATHS];
+#if defined(PROBER_HAVE_IO_URING)
+    if (batch >= IO_URING_MIN_BATCH && statx_ring().statxBatch(fds, names, batch, exists)) {
+        for (size_t b = 0; b < batch; ++b) {
+            if (exists[b]) hits |= 1ULL << indices[b];
+        }
+        return hits;
+    }
+#endif
+    for (size_t b = 0; b < batch; ++b) {
+        exists[b] = faccessat(fds[b], names[b], F_OK, 0) == 0;
+        if (exists[b]) hits |= 1ULL << indices[b];
+    }
+    return hits;
+}
@@ -0,0 +1,283 @@
+#include "pattern_matcher.h"
+
+#include <deque>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define MATCHER_SIMD_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MATCHER_SIMD_NEON 1
+#endif
+
+// Automaton states are stored as uint16_t.
+static const size_t MAX_TOTAL_PATTERN_BYTES = 60000;
+static const size_t SCAN_CHUNK_SIZE = 16 * 1024;
+
+int PatternMatcher::addPattern(const char* pattern, size_t len) {
+    if (isCompiled || len == 0 || patterns.size() >= MAX_PATTERNS) return -1;
+    size_t total = len;
+    for (const std::string& p : patterns) total += p.size();
+    if (total > MAX_TOTAL_PATTERN_BYTES) return -1;
+    patterns.push_back(std::string(pattern, len));
+    return (int)patterns.size() - 1;
+}
+
+int PatternMatcher::addPattern(const char* pattern) {
+    return addPattern(pattern, strlen(pattern));
+}
+
+void PatternMatcher::compile(bool lineMode_) {
+    if (isCompiled) return;
+    lineMode = lineMode_;
+
+    // Byte classes
+    memset(byteClass, 0, sizeof(byteClass));
+    classCount = 1;
+    for (const std::string& p : patterns) {
+        for (unsigned char b : p) {
+            if (!byteClass[b]) byteClass[b] = (uint8_t)classCount++;
+        }
+    }
+
+    // Trie
+    std::vector<std::vector<int>> children(1, std::vector<int>(classCount, -1));
+    output.assign(1, 0);
+    for (size_t id = 0; id < patterns.size(); ++id) {
+        int s = 0;
+        for (unsigned char b : patterns[id]) {
+            int c = byteClass[b];
+            if (children[s][c] < 0) {
+                children[s][c] = (int)children.size();
+                children.push_back(std::vector<int>(classCount, -1));
+                output.push_back(0);
+            }
+            s = children[s][c];
+        }
+        output[s] |= 1ULL << id;
+    }
+
+    // Failure links, folded into a full DFA in BFS order
+    stateCount = (uint32_t)children.size();
+    next.assign((size_t)stateCount * classCount, 0);
+    std::vector<int> fail(stateCount, 0);
+    std::deque<int> queue;
+    for (uint32_t c = 0; c < classCount; ++c) {
+        int child = children[0][c];
+        if (child >= 0) {
+            next[c] = (uint16_t)child;
+            queue.push_back(child);
+        }
+    }
+    while (!queue.empty()) {
+        int s = queue.front();
+        queue.pop_front();
+        output[s] |= output[fail[s]];
+        for (uint32_t c = 0; c < classCount; ++c) {
+            int child = children[s][c];
+            if (child >= 0) {
+                fail[child] = next[fail[s] * classCount + c];
+                next[s * classCount + c] = (uint16_t)child;
+                queue.push_back(child);
+            } else {
+                next[s * classCount + c] = next[fail[s] * classCount + c];
+            }
+        }
+    }
+
+    numPatterns = (uint32_t)patterns.size();
+    buildPrefilter(next.data());
+    isCompiled = true;
+}
+
+// Root prefilter: the bytes whose root transition leaves the root state,
+// which are exactly the first bytes of the patterns.
+void PatternMatcher::buildPrefilter(const uint16_t* table) {
+    memset(isStartByte, 0, sizeof(isStartByte));
+    for (int b = 0; b < 256; ++b) isStartByte[b] = table[byteClass[b]] != 0;
+    if (lineMode) isStartByte[(unsigned char)'\n'] = true;
+    startByteCount = 0;
+    for (int b = 0; b < 256; ++b) {
+        if (!isStartByte[b]) continue;
+        if (startByteCount == sizeof(startBytes)) {
+            startByteCount = 0;
+            break;
+        }
+        startBytes[startByteCount++] = (uint8_t)b;
+    }
+    for (uint32_t i = startByteCount; startByteCount && i < sizeof(startBytes); ++i) {
+        startBytes[i] = startBytes[0];
+    }
+}
+
+// ========== Images ==========
+static const size_t IMAGE_HEADER_SIZE = 4 * sizeof(uint32_t) + 256;
+
+static size_t image_next_size(uint32_t stateCount, uint32_t classCount) {
+    return ((size_t)stateCount * classCount * sizeof(uint16_t) + 7) & ~(size_t)7;
+}
+
+size_t PatternMatcher::imageSize() const {
+    if (!isCompiled) return 0;
+    return IMAGE_HEADER_SIZE + image_next_size(stateCount, classCount) + stateCount * sizeof(uint64_t);
+}
+
+void PatternMatcher::writeImage(uint8_t* out) const {
+    if (!isCompiled) return;
+    const uint16_t* table = imageNext ? imageNext : next.data();
+    const uint64_t* hits = imageOutput ? imageOutput : output.data();
+    uint32_t header[4] = {numPatterns, classCount, stateCount, lineMode ? 1u : 0u};
+    memcpy(out, header, sizeof(header));
+    memcpy(out + sizeof(header), byteClass, sizeof(byteClass));
+    out += IMAGE_HEADER_SIZE;
+    size_t nextBytes = (size_t)stateCount * classCount * sizeof(uint16_t);
+    size_t nextSize = image_next_size(stateCount, classCount);
+    memcpy(out, table, nextBytes);
+    memset(out + nextBytes, 0, nextSize - nextBytes);
+    memcpy(out + nextSize, hits, stateCount * sizeof(uint64_t));
+}
+
+bool PatternMatcher::loadImage(const uint8_t* image, size_t len) {
+    if (isCompiled || !patterns.empty()) return false;
+    if (((uintptr_t)image & 7) != 0 || len < IMAGE_HEADER_SIZE) return false;
+    uint32_t header[4];
+    memcpy(header, image, sizeof(header));
+    uint32_t patternCount = header[0], classes = header[1], states = header[2];
+    if (patternCount > MAX_PATTERNS || classes == 0 || classes > 256 || states == 0 || states > 65536 ||
+        header[3] > 1) {
+        return false;
+    }
+    size_t nextSize = image_next_size(states, classes);
+    if (len != IMAGE_HEADER_SIZE + nextSize + states * sizeof(uint64_t)) return false;
+
+    // Everything the scan loop indexes with is bounds-checked here once.
+    const uint8_t* classMap = image + sizeof(header);
+    for (int b = 0; b < 256; ++b) {
+        if (classMap[b] >= classes) return false;
+    }
+    const uint16_t* table = (const uint16_t*)(image + IMAGE_HEADER_SIZE);
+    for (size_t i = 0; i < (size_t)states * classes; ++i) {
+        if (table[i] >= states) return false;
+    }
+    const uint64_t* hits = (const uint64_t*)(image + IMAGE_HEADER_SIZE + nextSize);
+    uint64_t valid = patternCount == 64 ? ~0ULL : (1ULL << patternCount) - 1;
+    for (uint32_t i = 0; i < states; ++i) {
+        if (hits[i] & ~valid) return false;
+    }
+
+    memcpy(byteClass, classMap, sizeof(byteClass));
+    numPatterns = patternCount;
+    classCount = classes;
+    stateCount = states;
+    lineMode = header[3] != 0;
+    imageNext = table;
+    imageOutput = hits;
+    buildPrefilter(table);
+    isCompiled = true;
+    return true;
+}
+
+// Offset of the first byte that can leave the root state, or len.
+size_t PatternMatcher::skipToCandidate(const unsigned char* data, size_t len) const {
+    size_t i = 0;
+#if defined(MATCHER_SIMD_SSE2)
+    if (startByteCount) {
+        const __m128i v0 = _mm_set1_epi8((char)startBytes[0]);
+        const __m128i v1 = _mm_set1_epi8((char)startBytes[1]);
+        const __m128i v2 = _mm_set1_epi8((char)startBytes[2]);
+        const __m128i v3 = _mm_set1_epi8((char)startBytes[3]);
+        for (; i + 16 <= len; i += 16) {
+            __m128i x = _mm_loadu_si128((const __m128i*)(data + i));
+            __m128i eq = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, v0), _mm_cmpeq_epi8(x, v1)),
+                                      _mm_or_si128(_mm_cmpeq_epi8(x, v2), _mm_cmpeq_epi8(x, v3)));
+            int mask = _mm_movemask_epi8(eq);
+            if (mask) return i + __builtin_ctz((unsigned)mask);
+        }
+    }
+#elif defined(MATCHER_SIMD_NEON)
+    if (startByteCount) {
+        const uint8x16_t v0 = vdupq_n_u8(startBytes[0]);
+        const uint8x16_t v1 = vdupq_n_u8(startBytes[1]);
+        const uint8x16_t v2 = vdupq_n_u8(startBytes[2]);
+        const uint8x16_t v3 = vdupq_n_u8(startBytes[3]);
+        for (; i + 16 <= len; i += 16) {
+            uint8x16_t x = vld1q_u8(data + i);
+            uint8x16_t eq = vorrq_u8(vorrq_u8(vceqq_u8(x, v0), vceqq_u8(x, v1)),
+                                     vorrq_u8(vceqq_u8(x, v2), vceqq_u8(x, v3)));
+            // Narrow each byte lane to a nibble to get a 64-bit mask.
+            uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+            uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+            if (mask) return i + (__builtin_ctzll(mask) >> 2);
+        }
+    }
+#endif
+    for (; i < len; ++i) {
+        if (isStartByte[data[i]]) return i;
+    }
+    return len;
+}
+
+void PatternMatcher::feed(Scanner& scanner, const char* data, size_t len,
+                          LineCallback onLine, void* userdata) const {
+    if (!isCompiled) return;
+    const unsigned char* p = (const unsigned char*)data;
+    const unsigned char* end = p + len;
+    uint32_t s = scanner.state;
+    const uint16_t* table = imageNext ? imageNext : next.data();
+    const uint64_t* hits = imageOutput ? imageOutput : output.data();
+
+    while (p < end && !scanner.stopped) {
+        if (s == 0) {
+            p += skipToCandidate(p, (size_t)(end - p));
+            if (p == end) break;
+        }
+        unsigned char b = *p++;
+        if (lineMode && b == '\n') {
+            if (scanner.lineHits && onLine && !onLine(scanner.lineHits, userdata)) {
+                scanner.stopped = true;
+            }
+            scanner.lineHits = 0;
+            s = 0;
+            continue;
+        }
+        s = table[s * classCount + byteClass[b]];
+        uint64_t hit = hits[s];
+        if (hit) {
+            scanner.hits |= hit;
+            scanner.lineHits |= hit;
+        }
+    }
+    scanner.state = s;
+}
+
+void PatternMatcher::finish(Scanner& scanner, LineCallback onLine, void* userdata) const {
+    if (lineMode && !scanner.stopped && scanner.lineHits && onLine) {
+        if (!onLine(scanner.lineHits, userdata)) scanner.stopped = true;
+    }
+    scanner.lineHits = 0;
+    scanner.state = 0;
+}
+
+uint64_t PatternMatcher::scan(const char* data, size_t len) const {
+    Scanner scanner;
+    feed(scanner, data, len);
+    return scanner.hits;
+}
+
+uint64_t PatternMatcher::scanFile(const char* path, LineCallback onLine, void* userdata) const {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+
+    char buf[SCAN_CHUNK_SIZE];
+    Scanner scanner;
+    ssize_t n;
+    while (!scanner.stopped && (n = read(fd, buf, sizeof(buf))) > 0) {
+        feed(scanner, buf, (size_t)n, onLine, userdata);
+    }
+    finish(scanner, onLine, userdata);
+    close(fd);
+    return scanner.hits;
+}
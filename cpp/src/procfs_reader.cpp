@@ -0,0 +1,291 @@
+#include "procfs_reader.h"
+
+#if defined(__linux__)
+#include <algorithm>
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <mutex>
+#include <pthread.h>
+#include <string>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+static const size_t ARENA_SIZE = 16 * 1024;
+static const size_t MAX_CACHED_THREADS = 256;
+
+static const char* const procfs_names[PROCFS_FILE_COUNT] = {
+    "maps",
+    "status",
+    "mounts",
+    "cmdline",
+    "statm",
+};
+
+// Only SecurityCoreBench can change it (procfs_set_root); guarded by
+// task_state->mutex.
+static std::string procfs_root = "/proc/self";
+
+// ========== Descriptors ==========
+namespace {
+struct CommFd {
+    pid_t tid;
+    int fd;
+    uint32_t seenPass;
+};
+
+struct TaskState {
+    std::mutex mutex;
+    int taskFd = -1;
+    uint32_t pass = 0;
+    std::vector<CommFd> commFds;  // sorted by tid
+};
+}
+
+static std::atomic<int> file_fds[PROCFS_FILE_COUNT];
+static TaskState* task_state;
+static std::once_flag init_once;
+
+// Caller holds task_state->mutex.
+static void close_all_fds() {
+    for (std::atomic<int>& slot : file_fds) {
+        int fd = slot.exchange(-1);
+        if (fd >= 0) close(fd);
+    }
+    if (task_state->taskFd >= 0) close(task_state->taskFd);
+    task_state->taskFd = -1;
+    for (const CommFd& c : task_state->commFds) close(c.fd);
+    task_state->commFds.clear();
+}
+
+// /proc/self in an inherited descriptor still names the parent, so the
+// child drops everything and reopens lazily.
+static void atfork_prepare() { task_state->mutex.lock(); }
+static void atfork_parent() { task_state->mutex.unlock(); }
+static void atfork_child() {
+    close_all_fds();
+    task_state->mutex.unlock();
+}
+
+static void init_procfs() {
+    for (std::atomic<int>& slot : file_fds) slot.store(-1);
+    // Intentionally leaked: detectors on pool workers may still read procfs
+    // during static destruction.
+    task_state = new TaskState();
+    task_state->commFds.reserve(MAX_CACHED_THREADS);
+    pthread_atfork(atfork_prepare, atfork_parent, atfork_child);
+}
+
+static int file_fd(ProcfsFile file) {
+    std::call_once(init_once, init_procfs);
+    int fd = file_fds[file].load(std::memory_order_acquire);
+    if (fd >= 0) return fd;
+    // First open only: the root and the slot are settled under the lock.
+    std::lock_guard<std::mutex> lock(task_state->mutex);
+    fd = file_fds[file].load(std::memory_order_acquire);
+    if (fd >= 0) return fd;
+    std::string path = procfs_root + "/" + procfs_names[file];
+    fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) file_fds[file].store(fd, std::memory_order_release);
+    return fd;
+}
+
+static std::vector<char>& arena() {
+    static thread_local std::vector<char> buf;
+    if (buf.empty()) buf.resize(ARENA_SIZE);
+    return buf;
+}
+
+static ssize_t pread_retry(int fd, char* buf, size_t len, off_t offset) {
+    ssize_t n;
+    do {
+        n = pread(fd, buf, len, offset);
+    } while (n < 0 && errno == EINTR);
+    return n;
+}
+
+// ========== File Reads ==========
+const char* procfs_read(ProcfsFile file, size_t* len) {
+    if (file >= PROCFS_FILE_COUNT) return nullptr;
+    int fd = file_fd(file);
+    if (fd < 0) return nullptr;
+
+    std::vector<char>& buf = arena();
+    size_t used = 0;
+    for (;;) {
+        if (buf.size() - used < ARENA_SIZE / 4) buf.resize(buf.size() * 2);
+        ssize_t n = pread_retry(fd, buf.data() + used, buf.size() - used - 1, (off_t)used);
+        if (n < 0) return nullptr;
+        if (n == 0) break;
+        used += (size_t)n;
+    }
+    buf[used] = '\0';
+    if (len) *len = used;
+    return buf.data();
+}
+
+uint64_t procfs_scan(ProcfsFile file, const PatternMatcher& matcher,
+                     PatternMatcher::LineCallback onLine, void* userdata) {
+    if (file >= PROCFS_FILE_COUNT) return 0;
+    int fd = file_fd(file);
+    if (fd < 0) return 0;
+
+    std::vector<char>& buf = arena();
+    PatternMatcher::Scanner scanner;
+    off_t offset = 0;
+    ssize_t n;
+    while (!scanner.stopped && (n = pread_retry(fd, buf.data(), buf.size(), offset)) > 0) {
+        matcher.feed(scanner, buf.data(), (size_t)n, onLine, userdata);
+        offset += n;
+    }
+    matcher.finish(scanner, onLine, userdata);
+    return scanner.hits;
+}
+
+// ========== Threads ==========
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+static bool parse_tid(const char* name, pid_t* tid) {
+    pid_t value = 0;
+    if (!*name) return false;
+    for (; *name; ++name) {
+        if (*name < '0' || *name > '9') return false;
+        value = value * 10 + (*name - '0');
+    }
+    *tid = value;
+    return true;
+}
+
+static int open_comm(int taskFd, pid_t tid) {
+    char path[32];
+    snprintf(path, sizeof(path), "%d/comm", (int)tid);
+    return openat(taskFd, path, O_RDONLY | O_CLOEXEC);
+}
+
+// Reads the comm of `tid` through a cached fd. Returns the length without
+// the trailing '\n', or -1 if the thread is gone.
+static ssize_t read_comm(TaskState& st, pid_t tid, char* name, size_t size) {
+    std::vector<CommFd>& fds = st.commFds;
+    std::vector<CommFd>::iterator it = std::lower_bound(
+        fds.begin(), fds.end(), tid, [](const CommFd& c, pid_t t) { return c.tid < t; });
+    bool cached = it != fds.end() && it->tid == tid;
+    ssize_t n = -1;
+
+    if (cached) {
+        n = pread_retry(it->fd, name, size, 0);
+        if (n < 0) {
+            // Thread exited; a new thread may have reused the tid.
+            close(it->fd);
+            it = fds.erase(it);
+            cached = false;
+        } else {
+            it->seenPass = st.pass;
+        }
+    }
+    if (!cached) {
+        int fd = open_comm(st.taskFd, tid);
+        if (fd < 0) return -1;
+        n = pread_retry(fd, name, size, 0);
+        if (n >= 0 && fds.size() < MAX_CACHED_THREADS) {
+            CommFd entry = {tid, fd, st.pass};
+            fds.insert(it, entry);
+        } else {
+            close(fd);
+        }
+    }
+    if (n > 0 && name[n - 1] == '\n') --n;
+    return n;
+}
+
+static bool ensure_task_fd(TaskState& st) {
+    if (st.taskFd < 0) st.taskFd = open((procfs_root + "/task").c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    return st.taskFd >= 0;
+}
+
+bool procfs_for_each_thread_name(ProcfsThreadNameCallback fn, void* userdata) {
+    std::call_once(init_once, init_procfs);
+    TaskState& st = *task_state;
+    std::lock_guard<std::mutex> lock(st.mutex);
+    if (!ensure_task_fd(st) || lseek(st.taskFd, 0, SEEK_SET) < 0) return false;
+
+    st.pass++;
+    char dents[4096] __attribute__((aligned(8)));
+    char name[64];
+    bool stopped = false;
+    long n;
+    while (!stopped && (n = syscall(SYS_getdents64, st.taskFd, dents, sizeof(dents))) > 0) {
+        for (long off = 0; off < n && !stopped;) {
+            const linux_dirent64* d = (const linux_dirent64*)(dents + off);
+            off += d->d_reclen;
+            pid_t tid;
+            if (!parse_tid(d->d_name, &tid)) continue;
+            ssize_t len = read_comm(st, tid, name, sizeof(name));
+            if (len >= 0 && !fn(name, (size_t)len, userdata)) stopped = true;
+        }
+    }
+
+    // Drop fds of threads that were not listed (only known after a full pass).
+    if (!stopped) {
+        std::vector<CommFd>& fds = st.commFds;
+        size_t kept = 0;
+        for (size_t i = 0; i < fds.size(); ++i) {
+            if (fds[i].seenPass == st.pass) {
+                fds[kept++] = fds[i];
+            } else {
+                close(fds[i].fd);
+            }
+        }
+        fds.resize(kept);
+    }
+    return true;
+}
+
+uint64_t procfs_task_link_count() {
+    std::call_once(init_once, init_procfs);
+    TaskState& st = *task_state;
+    std::lock_guard<std::mutex> lock(st.mutex);
+    struct stat s;
+    if (!ensure_task_fd(st) || fstat(st.taskFd, &s) != 0) return 0;
+    return (uint64_t)s.st_nlink;
+}
+
+#if defined(SECURITY_CORE_BENCH)
+void procfs_set_root(const char* dir) {
+    std::call_once(init_once, init_procfs);
+    std::lock_guard<std::mutex> lock(task_state->mutex);
+    close_all_fds();
+    procfs_root = dir ? dir : "/proc/self";
+}
+#endif
+
+#else
+// No procfs on Apple platforms.
+const char* procfs_read(ProcfsFile, size_t*) {
+    return nullptr;
+}
+
+uint64_t procfs_scan(ProcfsFile, const PatternMatcher&, PatternMatcher::LineCallback, void*) {
+    return 0;
+}
+
+bool procfs_for_each_thread_name(ProcfsThreadNameCallback, void*) {
+    return false;
+}
+
+uint64_t procfs_task_link_count() {
+    return 0;
+}
+
+#if defined(SECURITY_CORE_BENCH)
+void procfs_set_root(const char*) {}
+#endif
+#endif
@@ -1,53 +1,83 @@
-bool android_check_root() {
-    // 1. Check for root binaries
-    const char* paths[] = {
-        "/system/xbin/su", "/system/bin/su", "/sbin/su", "/system/app/Superuser.apk",
-        "/system/bin/.ext/.su", "/system/usr/we-need-root/su.backup", "/system/xbin/mu", nullptr
-    };
-    for (int i = 0; paths[i]; ++i) {
-        if (access(paths[i], F_OK) == 0) return true;
+#include "root_checker.h"
+#include "SecurityCore.h"
+#include "obfuscated_string.h"
+#include "pattern_matcher.h"
+#include "procfs_reader.h"
+#include "sig_db.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__ANDROID__)
+#include <sys/system_properties.h>
+#endif
+
+// ========== Indicator Paths ==========
+bool probe_indicator_paths(unsigned int groups) {
+    return sig_db_active()->probePaths(groups) != 0;
+}
+
+// ========== RW System Mount ==========
+enum {
+    MOUNT_SYSTEM = 1 << 0,
+    MOUNT_RW = 1 << 1,
+};
+
+static PatternMatcher build_mounts_matcher() {
+    PatternMatcher matcher;
+    matcher.addPattern(OBF("/system").c_str());
+    matcher.addPattern("rw");
+    matcher.compile(true);
+    return matcher;
+}
+
+static bool on_mount_line(uint64_t line_hits, void* userdata) {
+    if ((line_hits & (MOUNT_SYSTEM | MOUNT_RW)) == (MOUNT_SYSTEM | MOUNT_RW)) {
+        *(bool*)userdata = true;
+        return false;
     }
+    return true;
+}
+
+bool detect_rw_system_mount() {
+    static const PatternMatcher matcher = build_mounts_matcher();
+    bool found = false;
+    procfs_scan(PROCFS_MOUNTS, matcher, on_mount_line, &found);
+    return found;
+}
+
+#if defined(__ANDROID__) && !defined(__APPLE__)
+bool android_check_root() {
+    // 1. Check for root binaries and dangerous files in one batch
+    if (probe_indicator_paths(INDICATOR_ROOT_BINARIES | INDICATOR_FRIDA_SERVER)) return true;
     // 2. Check for dangerous props
     char value[PROP_VALUE_MAX];
-    if (__system_property_get("ro.debuggable", value) && strcmp(value, "1") == 0) return true;
-    if (__system_property_get("ro.secure", value) && strcmp(value, "0") == 0) return true;
+    if (__system_property_get(OBF("ro.debuggable").c_str(), value) && strcmp(value, "1") == 0) return true;
+    if (__system_property_get(OBF("ro.secure").c_str(), value) && strcmp(value, "0") == 0) return true;
     // 3. Check for RW system
-    FILE* f = fopen("/proc/mounts", "r");
-    if (f) {
-        char line[512];
-        while (fgets(line, sizeof(line), f)) {
-            if (strstr(line, "/system") && strstr(line, "rw")) {
-                fclose(f);
-                return true;
-            }
-        }
-        fclose(f);
-    }
-    // 4. Check for root packages
-    const char* pkgs[] = { "com.noshufou.android.su", "eu.chainfire.supersu", "com.koushikdutta.superuser", "com.zachspong.temprootremovejb", "com.ramdroid.appquarantine", nullptr };
-    // (Optional: check via JNI/Java)
+    if (detect_rw_system_mount()) return true;
+    // 4. Root packages (SIG_PACKAGES) need PackageManager; see
+    //    security_core_is_root_package()
     // 5. Check for Frida/Xposed
     if (detect_frida_thread() || detect_memory_maps()) return true;
-    // 6. Check for dangerous files
-    if (access("/data/local/tmp/frida-server", F_OK) == 0) return true;
-    // 7. Anti-debug
+    // 6. Anti-debug
     if (detect_debugger()) return true;
     return false;
 }
+#endif
 
+#if defined(__APPLE__) && !defined(__ANDROID__)
 bool apple_check_root() {
     // 1. Check for jailbreak files
-    const char* paths[] = {
-        "/Applications/Cydia.app", "/Library/MobileSubstrate/MobileSubstrate.dylib", "/bin/bash", "/usr/sbin/sshd", "/etc/apt", "/private/var/lib/apt/", nullptr
-    };
-    for (int i = 0; paths[i]; ++i) {
-        if (access(paths[i], F_OK) == 0) return true;
-    }
+    if (probe_indicator_paths(INDICATOR_JAILBREAK)) return true;
     // 2. Check for sandbox escape
-    FILE* f = fopen("/private/jailbreak.txt", "w");
+    auto probe_file = OBF("/private/jailbreak.txt");
+    FILE* f = fopen(probe_file.c_str(), "w");
     if (f) {
         fclose(f);
-        remove("/private/jailbreak.txt");
+        remove(probe_file.c_str());
         return true;
     }
     // 3. Check for suspicious dylibs
@@ -58,6 +88,7 @@ bool apple_check_root() {
     if (detect_debugger()) return true;
     return false;
 }
+#endif
 
 bool check_root() {
     #if defined(__ANDROID__) && !defined(__APPLE__)
@@ -67,4 +98,4 @@ bool check_root() {
     #else
     return false;
     #endif
-}
\ No newline at end of file
+}
@@ -0,0 +1,435 @@
+#include "sig_db.h"
+#include "crc32_engine.h"
+#include "obfuscated_string.h"
+#include "root_checker.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__ANDROID__)
+#include <android/log.h>
+#endif
+
+// CRC32 covers the image after the crc32 field.
+static const size_t CRC_START = offsetof(SigDbHeader, crc32) + sizeof(uint32_t);
+
+static const uint32_t MPH_MAX_SEEDS = 64;
+static const uint32_t MPH_MAX_DISPLACEMENT = 1u << 16;
+
+SigSetKind sig_set_kind(SigSetId id) {
+    switch (id) {
+        case SIG_THREAD_NAMES:
+        case SIG_MAPS:
+        case SIG_IMAGE_NAMES:
+            return SIG_KIND_PATTERNS;
+        case SIG_ENV_VARS:
+        case SIG_PACKAGES:
+            return SIG_KIND_EXACT;
+        default:
+            return SIG_KIND_LIST;
+    }
+}
+
+static uint32_t image_crc(const uint8_t* image, size_t size) {
+    return crc32_engine_update(0xFFFFFFFFu, image + CRC_START, size - CRC_START) ^ 0xFFFFFFFFu;
+}
+
+// ========== Perfect Hash ==========
+// Hash and displace: a key's bucket is picked by its hash, and each bucket
+// stores the displacement that sends all of its keys to free slots. A
+// lookup is one hash, one displacement read and one string compare.
+static uint64_t mix64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB3FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static uint64_t key_hash(const char* str, size_t len, uint32_t seed) {
+    uint64_t h = 0xCBF29CE484222325ULL ^ mix64(seed);
+    for (size_t i = 0; i < len; ++i) {
+        h ^= (unsigned char)str[i];
+        h *= 0x100000001B3ULL;
+    }
+    return mix64(h);
+}
+
+static uint32_t key_bucket(uint64_t hash, uint32_t bucketCount) {
+    return (uint32_t)((hash >> 32) % bucketCount);
+}
+
+static uint32_t key_slot(uint64_t hash, uint32_t displacement, uint32_t count) {
+    return (uint32_t)(mix64(hash + (displacement + 1ULL) * 0x9E3779B97F4A7C15ULL) % count);
+}
+
+// Slot order for `keys`, or false if this seed does not work.
+static bool mph_place(const std::vector<uint64_t>& hashes, uint32_t bucketCount,
+                      std::vector<uint32_t>& displacements, std::vector<uint32_t>& slotOf) {
+    uint32_t count = (uint32_t)hashes.size();
+    std::vector<std::vector<uint32_t>> buckets(bucketCount);
+    for (uint32_t i = 0; i < count; ++i) buckets[key_bucket(hashes[i], bucketCount)].push_back(i);
+    std::vector<uint32_t> order(bucketCount);
+    for (uint32_t b = 0; b < bucketCount; ++b) order[b] = b;
+    std::stable_sort(order.begin(), order.end(),
+                     [&](uint32_t a, uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+
+    std::vector<char> taken(count, 0);
+    std::vector<uint32_t> slots;
+    displacements.assign(bucketCount, 0);
+    slotOf.assign(count, 0);
+    for (uint32_t b : order) {
+        const std::vector<uint32_t>& keys = buckets[b];
+        if (keys.empty()) break;
+        uint32_t d = 0;
+        for (; d < MPH_MAX_DISPLACEMENT; ++d) {
+            slots.clear();
+            for (uint32_t k : keys) {
+                uint32_t s = key_slot(hashes[k], d, count);
+                if (taken[s] || std::find(slots.begin(), slots.end(), s) != slots.end()) break;
+                slots.push_back(s);
+            }
+            if (slots.size() == keys.size()) break;
+        }
+        if (d == MPH_MAX_DISPLACEMENT) return false;
+        displacements[b] = d;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            taken[slots[i]] = 1;
+            slotOf[keys[i]] = slots[i];
+        }
+    }
+    return true;
+}
+
+// ========== SigDb ==========
+std::shared_ptr<const SigDb> SigDb::open(const char* path) {
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    void* map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size >= (off_t)sizeof(SigDbHeader) &&
+        st.st_size <= (off_t)SIG_DB_MAX_SIZE) {
+        map = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) return nullptr;
+
+    std::shared_ptr<SigDb> db(new SigDb());
+    db->map = map;
+    db->base = (const uint8_t*)map;
+    db->size = (size_t)st.st_size;
+    if (!db->validate()) return nullptr;
+    return db;
+}
+
+std::shared_ptr<const SigDb> SigDb::fromImage(std::vector<uint64_t>&& image) {
+    std::shared_ptr<SigDb> db(new SigDb());
+    db->heap = std::move(image);
+    db->base = (const uint8_t*)db->heap.data();
+    db->size = db->heap.size() * sizeof(uint64_t);
+    if (db->size < sizeof(SigDbHeader)) return nullptr;
+    if (!db->validate()) return nullptr;
+    return db;
+}
+
+SigDb::~SigDb() {
+    // The prober points into the image.
+    prober.reset();
+    if (map) munmap(map, size);
+}
+
+bool SigDb::validate() {
+    header = (const SigDbHeader*)base;
+    if (memcmp(header->magic, SIG_DB_MAGIC, sizeof(header->magic)) != 0) return false;
+    if (header->formatVersion != SIG_DB_FORMAT_VERSION || header->size != size) return false;
+    if (image_crc(base, size) != header->crc32) return false;
+
+    for (int id = 0; id < SIG_SET_COUNT; ++id) {
+        const SigDbSection& section = header->sections[id];
+        if (section.offset < sizeof(SigDbHeader) || (section.offset & 7) != 0 || section.offset > size ||
+            section.size > size - section.offset) {
+            return false;
+        }
+        const uint8_t* data = base + section.offset;
+        if (sig_set_kind((SigSetId)id) == SIG_KIND_PATTERNS) {
+            if (!matchers[id].loadImage(data, section.size)) return false;
+        } else if (!loadStrings((SigSetId)id, data, section.size)) {
+            return false;
+        }
+    }
+
+    const StringSet& pathSet = sets[SIG_PATHS];
+    if (pathSet.count > PathProber::MAX_PATHS) return false;
+    for (uint32_t i = 0; i < pathSet.count; ++i) {
+        const char* path = string(SIG_PATHS, i);
+        if (path[0] != '/') return false;
+        paths.push_back(path);
+    }
+    prober.reset(new PathProber(paths.data(), paths.size()));
+    return true;
+}
+
+bool SigDb::loadStrings(SigSetId id, const uint8_t* data, size_t len) {
+    SigStringSet head;
+    if (len < sizeof(head)) return false;
+    memcpy(&head, data, sizeof(head));
+    bool exact = sig_set_kind(id) == SIG_KIND_EXACT;
+    if (exact ? (head.count > 0 && head.bucketCount == 0) : head.bucketCount != 0) return false;
+    uint64_t need = sizeof(head) + (uint64_t)head.count * sizeof(SigString) +
+                    (uint64_t)head.bucketCount * sizeof(uint32_t) + head.poolSize;
+    if (need != len) return false;
+
+    StringSet& set = sets[id];
+    set.entries = (const SigString*)(data + sizeof(head));
+    set.displacements = (const uint32_t*)(set.entries + head.count);
+    set.pool = (const char*)(set.displacements + head.bucketCount);
+    set.count = head.count;
+    set.seed = head.seed;
+    set.bucketCount = head.bucketCount;
+
+    for (uint32_t i = 0; i < head.count; ++i) {
+        const SigString& e = set.entries[i];
+        if (e.length == 0 || e.offset >= head.poolSize || e.length >= head.poolSize - e.offset) return false;
+        const char* str = set.pool + e.offset;
+        if (str[e.length] != '\0' || memchr(str, '\0', e.length) != nullptr) return false;
+        // Every key must sit in the slot its hash leads to.
+        if (exact) {
+            uint64_t h = key_hash(str, e.length, set.seed);
+            if (key_slot(h, set.displacements[key_bucket(h, set.bucketCount)], set.count) != i) return false;
+        }
+    }
+    return true;
+}
+
+bool SigDb::contains(SigSetId id, const char* str, size_t len) const {
+    const StringSet& set = sets[id];
+    if (set.count == 0 || set.bucketCount == 0) return false;
+    uint64_t h = key_hash(str, len, set.seed);
+    const SigString& e = set.entries[key_slot(h, set.displacements[key_bucket(h, set.bucketCount)], set.count)];
+    return e.length == len && memcmp(set.pool + e.offset, str, len) == 0;
+}
+
+const char* SigDb::string(SigSetId id, size_t index) const {
+    const StringSet& set = sets[id];
+    return index < set.count ? set.pool + set.entries[index].offset : nullptr;
+}
+
+unsigned int SigDb::tag(SigSetId id, size_t index) const {
+    const StringSet& set = sets[id];
+    return index < set.count ? set.entries[index].tag : 0;
+}
+
+uint64_t SigDb::probePaths(unsigned int groups) const {
+    const StringSet& set = sets[SIG_PATHS];
+    uint64_t select = 0;
+    for (uint32_t i = 0; i < set.count; ++i) {
+        if (set.entries[i].tag & groups) select |= 1ULL << i;
+    }
+    return select ? prober->probe(select) : 0;
+}
+
+// ========== SigDbBuilder ==========
+bool SigDbBuilder::add(SigSetId id, const std::string& value, unsigned int tag) {
+    if ((unsigned)id >= SIG_SET_COUNT || value.empty() || value.size() > SIG_DB_MAX_STRING || tag > 0xFFFF) {
+        return false;
+    }
+    if (value.find('\0') != std::string::npos) return false;
+    std::vector<std::pair<std::string, unsigned int>>& set = entries[id];
+    switch (sig_set_kind(id)) {
+        case SIG_KIND_PATTERNS:
+            if (set.size() >= PatternMatcher::MAX_PATTERNS) return false;
+            break;
+        case SIG_KIND_EXACT:
+            for (const auto& e : set) {
+                if (e.first == value) return false;
+            }
+            break;
+        case SIG_KIND_LIST:
+            if (id == SIG_PATHS && (set.size() >= PathProber::MAX_PATHS || value[0] != '/')) return false;
+            break;
+    }
+    set.push_back(std::make_pair(value, tag));
+    return true;
+}
+
+static void append_aligned(std::vector<uint8_t>& out, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    out.insert(out.end(), p, p + len);
+    out.resize((out.size() + 7) & ~(size_t)7, 0);
+}
+
+static bool build_strings(const std::vector<std::pair<std::string, unsigned int>>& entries, bool exact,
+                          std::vector<uint8_t>& out) {
+    SigStringSet head = {};
+    head.count = (uint32_t)entries.size();
+    std::vector<uint32_t> displacements;
+    std::vector<uint32_t> slotOf(entries.size());
+    for (uint32_t i = 0; i < head.count; ++i) slotOf[i] = i;
+
+    if (exact && head.count > 0) {
+        head.bucketCount = head.count / 2 + 1;
+        std::vector<uint64_t> hashes(head.count);
+        bool placed = false;
+        for (uint32_t seed = 0; !placed && seed < MPH_MAX_SEEDS; ++seed) {
+            for (uint32_t i = 0; i < head.count; ++i) {
+                hashes[i] = key_hash(entries[i].first.data(), entries[i].first.size(), seed);
+            }
+            head.seed = seed;
+            placed = mph_place(hashes, head.bucketCount, displacements, slotOf);
+        }
+        if (!placed) return false;
+    }
+
+    std::vector<SigString> table(head.count);
+    std::string pool;
+    for (uint32_t i = 0; i < head.count; ++i) {
+        SigString& e = table[slotOf[i]];
+        e.offset = (uint32_t)pool.size();
+        e.length = (uint16_t)entries[i].first.size();
+        e.tag = (uint16_t)entries[i].second;
+        pool.append(entries[i].first);
+        pool.push_back('\0');
+    }
+    head.poolSize = (uint32_t)pool.size();
+
+    out.insert(out.end(), (const uint8_t*)&head, (const uint8_t*)(&head + 1));
+    out.insert(out.end(), (const uint8_t*)table.data(), (const uint8_t*)(table.data() + table.size()));
+    out.insert(out.end(), (const uint8_t*)displacements.data(),
+               (const uint8_t*)(displacements.data() + displacements.size()));
+    out.insert(out.end(), pool.begin(), pool.end());
+    return true;
+}
+
+bool SigDbBuilder::build(std::vector<uint64_t>& image) const {
+    std::vector<uint8_t> out(sizeof(SigDbHeader), 0);
+    SigDbHeader header = {};
+    memcpy(header.magic, SIG_DB_MAGIC, sizeof(header.magic));
+    header.formatVersion = SIG_DB_FORMAT_VERSION;
+    header.revision = rev;
+
+    for (int id = 0; id < SIG_SET_COUNT; ++id) {
+        SigSetKind kind = sig_set_kind((SigSetId)id);
+        std::vector<uint8_t> section;
+        if (kind == SIG_KIND_PATTERNS) {
+            PatternMatcher matcher;
+            for (const auto& e : entries[id]) {
+                if (matcher.addPattern(e.first.data(), e.first.size()) < 0) return false;
+            }
+            matcher.compile();
+            section.resize(matcher.imageSize());
+            matcher.writeImage(section.data());
+        } else if (!build_strings(entries[id], kind == SIG_KIND_EXACT, section)) {
+            return false;
+        }
+        // Padding after a section is not part of it.
+        header.sections[id].offset = (uint32_t)out.size();
+        header.sections[id].size = (uint32_t)section.size();
+        append_aligned(out, section.data(), section.size());
+    }
+    if (out.size() > SIG_DB_MAX_SIZE) return false;
+
+    header.size = (uint32_t)out.size();
+    memcpy(out.data(), &header, sizeof(header));
+    header.crc32 = image_crc(out.data(), out.size());
+    memcpy(out.data(), &header, sizeof(header));
+
+    image.assign(out.size() / sizeof(uint64_t), 0);
+    memcpy(image.data(), out.data(), out.size());
+    return true;
+}
+
+// ========== Active Set ==========
+// The built-in set must always exist, so a broken one stops the library at
+// startup instead of leaving the detectors without signatures.
+static void builtin_failed(const char* what, int set) {
+#if defined(__ANDROID__)
+    __android_log_print(ANDROID_LOG_FATAL, "SecurityCore", "built-in signatures: %s (set %d)", what, set);
+#else
+    fprintf(stderr, "SecurityCore: built-in signatures: %s (set %d)\n", what, set);
+#endif
+    abort();
+}
+
+static void builtin_add(SigDbBuilder& b, SigSetId id, const std::string& value, unsigned int tag = 0) {
+    if (!b.add(id, value, tag)) builtin_failed("entry rejected", id);
+}
+
+// The built-in set; SecurityCoreSigGen --check-builtin (run by ctest) fails
+// when it drifts from signatures/signatures.txt.
+static std::shared_ptr<const SigDb> build_builtin() {
+    SigDbBuilder b;
+    builtin_add(b, SIG_THREAD_NAMES, OBF("gum-js-loop").c_str());
+    builtin_add(b, SIG_MAPS, OBF("frida").c_str());
+    builtin_add(b, SIG_IMAGE_NAMES, OBF("frida").c_str());
+    builtin_add(b, SIG_IMAGE_NAMES, OBF("gum").c_str());
+    builtin_add(b, SIG_IMAGE_NAMES, OBF("gjs").c_str());
+
+    builtin_add(b, SIG_ENV_VARS, OBF("FRIDA_DNS_SERVER").c_str());
+    builtin_add(b, SIG_ENV_VARS, OBF("FRIDA_EXTRA_ARGS").c_str());
+    builtin_add(b, SIG_ENV_VARS, OBF("FRIDA_LOADER").c_str());
+
+    builtin_add(b, SIG_PACKAGES, OBF("com.noshufou.android.su").c_str());
+    builtin_add(b, SIG_PACKAGES, OBF("eu.chainfire.supersu").c_str());
+    builtin_add(b, SIG_PACKAGES, OBF("com.koushikdutta.superuser").c_str());
+    builtin_add(b, SIG_PACKAGES, OBF("com.zachspong.temprootremovejb").c_str());
+    builtin_add(b, SIG_PACKAGES, OBF("com.ramdroid.appquarantine").c_str());
+
+    builtin_add(b, SIG_SYMBOLS, OBF("frida_agent_main").c_str());
+    builtin_add(b, SIG_SYMBOLS, OBF("gum_init").c_str());
+    builtin_add(b, SIG_SYMBOLS, OBF("gjs_context_eval").c_str());
+
+    builtin_add(b, SIG_PATHS, OBF("/system/xbin/su").c_str(), INDICATOR_ROOT_BINARIES);
+    builtin_add(b, SIG_PATHS, OBF("/system/bin/su").c_str(), INDICATOR_ROOT_BINARIES);
+    builtin_add(b, SIG_PATHS, OBF("/sbin/su").c_str(), INDICATOR_ROOT_BINARIES);
+    builtin_add(b, SIG_PATHS, OBF("/system/app/Superuser.apk").c_str(), INDICATOR_ROOT_BINARIES);
+    builtin_add(b, SIG_PATHS, OBF("/system/bin/.ext/.su").c_str(), INDICATOR_ROOT_BINARIES);
+    builtin_add(b, SIG_PATHS, OBF("/system/usr/we-need-root/su.backup").c_str(), INDICATOR_ROOT_BINARIES);
+    builtin_add(b, SIG_PATHS, OBF("/system/xbin/mu").c_str(), INDICATOR_ROOT_BINARIES);
+    builtin_add(b, SIG_PATHS, OBF("/data/local/tmp/frida-server").c_str(), INDICATOR_FRIDA_SERVER);
+    builtin_add(b, SIG_PATHS, OBF("/Applications/Cydia.app").c_str(), INDICATOR_JAILBREAK_BASIC);
+    builtin_add(b, SIG_PATHS, OBF("/Library/MobileSubstrate/MobileSubstrate.dylib").c_str(), INDICATOR_JAILBREAK_BASIC);
+    builtin_add(b, SIG_PATHS, OBF("/bin/bash").c_str(), INDICATOR_JAILBREAK_BASIC);
+    builtin_add(b, SIG_PATHS, OBF("/usr/sbin/sshd").c_str(), INDICATOR_JAILBREAK_BASIC);
+    builtin_add(b, SIG_PATHS, OBF("/etc/apt").c_str(), INDICATOR_JAILBREAK_BASIC);
+    builtin_add(b, SIG_PATHS, OBF("/private/var/lib/apt/").c_str(), INDICATOR_JAILBREAK_APT);
+    builtin_add(b, SIG_PATHS, OBF("/usr/lib/frida").c_str(), INDICATOR_FRIDA_FILES);
+    builtin_add(b, SIG_PATHS, OBF("/usr/lib/frida-gadget.dylib").c_str(), INDICATOR_FRIDA_FILES);
+    builtin_add(b, SIG_PATHS, OBF("/usr/lib/frida-agent.dylib").c_str(), INDICATOR_FRIDA_FILES);
+    builtin_add(b, SIG_PATHS, OBF("/var/root/frida").c_str(), INDICATOR_FRIDA_FILES);
+    builtin_add(b, SIG_PATHS, OBF("/data/local/tmp/fd-server").c_str(), INDICATOR_FRIDA_FILES);
+
+    std::vector<uint64_t> image;
+    if (!b.build(image)) builtin_failed("image not built", -1);
+    std::shared_ptr<const SigDb> db = SigDb::fromImage(std::move(image));
+    if (!db) builtin_failed("image rejected", -1);
+    return db;
+}
+
+static std::shared_ptr<const SigDb>& active_slot() {
+    // Intentionally leaked: detectors on pool workers may still read it
+    // during static destruction.
+    static std::shared_ptr<const SigDb>* slot = new std::shared_ptr<const SigDb>(build_builtin());
+    return *slot;
+}
+
+std::shared_ptr<const SigDb> sig_db_active() {
+    return std::atomic_load(&active_slot());
+}
+
+bool sig_db_load(const char* path) {
+    static std::mutex* loadMutex = new std::mutex();
+    std::shared_ptr<const SigDb> db = SigDb::open(path);
+    if (!db) return false;
+    std::lock_guard<std::mutex> lock(*loadMutex);
+    if (db->revision() < sig_db_active()->revision()) return false;
+    std::atomic_store(&active_slot(), db);
+    return true;
+}
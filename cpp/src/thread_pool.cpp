@@ -0,0 +1,110 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+static thread_local bool on_worker_thread = false;
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    if (threadCount == 0) threadCount = 1;
+    workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    for (std::thread& t : workers) {
+        if (t.joinable()) t.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    cv.notify_one();
+}
+
+void ThreadPool::workerLoop() {
+    on_worker_thread = true;
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) return;
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+namespace {
+struct ParallelForState {
+    std::atomic<size_t> next{0};
+    size_t count = 0;
+    size_t done = 0;
+    const std::function<void(size_t)>* fn = nullptr;
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    // Returns once no indices are left to claim.
+    void drain() {
+        size_t finished = 0;
+        for (;;) {
+            size_t i = next.fetch_add(1, std::memory_order_relaxed);
+            if (i >= count) break;
+            (*fn)(i);
+            ++finished;
+        }
+        if (finished == 0) return;
+        std::lock_guard<std::mutex> lock(mutex);
+        done += finished;
+        if (done == count) cv.notify_all();
+    }
+};
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& fn) {
+    if (count == 0) return;
+    if (count == 1) {
+        fn(0);
+        return;
+    }
+
+    // Helpers may start after the caller has already finished every index,
+    // so the state is shared rather than living on this stack frame.
+    std::shared_ptr<ParallelForState> state = std::make_shared<ParallelForState>();
+    state->count = count;
+    state->fn = &fn;
+
+    size_t helpers = std::min(count - 1, workers.size());
+    for (size_t i = 0; i < helpers; ++i) {
+        submit([state] { state->drain(); });
+    }
+    state->drain();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cv.wait(lock, [&state] { return state->done == state->count; });
+}
+
+bool ThreadPool::isWorkerThread() {
+    return on_worker_thread;
+}
+
+ThreadPool& ThreadPool::shared() {
+    // Intentionally leaked: joining workers from a static destructor races
+    // with detectors still running on other threads during process exit.
+    static ThreadPool* pool = new ThreadPool(
+        std::max(2u, std::min(4u, std::thread::hardware_concurrency())));
+    return *pool;
+}
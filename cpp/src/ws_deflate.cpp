@@ -0,0 +1,194 @@
+#include "ws_deflate.h"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+#include <zlib.h>
+
+// Idle streams kept per configuration; more than this are freed on release.
+static const size_t POOL_LIMIT = 4;
+static const size_t OUTPUT_STEP = 64 * 1024;
+static const unsigned char SYNC_TAIL[4] = {0x00, 0x00, 0xFF, 0xFF};
+
+// ========== Stream Pool ==========
+namespace {
+struct PooledStream {
+    z_stream* stream;
+    int windowBits;  // 0 for inflaters
+    int level;
+};
+
+struct StreamPool {
+    std::mutex mutex;
+    std::vector<PooledStream> deflaters;
+    std::vector<z_stream*> inflaters;
+};
+}
+
+static StreamPool& pool() {
+    // Intentionally leaked: the I/O thread of a client that outlives main()
+    // may still take or return streams during static destruction.
+    static StreamPool* p = new StreamPool();
+    return *p;
+}
+
+static z_stream* acquire_deflater(int windowBits, int level) {
+    StreamPool& p = pool();
+    {
+        std::lock_guard<std::mutex> lock(p.mutex);
+        for (size_t i = 0; i < p.deflaters.size(); ++i) {
+            if (p.deflaters[i].windowBits == windowBits && p.deflaters[i].level == level) {
+                z_stream* s = p.deflaters[i].stream;
+                p.deflaters[i] = p.deflaters.back();
+                p.deflaters.pop_back();
+                return s;
+            }
+        }
+    }
+    z_stream* s = new z_stream();
+    // Raw deflate (negative window bits): no zlib header or checksum.
+    if (deflateInit2(s, level, Z_DEFLATED, -windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        delete s;
+        return nullptr;
+    }
+    return s;
+}
+
+static void release_deflater(z_stream* s, int windowBits, int level) {
+    deflateReset(s);
+    StreamPool& p = pool();
+    {
+        std::lock_guard<std::mutex> lock(p.mutex);
+        if (p.deflaters.size() < POOL_LIMIT) {
+            PooledStream entry = {s, windowBits, level};
+            p.deflaters.push_back(entry);
+            return;
+        }
+    }
+    deflateEnd(s);
+    delete s;
+}
+
+static z_stream* acquire_inflater() {
+    StreamPool& p = pool();
+    {
+        std::lock_guard<std::mutex> lock(p.mutex);
+        if (!p.inflaters.empty()) {
+            z_stream* s = p.inflaters.back();
+            p.inflaters.pop_back();
+            return s;
+        }
+    }
+    // A 15-bit window decodes whatever window the server negotiated.
+    z_stream* s = new z_stream();
+    if (inflateInit2(s, -15) != Z_OK) {
+        delete s;
+        return nullptr;
+    }
+    return s;
+}
+
+static void release_inflater(z_stream* s) {
+    inflateReset(s);
+    StreamPool& p = pool();
+    {
+        std::lock_guard<std::mutex> lock(p.mutex);
+        if (p.inflaters.size() < POOL_LIMIT) {
+            p.inflaters.push_back(s);
+            return;
+        }
+    }
+    inflateEnd(s);
+    delete s;
+}
+
+// ========== Deflater ==========
+bool WsDeflater::begin(int bits, int lvl, bool contextTakeover) {
+    end();
+    if (bits < 9 || bits > 15) return false;
+    stream = acquire_deflater(bits, lvl);
+    windowBits = bits;
+    level = lvl;
+    takeover = contextTakeover;
+    return stream != nullptr;
+}
+
+void WsDeflater::end() {
+    if (!stream) return;
+    release_deflater(stream, windowBits, level);
+    stream = nullptr;
+}
+
+bool WsDeflater::compressChunk(const uint8_t* data, size_t len, bool last, std::string& out) {
+    size_t start = out.size();
+    stream->next_in = (Bytef*)data;
+    stream->avail_in = (uInt)len;
+    int rc;
+    do {
+        size_t used = out.size();
+        out.resize(used + std::max<size_t>(OUTPUT_STEP, len / 2));
+        stream->next_out = (Bytef*)&out[used];
+        stream->avail_out = (uInt)(out.size() - used);
+        rc = deflate(stream, last ? Z_SYNC_FLUSH : Z_NO_FLUSH);
+        out.resize(out.size() - stream->avail_out);
+        if (rc != Z_OK && rc != Z_BUF_ERROR) return false;
+    } while (stream->avail_in > 0 || stream->avail_out == 0);
+    if (!last) return true;
+
+    // Z_SYNC_FLUSH ends with an empty stored block; the receiver re-adds it.
+    if (out.size() - start >= 4 && out.compare(out.size() - 4, 4, (const char*)SYNC_TAIL, 4) == 0) {
+        out.resize(out.size() - 4);
+    }
+    if (!takeover) deflateReset(stream);
+    return true;
+}
+
+// ========== Inflater ==========
+bool WsInflater::begin(bool contextTakeover) {
+    end();
+    stream = acquire_inflater();
+    takeover = contextTakeover;
+    return stream != nullptr;
+}
+
+void WsInflater::end() {
+    if (!stream) return;
+    release_inflater(stream);
+    stream = nullptr;
+}
+
+bool WsInflater::decompress(const uint8_t* data, size_t len, size_t maxSize, std::string& out) {
+    out.clear();
+    return decompressChunk(data, len, true, [&out, maxSize](const char* piece, size_t n) {
+        if (n > maxSize - out.size()) return false;
+        out.append(piece, n);
+        return true;
+    });
+}
+
+bool WsInflater::decompressChunk(const uint8_t* data, size_t len, bool last, const Sink& sink) {
+    if (!inflateInto(data, len, sink)) return false;
+    if (!last) return true;
+    // The sync tail RFC 7692 removed from the end of the message.
+    if (!inflateInto(SYNC_TAIL, sizeof(SYNC_TAIL), sink)) return false;
+    if (!takeover) inflateReset(stream);
+    return true;
+}
+
+bool WsInflater::inflateInto(const uint8_t* data, size_t len, const Sink& sink) {
+    if (window.size() < OUTPUT_STEP) window.resize(OUTPUT_STEP);
+    stream->next_in = (Bytef*)data;
+    stream->avail_in = (uInt)len;
+    do {
+        stream->next_out = (Bytef*)&window[0];
+        stream->avail_out = (uInt)window.size();
+        int rc = inflate(stream, Z_SYNC_FLUSH);
+        size_t produced = window.size() - stream->avail_out;
+        if (produced > 0 && !sink(window.data(), produced)) return false;
+        // A sender may close the deflate stream (BFINAL); whatever follows
+        // starts a new one.
+        if (rc == Z_STREAM_END) inflateReset(stream);
+        else if (rc != Z_OK && rc != Z_BUF_ERROR) return false;
+    } while (stream->avail_in > 0 || stream->avail_out == 0);
+    return true;
+}
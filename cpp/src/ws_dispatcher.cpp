@@ -0,0 +1,216 @@
+#include "ws_dispatcher.h"
+
+#include <algorithm>
+
+// Largest buffer a ring slot keeps after its event is delivered, so idle
+// slots hold at most capacity * SLOT_RETAIN_BYTES.
+static const size_t SLOT_RETAIN_BYTES = 16 * 1024;
+
+// Sleeping uses the usual flag-and-fence handshake: each side stores its
+// "waiting" flag, fences, then re-checks the ring, while the other side
+// publishes, fences, then checks the flag. At least one of them sees the
+// other's store, so a wakeup is never lost, and nobody takes the mutex
+// while the ring keeps moving.
+
+void WsDispatcher::setListener(WebSocketListener* l) {
+    listener.store(l, std::memory_order_release);
+}
+
+void WsDispatcher::start(const WebSocketDelivery& opts) {
+    if (thread.joinable()) return;
+    options = opts;
+    options.capacity = std::max<size_t>(options.capacity, 2);
+    options.batchSize = std::max<size_t>(options.batchSize, 1);
+    ring.reset(new SpscRing<Event>(options.capacity));
+    batch.reserve(std::min(options.batchSize, ring->capacity()));
+    stopping = false;
+    thread = std::thread(&WsDispatcher::run, this);
+}
+
+void WsDispatcher::stop() {
+    if (!thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    readyCv.notify_all();
+    spaceCv.notify_all();
+    thread.join();
+}
+
+// ========== Producer ==========
+WsDispatcher::Event* WsDispatcher::claim(bool mayDrop) {
+    if (!ring || stopping.load(std::memory_order_relaxed)) return nullptr;
+    Event* slot = ring->producerSlot();
+    if (slot || mayDrop) return slot;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    producerWaiting.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while (!(slot = ring->producerSlot()) && !stopping.load(std::memory_order_relaxed)) spaceCv.wait(lock);
+    producerWaiting.store(false, std::memory_order_relaxed);
+    return slot;
+}
+
+void WsDispatcher::publish() {
+    ring->push();
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (consumerWaiting.load(std::memory_order_relaxed)) {
+        { std::lock_guard<std::mutex> lock(mutex); }
+        readyCv.notify_one();
+    }
+}
+
+bool WsDispatcher::streaming() const {
+    WebSocketListener* l = listener.load(std::memory_order_acquire);
+    return l && l->onMessageChunk;
+}
+
+void WsDispatcher::postSimple(Kind kind, int code, const char* data, size_t length) {
+    Event* e = claim(false);
+    if (!e) return;
+    e->kind = kind;
+    e->code = code;
+    e->data.assign(data, length);
+    publish();
+}
+
+void WsDispatcher::postOpen() {
+    postSimple(EVENT_OPEN, 0, "", 0);
+}
+
+bool WsDispatcher::postMessage(const char* data, size_t length, bool binary) {
+    Event* e = claim(options.whenFull == WebSocketDelivery::DROP);
+    if (!e) {
+        droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    e->kind = EVENT_MESSAGE;
+    e->code = binary;
+    e->data.assign(data, length);
+    publish();
+    return true;
+}
+
+void WsDispatcher::postBegin(bool binary) {
+    postSimple(EVENT_BEGIN, binary, "", 0);
+}
+
+void WsDispatcher::postChunk(const char* data, size_t length) {
+    postSimple(EVENT_CHUNK, 0, data, length);
+}
+
+void WsDispatcher::postEnd() {
+    postSimple(EVENT_END, 0, "", 0);
+}
+
+void WsDispatcher::postClose(int code, const std::string& reason) {
+    postSimple(EVENT_CLOSE, code, reason.data(), reason.size());
+}
+
+void WsDispatcher::postError(const std::string& error) {
+    postSimple(EVENT_ERROR, 0, error.data(), error.size());
+}
+
+// ========== Consumer ==========
+// Returns the number of events ready, or 0 once stopping.
+size_t WsDispatcher::waitForEvents() {
+    size_t n = ring->available();
+    if (n == 0) {
+        std::unique_lock<std::mutex> lock(mutex);
+        consumerWaiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while ((n = ring->available()) == 0 && !stopping.load(std::memory_order_relaxed)) readyCv.wait(lock);
+        consumerWaiting.store(false, std::memory_order_relaxed);
+    }
+    return stopping.load(std::memory_order_relaxed) ? 0 : n;
+}
+
+void WsDispatcher::release(size_t count) {
+    // Slots keep their capacity so small messages stop allocating, but one
+    // large message must not pin its buffer in the slot for good.
+    for (size_t i = 0; i < count; ++i) {
+        std::string& data = ring->peek(i).data;
+        if (data.capacity() > SLOT_RETAIN_BYTES) std::string().swap(data);
+    }
+    ring->pop(count);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (producerWaiting.load(std::memory_order_relaxed)) {
+        { std::lock_guard<std::mutex> lock(mutex); }
+        spaceCv.notify_one();
+    }
+}
+
+// Consecutive messages go out together; slots are released only after the
+// listener returns, so the views it gets stay valid for the whole call.
+void WsDispatcher::run() {
+    for (;;) {
+        size_t n = waitForEvents();
+        if (n == 0) return;
+        if (ring->peek(0).kind != EVENT_MESSAGE) {
+            deliver(ring->peek(0));
+            release(1);
+            continue;
+        }
+        size_t limit = std::min(n, options.batchSize);
+        size_t count = 1;
+        while (count < limit && ring->peek(count).kind == EVENT_MESSAGE) ++count;
+        deliverMessages(count);
+        release(count);
+    }
+}
+
+void WsDispatcher::deliver(const Event& event) {
+    WebSocketListener* l = listener.load(std::memory_order_acquire);
+    if (!l) return;
+    switch (event.kind) {
+    case EVENT_OPEN:
+        if (l->onOpen) l->onOpen();
+        break;
+    case EVENT_BEGIN:
+        if (l->onMessageBegin) l->onMessageBegin(event.code != 0);
+        break;
+    case EVENT_CHUNK:
+        if (l->onMessageChunk) l->onMessageChunk(event.data.data(), event.data.size());
+        break;
+    case EVENT_END:
+        if (l->onMessageEnd) l->onMessageEnd();
+        break;
+    case EVENT_CLOSE:
+        if (l->onClose) l->onClose(event.code, event.data.c_str());
+        break;
+    case EVENT_ERROR:
+        if (l->onError) l->onError(event.data.c_str());
+        break;
+    case EVENT_MESSAGE:
+        break;
+    }
+}
+
+void WsDispatcher::deliverMessages(size_t count) {
+    WebSocketListener* l = listener.load(std::memory_order_acquire);
+    if (!l) return;
+    if (l->onMessageBatch) {
+        batch.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            const std::string& data = ring->peek(i).data;
+            batch[i].data = data.data();
+            batch[i].length = data.size();
+            batch[i].binary = ring->peek(i).code != 0;
+        }
+        l->onMessageBatch(batch.data(), count);
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const std::string& data = ring->peek(i).data;
+        // Slots are std::string, so onMessage gets a NUL-terminated view
+        // without another copy.
+        if (ring->peek(i).code && l->onBinaryMessage) {
+            l->onBinaryMessage(data.data(), data.size());
+        } else if (l->onMessageData) {
+            l->onMessageData(data.data(), data.size());
+        } else if (l->onMessage) {
+            l->onMessage(data.c_str());
+        }
+    }
+}
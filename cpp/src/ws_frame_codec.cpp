@@ -0,0 +1,255 @@
+#include "ws_frame_codec.h"
+
+#include <atomic>
+#include <mutex>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define WS_HAVE_SSE2 1
+#define WS_HAVE_AVX2 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__aarch64__)
+#define WS_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+// ========== Masking Kernels ==========
+// Each kernel handles its wide blocks and hands the tail to the scalar
+// loop. Blocks are multiples of 4 bytes, so the key phase never shifts.
+static void mask_tail(uint8_t* out, const uint8_t* in, size_t len, uint32_t key) {
+    uint8_t k[4];
+    memcpy(k, &key, sizeof(k));
+    for (size_t i = 0; i < len; ++i) out[i] = in[i] ^ k[i & 3];
+}
+
+static void mask_scalar(uint8_t* out, const uint8_t* in, size_t len, uint32_t key) {
+    uint64_t key64 = ((uint64_t)key << 32) | key;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t v;
+        memcpy(&v, in + i, sizeof(v));
+        v ^= key64;
+        memcpy(out + i, &v, sizeof(v));
+    }
+    mask_tail(out + i, in + i, len - i, key);
+}
+
+#if defined(WS_HAVE_SSE2)
+__attribute__((target("sse2")))
+static void mask_sse2(uint8_t* out, const uint8_t* in, size_t len, uint32_t key) {
+    const __m128i k = _mm_set1_epi32((int)key);
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(in + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(in + i + 16));
+        __m128i c = _mm_loadu_si128((const __m128i*)(in + i + 32));
+        __m128i d = _mm_loadu_si128((const __m128i*)(in + i + 48));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_xor_si128(a, k));
+        _mm_storeu_si128((__m128i*)(out + i + 16), _mm_xor_si128(b, k));
+        _mm_storeu_si128((__m128i*)(out + i + 32), _mm_xor_si128(c, k));
+        _mm_storeu_si128((__m128i*)(out + i + 48), _mm_xor_si128(d, k));
+    }
+    for (; i + 16 <= len; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(in + i));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_xor_si128(a, k));
+    }
+    mask_scalar(out + i, in + i, len - i, key);
+}
+#endif
+
+#if defined(WS_HAVE_AVX2)
+__attribute__((target("avx2")))
+static void mask_avx2(uint8_t* out, const uint8_t* in, size_t len, uint32_t key) {
+    const __m256i k = _mm256_set1_epi32((int)key);
+    size_t i = 0;
+    for (; i + 128 <= len; i += 128) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(in + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(in + i + 32));
+        __m256i c = _mm256_loadu_si256((const __m256i*)(in + i + 64));
+        __m256i d = _mm256_loadu_si256((const __m256i*)(in + i + 96));
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_xor_si256(a, k));
+        _mm256_storeu_si256((__m256i*)(out + i + 32), _mm256_xor_si256(b, k));
+        _mm256_storeu_si256((__m256i*)(out + i + 64), _mm256_xor_si256(c, k));
+        _mm256_storeu_si256((__m256i*)(out + i + 96), _mm256_xor_si256(d, k));
+    }
+    for (; i + 32 <= len; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(in + i));
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_xor_si256(a, k));
+    }
+    mask_scalar(out + i, in + i, len - i, key);
+}
+
+static bool cpu_has_avx2() {
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+
+#if defined(WS_HAVE_NEON)
+static void mask_neon(uint8_t* out, const uint8_t* in, size_t len, uint32_t key) {
+    const uint8x16_t k = vreinterpretq_u8_u32(vdupq_n_u32(key));
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        uint8x16_t a = vld1q_u8(in + i);
+        uint8x16_t b = vld1q_u8(in + i + 16);
+        uint8x16_t c = vld1q_u8(in + i + 32);
+        uint8x16_t d = vld1q_u8(in + i + 48);
+        vst1q_u8(out + i, veorq_u8(a, k));
+        vst1q_u8(out + i + 16, veorq_u8(b, k));
+        vst1q_u8(out + i + 32, veorq_u8(c, k));
+        vst1q_u8(out + i + 48, veorq_u8(d, k));
+    }
+    for (; i + 16 <= len; i += 16) vst1q_u8(out + i, veorq_u8(vld1q_u8(in + i), k));
+    mask_scalar(out + i, in + i, len - i, key);
+}
+#endif
+
+// ========== Dispatch ==========
+static std::atomic<ws_mask_kernel_fn> active_kernel{nullptr};
+static std::atomic<int> active_kind{WS_MASK_KERNEL_SCALAR};
+
+ws_mask_kernel_fn ws_mask_kernel(WsMaskKernel kind) {
+    switch (kind) {
+        case WS_MASK_KERNEL_SCALAR: return mask_scalar;
+#if defined(WS_HAVE_SSE2)
+        case WS_MASK_KERNEL_SSE2: return mask_sse2;
+#endif
+#if defined(WS_HAVE_AVX2)
+        case WS_MASK_KERNEL_AVX2: return cpu_has_avx2() ? mask_avx2 : nullptr;
+#endif
+#if defined(WS_HAVE_NEON)
+        case WS_MASK_KERNEL_NEON: return mask_neon;
+#endif
+        default: return nullptr;
+    }
+}
+
+// Odd lengths and offsets exercise the block loops and the tail together.
+static bool kernel_matches_reference(ws_mask_kernel_fn fn) {
+    uint8_t in[300], expected[300], actual[300];
+    for (size_t i = 0; i < sizeof(in); ++i) in[i] = (uint8_t)(i * 167 + 13);
+    const uint32_t key = 0x9E3779B9u;
+    for (size_t len = 0; len + 3 <= sizeof(in); len += 37) {
+        mask_tail(expected, in + 3, len, key);
+        fn(actual, in + 3, len, key);
+        if (memcmp(expected, actual, len) != 0) return false;
+    }
+    return true;
+}
+
+static ws_mask_kernel_fn select_kernel() {
+    static const WsMaskKernel preferred[] = {WS_MASK_KERNEL_AVX2, WS_MASK_KERNEL_NEON, WS_MASK_KERNEL_SSE2};
+    for (WsMaskKernel kind : preferred) {
+        ws_mask_kernel_fn fn = ws_mask_kernel(kind);
+        if (fn && kernel_matches_reference(fn)) {
+            active_kind.store(kind, std::memory_order_relaxed);
+            return fn;
+        }
+    }
+    active_kind.store(WS_MASK_KERNEL_SCALAR, std::memory_order_relaxed);
+    return mask_scalar;
+}
+
+static ws_mask_kernel_fn resolve_kernel() {
+    ws_mask_kernel_fn fn = active_kernel.load(std::memory_order_acquire);
+    if (!fn) {
+        static std::once_flag select_once;
+        std::call_once(select_once, [] { active_kernel.store(select_kernel(), std::memory_order_release); });
+        fn = active_kernel.load(std::memory_order_acquire);
+    }
+    return fn;
+}
+
+void ws_mask(uint8_t* out, const uint8_t* in, size_t len, const uint8_t key[4]) {
+    uint32_t k;
+    memcpy(&k, key, sizeof(k));
+    resolve_kernel()(out, in, len, k);
+}
+
+WsMaskKernel ws_mask_active_kernel() {
+    resolve_kernel();
+    return (WsMaskKernel)active_kind.load(std::memory_order_relaxed);
+}
+
+const char* ws_mask_kernel_name(WsMaskKernel kind) {
+    switch (kind) {
+        case WS_MASK_KERNEL_SCALAR: return "scalar";
+        case WS_MASK_KERNEL_SSE2: return "sse2";
+        case WS_MASK_KERNEL_AVX2: return "avx2";
+        case WS_MASK_KERNEL_NEON: return "neon";
+        default: return "unknown";
+    }
+}
+
+// ========== Frames ==========
+size_t ws_encode_header(uint8_t* out, uint8_t opcode, bool fin, uint8_t rsv, uint64_t payloadLen,
+                        const uint8_t mask[4]) {
+    size_t n = 0;
+    out[n++] = (uint8_t)((fin ? 0x80 : 0) | ((rsv & 0x7) << 4) | (opcode & 0x0F));
+    if (payloadLen < 126) {
+        out[n++] = (uint8_t)(0x80 | payloadLen);
+    } else if (payloadLen <= 0xFFFF) {
+        out[n++] = 0x80 | 126;
+        out[n++] = (uint8_t)(payloadLen >> 8);
+        out[n++] = (uint8_t)payloadLen;
+    } else {
+        out[n++] = 0x80 | 127;
+        for (int shift = 56; shift >= 0; shift -= 8) out[n++] = (uint8_t)(payloadLen >> shift);
+    }
+    memcpy(out + n, mask, 4);
+    return n + 4;
+}
+
+WsParseStatus ws_parse_header(uint8_t* data, size_t len, WsFrame* frame, const char** error) {
+    if (len < 2) return WS_PARSE_INCOMPLETE;
+    uint64_t payloadLen = data[1] & 0x7F;
+    size_t header = 2;
+    if (payloadLen == 126) {
+        if (len < 4) return WS_PARSE_INCOMPLETE;
+        payloadLen = ((uint64_t)data[2] << 8) | data[3];
+        header = 4;
+    } else if (payloadLen == 127) {
+        if (len < 10) return WS_PARSE_INCOMPLETE;
+        payloadLen = 0;
+        for (int i = 0; i < 8; ++i) payloadLen = (payloadLen << 8) | data[2 + i];
+        header = 10;
+    }
+    bool masked = (data[1] & 0x80) != 0;
+    if (masked) header += 4;
+
+    frame->opcode = data[0] & 0x0F;
+    frame->rsv = (data[0] >> 4) & 0x7;
+    frame->fin = (data[0] & 0x80) != 0;
+    frame->masked = masked;
+    if ((frame->opcode & 0x8) && (!frame->fin || payloadLen > 125)) {
+        *error = "Invalid WebSocket control frame";
+        return WS_PARSE_ERROR;
+    }
+    if (payloadLen > SIZE_MAX - header) {
+        *error = "WebSocket message too large";
+        return WS_PARSE_ERROR;
+    }
+    if (len < header) return WS_PARSE_INCOMPLETE;
+
+    frame->payload = data + header;
+    frame->length = (size_t)payloadLen;
+    frame->size = header;
+    return WS_PARSE_OK;
+}
+
+WsParseStatus ws_parse_frame(uint8_t* data, size_t len, size_t maxPayload, WsFrame* frame, const char** error) {
+    WsParseStatus status = ws_parse_header(data, len, frame, error);
+    if (status != WS_PARSE_OK) return status;
+    if (frame->length > maxPayload) {
+        *error = "WebSocket message too large";
+        return WS_PARSE_ERROR;
+    }
+    size_t header = frame->size;
+    if (len - header < frame->length) return WS_PARSE_INCOMPLETE;
+
+    frame->size = header + frame->length;
+    if (frame->masked) ws_mask(frame->payload, frame->payload, frame->length, data + header - 4);
+    return WS_PARSE_OK;
+}
@@ -0,0 +1,202 @@
+#include "ws_outbound_queue.h"
+#include "ws_frame_codec.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Spilled record: length, opcode, flags, two bytes of padding, payload,
+// then padding to the next multiple of RECORD_ALIGN.
+static const size_t RECORD_HEADER = 8;
+static const size_t RECORD_ALIGN = 8;
+static const uint8_t RECORD_FIN = 1;
+static const uint8_t RECORD_STREAMED = 2;
+
+static size_t record_size(size_t payload) {
+    return (RECORD_HEADER + payload + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1);
+}
+
+WsOutgoing WsOutgoing::make(uint8_t opcode, const char* data, size_t len) {
+    WsOutgoing message;
+    message.bytes.reserve(WS_MAX_HEADER_SIZE + len);
+    message.bytes.assign(WS_MAX_HEADER_SIZE, '\0');
+    message.bytes.append(data, len);
+    message.offset = WS_MAX_HEADER_SIZE;
+    message.opcode = opcode;
+    return message;
+}
+
+WsOutboundQueue::~WsOutboundQueue() {
+    for (const Segment& s : segments) {
+        munmap(s.map, s.size);
+        close(s.fd);
+        unlink(s.path.c_str());
+    }
+}
+
+void WsOutboundQueue::configure(const WebSocketQueue& opts) {
+    options = opts;
+    options.segmentBytes = std::max<size_t>(options.segmentBytes, 64 * 1024);
+}
+
+bool WsOutboundQueue::push(WsOutgoing&& message, bool force) {
+    size_t size = message.bytes.size();
+    if (spilledCount == 0 && (force || memBytes + size <= options.memoryBytes)) {
+        memBytes += size;
+        streamTotal += message.streamBytes;
+        mem.push_back(std::move(message));
+        return true;
+    }
+    if (!spill(message, force)) return false;
+    streamTotal += message.streamBytes;
+    return true;
+}
+
+bool WsOutboundQueue::spill(const WsOutgoing& message, bool force) {
+    if (options.spillPath.empty()) return false;
+    size_t payload = message.bytes.size() - message.offset;
+    if (payload > UINT32_MAX) return false;
+    size_t need = record_size(payload);
+
+    Segment* s = segments.empty() ? nullptr : &segments.back();
+    if (s && s->writePos == 0 && s->size < need) {
+        // The drained segment kept for reuse is too small. Reading starts at
+        // the front segment, so it must not stay in front of a bigger one.
+        removeFrontSegment();
+        s = nullptr;
+    }
+    if (!s || s->size - s->writePos < need) s = addSegment(need, force);
+    if (!s) return false;
+
+    uint8_t* out = s->map + s->writePos;
+    uint32_t len = (uint32_t)payload;
+    memcpy(out, &len, sizeof(len));
+    out[4] = message.opcode;
+    out[5] = (uint8_t)((message.fin ? RECORD_FIN : 0) | (message.streamed ? RECORD_STREAMED : 0));
+    out[6] = out[7] = 0;
+    memcpy(out + RECORD_HEADER, message.bytes.data() + message.offset, payload);
+    s->writePos += need;
+    ++spilledCount;
+    return true;
+}
+
+// Give the file `size` bytes of allocated blocks. A sparse file would map
+// fine, but a store into a hole that the filesystem then cannot fill (disk
+// full, quota) raises SIGBUS instead of returning an error.
+static bool reserve_blocks(int fd, size_t size) {
+#if defined(__APPLE__)
+    fstore_t store = {F_ALLOCATECONTIG | F_ALLOCATEALL, F_PEOFPOSMODE, 0, (off_t)size, 0};
+    if (fcntl(fd, F_PREALLOCATE, &store) == -1) {
+        store.fst_flags = F_ALLOCATEALL;
+        if (fcntl(fd, F_PREALLOCATE, &store) == -1) return false;
+    }
+    return ftruncate(fd, (off_t)size) == 0;
+#else
+    int err;
+    do {
+        err = posix_fallocate(fd, 0, (off_t)size);
+    } while (err == EINTR);
+    if (err != EOPNOTSUPP && err != EINVAL) return err == 0;
+    // No fallocate on this filesystem: write the zeros ourselves.
+    static const char zeros[64 * 1024] = {};
+    for (size_t off = 0; off < size;) {
+        ssize_t n = pwrite(fd, zeros, std::min(sizeof(zeros), size - off), (off_t)off);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        off += (size_t)n;
+    }
+    return true;
+#endif
+}
+
+// Segment blocks are reserved up front, so running out of disk refuses the
+// spill (and the message is counted as dropped) rather than faulting later.
+WsOutboundQueue::Segment* WsOutboundQueue::addSegment(size_t minSize, bool force) {
+    size_t size = std::max(options.segmentBytes, minSize);
+    if (!force && segmentTotal + size > options.spillBytes) return nullptr;
+
+    Segment s;
+    s.path = options.spillPath + "." + std::to_string(nextSegment++);
+    s.fd = open(s.path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (s.fd < 0) return nullptr;
+    void* map = MAP_FAILED;
+    if (reserve_blocks(s.fd, size)) {
+        map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, s.fd, 0);
+    }
+    if (map == MAP_FAILED) {
+        close(s.fd);
+        unlink(s.path.c_str());
+        return nullptr;
+    }
+    s.map = (uint8_t*)map;
+    s.size = size;
+    s.readPos = s.writePos = 0;
+    segments.push_back(s);
+    segmentTotal += size;
+    return &segments.back();
+}
+
+void WsOutboundQueue::loadHead() {
+    if (!mem.empty()) {
+        headRecord = mem.front().bytes.size();
+    } else {
+        const Segment& s = segments.front();
+        const uint8_t* in = s.map + s.readPos;
+        uint32_t len;
+        memcpy(&len, in, sizeof(len));
+        head = WsOutgoing::make(in[4], (const char*)in + RECORD_HEADER, len);
+        head.fin = (in[5] & RECORD_FIN) != 0;
+        head.streamed = (in[5] & RECORD_STREAMED) != 0;
+        head.streamBytes = head.streamed ? len : 0;
+        headRecord = record_size(len);
+    }
+    headReady = true;
+}
+
+WsOutgoing* WsOutboundQueue::front() {
+    if (empty()) return nullptr;
+    if (!headReady) loadHead();
+    return mem.empty() ? &head : &mem.front();
+}
+
+void WsOutboundQueue::pop() {
+    if (empty()) return;
+    if (!headReady) loadHead();
+    headReady = false;
+    if (!mem.empty()) {
+        memBytes -= headRecord;
+        streamTotal -= mem.front().streamBytes;
+        mem.pop_front();
+        return;
+    }
+
+    streamTotal -= head.streamBytes;
+    --spilledCount;
+    Segment& s = segments.front();
+    s.readPos += headRecord;
+    if (s.readPos < s.writePos) return;
+    // The last segment is kept for reuse, blocks and all.
+    s.readPos = s.writePos = 0;
+    if (segments.size() > 1) removeFrontSegment();
+}
+
+void WsOutboundQueue::removeFrontSegment() {
+    Segment& s = segments.front();
+    munmap(s.map, s.size);
+    close(s.fd);
+    unlink(s.path.c_str());
+    segmentTotal -= s.size;
+    segments.pop_front();
+}
+
+void WsOutboundQueue::unshift(WsOutgoing&& message) {
+    // The memory part is always older than the spilled one, so the front
+    // of mem is the front of the queue.
+    headReady = false;
+    memBytes += message.bytes.size();
+    streamTotal += message.streamBytes;
+    mem.push_front(std::move(message));
+}
@@ -0,0 +1,175 @@
+// ========== crc32_engine tests ==========
+// Every kernel this CPU supports, the dispatching entry points,
+// crc32_engine_combine() and crc32_parallel() against a bitwise reference
+// written independently of the engine.
+
+#include "SecurityCore.h"
+#include "crc32_engine.h"
+
+#include <algorithm>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+#define CHECK_EQ(actual, expected, ...)                                                      \
+    do {                                                                                     \
+        uint32_t a_ = (actual), e_ = (expected);                                             \
+        if (a_ != e_) {                                                                      \
+            fprintf(stderr, "%s:%d: got %08x, want %08x: ", __FILE__, __LINE__, a_, e_);     \
+            fprintf(stderr, __VA_ARGS__);                                                    \
+            fputc('\n', stderr);                                                             \
+            if (++failures > 20) return;                                                     \
+        }                                                                                    \
+    } while (0)
+
+// Finalized CRC-32 of `data`, one bit at a time.
+uint32_t reference_crc(const unsigned char* data, size_t len) {
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; ++i) {
+        crc ^= data[i];
+        for (int k = 0; k < 8; ++k) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+    }
+    return ~crc;
+}
+
+std::vector<unsigned char> random_bytes(size_t len, uint32_t seed) {
+    std::vector<unsigned char> buf(len);
+    for (size_t i = 0; i < len; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        buf[i] = (unsigned char)(seed >> 16);
+    }
+    return buf;
+}
+
+void test_known_vector() {
+    const unsigned char check[] = "123456789";
+    CHECK_EQ(reference_crc(check, 9), 0xCBF43926u, "reference check value");
+    CHECK_EQ(~crc32_engine_update(0xFFFFFFFFu, check, 9), 0xCBF43926u, "engine check value");
+}
+
+// Lengths 0..1100 cover the tails and the first few iterations of every
+// block size (8 and 16 bytes, the 64-byte PCLMUL fold, the 1024-byte ARMv8
+// stride); offsets 0..15 move the start across every alignment.
+void test_kernels() {
+    const size_t MAX_LEN = 1100;
+    std::vector<unsigned char> buf = random_bytes(MAX_LEN + 16, 0x1234567u);
+    for (int kind = 0; kind < CRC32_KERNEL_COUNT; ++kind) {
+        crc32_kernel_fn fn = crc32_engine_kernel((crc32_kernel_kind)kind);
+        const char* name = crc32_engine_kernel_name((crc32_kernel_kind)kind);
+        if (!fn) {
+            printf("  %-8s not available\n", name);
+            continue;
+        }
+        int before = failures;
+        for (size_t off = 0; off < 16; ++off) {
+            for (size_t len = 0; len <= MAX_LEN; ++len) {
+                const unsigned char* p = buf.data() + off;
+                CHECK_EQ(~fn(0xFFFFFFFFu, p, len), reference_crc(p, len), "%s off=%zu len=%zu", name, off, len);
+            }
+        }
+        // Continuing the raw register across calls, split at every offset
+        const unsigned char* p = buf.data() + 3;
+        uint32_t whole = reference_crc(p, 600);
+        for (size_t split = 0; split <= 600; ++split) {
+            uint32_t crc = fn(fn(0xFFFFFFFFu, p, split), p + split, 600 - split);
+            CHECK_EQ(~crc, whole, "%s split=%zu", name, split);
+        }
+        printf("  %-8s %s\n", name, failures == before ? "ok" : "FAILED");
+    }
+}
+
+void test_public_api() {
+    std::vector<unsigned char> buf = random_bytes(70000, 42);
+    static const size_t lengths[] = {0, 1, 15, 16, 63, 64, 65, 1023, 1024, 1025, 4097, 70000};
+    for (size_t len : lengths) {
+        uint32_t want = reference_crc(buf.data(), len);
+        CHECK_EQ(sc_crc32(buf.data(), len), want, "sc_crc32 len=%zu", len);
+
+        crc32_ctx ctx;
+        crc32_init(&ctx);
+        for (size_t done = 0; done < len;) {
+            size_t n = std::min<size_t>(len - done, 1 + done % 97);
+            crc32_update(&ctx, buf.data() + done, n);
+            done += n;
+        }
+        CHECK_EQ(crc32_final(&ctx), want, "crc32_ctx len=%zu", len);
+    }
+}
+
+void test_combine() {
+    std::vector<unsigned char> buf = random_bytes(5000, 7);
+    for (size_t split = 0; split <= buf.size(); split += (split < 130 ? 1 : 97)) {
+        uint32_t a = reference_crc(buf.data(), split);
+        uint32_t b = reference_crc(buf.data() + split, buf.size() - split);
+        CHECK_EQ(crc32_engine_combine(a, b, buf.size() - split), reference_crc(buf.data(), buf.size()),
+                 "combine split=%zu", split);
+    }
+
+    // Zero-length second part leaves the first CRC unchanged
+    uint32_t empty = reference_crc(nullptr, 0);
+    CHECK_EQ(crc32_engine_combine(0xDEADBEEFu, empty, 0), 0xDEADBEEFu, "combine len2=0");
+    CHECK_EQ(sc_crc32_combine(0x12345678u, empty, 0), 0x12345678u, "sc_crc32_combine len2=0");
+
+    // Large second part, materialized
+    std::vector<unsigned char> big = random_bytes(24 * 1024 * 1024 + 13, 99);
+    uint32_t head = reference_crc(big.data(), 13);
+    uint32_t tail = reference_crc(big.data() + 13, big.size() - 13);
+    CHECK_EQ(crc32_engine_combine(head, tail, big.size() - 13), reference_crc(big.data(), big.size()),
+             "combine len2=%zu", big.size() - 13);
+
+    // Lengths beyond 4 GiB: runs of zero bytes compose, so
+    // zeros(n1) || zeros(n2) must combine to the same value however the
+    // total is split. zeros(n) is itself built by combining from 1 MiB.
+    std::vector<unsigned char> zeros(1 << 20, 0);
+    uint32_t mib = reference_crc(zeros.data(), zeros.size());
+    uint32_t z = mib;
+    uint64_t zlen = zeros.size();
+    for (int i = 0; i < 13; ++i) {  // 8 GiB
+        z = crc32_engine_combine(z, z, zlen);
+        zlen *= 2;
+    }
+    uint32_t z1 = crc32_engine_combine(mib, mib, zeros.size());  // 2 MiB
+    uint64_t z1len = 2 * zeros.size();
+    // zeros(2 MiB) || zeros(8 GiB) == zeros(8 GiB) || zeros(2 MiB)
+    CHECK_EQ(crc32_engine_combine(z1, z, zlen), crc32_engine_combine(z, z1, z1len), "combine len2=%llu",
+             (unsigned long long)zlen);
+    // Associativity: (A || B) || C == A || (B || C) with |C| > 4 GiB
+    uint32_t a = reference_crc(buf.data(), 100);
+    uint32_t b = reference_crc(buf.data() + 100, 900);
+    CHECK_EQ(crc32_engine_combine(crc32_engine_combine(a, b, 900), z, zlen),
+             crc32_engine_combine(a, crc32_engine_combine(b, z, zlen), 900 + zlen), "combine associativity");
+}
+
+void test_parallel() {
+    // Sizes below, at and above the per-worker minimum, with ragged tails
+    static const size_t lengths[] = {0, 1000, 256 * 1024, 512 * 1024 + 1, 3 * 1024 * 1024 + 777};
+    std::vector<unsigned char> buf = random_bytes(3 * 1024 * 1024 + 777 + 5, 2024);
+    for (size_t len : lengths) {
+        uint32_t want = reference_crc(buf.data() + 5, len);
+        for (unsigned int threads : {0u, 1u, 2u, 3u, 8u}) {
+            CHECK_EQ(crc32_parallel(buf.data() + 5, len, threads), want, "parallel len=%zu threads=%u", len, threads);
+        }
+    }
+}
+
+}  // namespace
+
+int main() {
+    printf("crc32 kernels (active: %s)\n", crc32_engine_kernel_name(crc32_engine_active_kernel()));
+    test_known_vector();
+    test_kernels();
+    test_public_api();
+    test_combine();
+    test_parallel();
+    if (failures) {
+        fprintf(stderr, "%d failure(s)\n", failures);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
@@ -0,0 +1,937 @@
+// ========== WebSocketClient echo tests ==========
+// Runs WebSocketClient against a minimal RFC 6455 echo server on
+// 127.0.0.1: a burst of small text messages, binary data with NUL bytes,
+// a message large enough for a 64-bit length, a streamed message and the
+// closing handshake. The server echoes every data frame as it was sent
+// (fragments included), so the client's reassembly is exercised too.
+// The burst is repeated with permessage-deflate under several server
+// answers, through the streaming receive callbacks, and over TLS with a
+// pinned self-signed certificate and session resumption. A stalled batch
+// listener makes DROP delivery discard messages. Another server
+// drops its first connection in the middle of a burst that spills to
+// disk, and must still get every message exactly once.
+
+#include "WebSocketClient.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <condition_variable>
+#include <dirent.h>
+#include <errno.h>
+#include <memory>
+#include <mutex>
+#include <netinet/in.h>
+#include <signal.h>
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <zlib.h>
+
+namespace {
+
+// ========== Server-side permessage-deflate ==========
+// Window size a permessage-deflate response sets for name, 15 if unset.
+int window_bits(const std::string& response, const char* name) {
+    size_t pos = response.find(name);
+    if (pos == std::string::npos) return 15;
+    pos += strlen(name);
+    return pos < response.size() && response[pos] == '=' ? atoi(response.c_str() + pos + 1) : 15;
+}
+
+// The server's codecs, configured from the response it sent. Client
+// messages are inflated with the window and context takeover the client
+// was told to use, so a client that ignores them fails to decode.
+class ServerDeflate {
+public:
+    explicit ServerDeflate(const std::string& response) {
+        memset(&inflater, 0, sizeof(inflater));
+        memset(&deflater, 0, sizeof(deflater));
+        inflaterTakeover = response.find("client_no_context_takeover") == std::string::npos;
+        deflaterTakeover = response.find("server_no_context_takeover") == std::string::npos;
+        ok = inflateInit2(&inflater, -window_bits(response, "client_max_window_bits")) == Z_OK &&
+             deflateInit2(&deflater, 6, Z_DEFLATED, -window_bits(response, "server_max_window_bits"), 8,
+                          Z_DEFAULT_STRATEGY) == Z_OK;
+    }
+
+    ~ServerDeflate() {
+        inflateEnd(&inflater);
+        deflateEnd(&deflater);
+    }
+
+    ServerDeflate(const ServerDeflate&) = delete;
+    ServerDeflate& operator=(const ServerDeflate&) = delete;
+
+    bool inflateMessage(std::string data, std::string& out) {
+        if (!ok) return false;
+        data.append("\x00\x00\xff\xff", 4);  // stripped by the sender (RFC 7692 7.2.2)
+        inflater.next_in = (Bytef*)&data[0];
+        inflater.avail_in = (uInt)data.size();
+        out.clear();
+        char buf[64 * 1024];
+        do {
+            inflater.next_out = (Bytef*)buf;
+            inflater.avail_out = sizeof(buf);
+            int rc = inflate(&inflater, Z_SYNC_FLUSH);
+            if (rc != Z_OK && rc != Z_BUF_ERROR) return false;
+            out.append(buf, sizeof(buf) - inflater.avail_out);
+        } while (inflater.avail_out == 0);
+        if (!inflaterTakeover) inflateReset(&inflater);
+        return inflater.avail_in == 0;
+    }
+
+    bool deflateMessage(const std::string& data, std::string& out) {
+        if (!ok) return false;
+        deflater.next_in = (Bytef*)data.data();
+        deflater.avail_in = (uInt)data.size();
+        out.clear();
+        char buf[64 * 1024];
+        do {
+            deflater.next_out = (Bytef*)buf;
+            deflater.avail_out = sizeof(buf);
+            int rc = deflate(&deflater, Z_SYNC_FLUSH);
+            if (rc != Z_OK && rc != Z_BUF_ERROR) return false;
+            out.append(buf, sizeof(buf) - deflater.avail_out);
+        } while (deflater.avail_out == 0);
+        if (!deflaterTakeover) deflateReset(&deflater);
+        // The flush ends in 00 00 FF FF, which is not sent (RFC 7692 7.2.1).
+        if (out.size() < 4) return false;
+        out.resize(out.size() - 4);
+        return true;
+    }
+
+private:
+    z_stream inflater;
+    z_stream deflater;
+    bool inflaterTakeover = true;
+    bool deflaterTakeover = true;
+    bool ok = false;
+};
+
+// ========== Server certificate ==========
+// A self-signed P-256 certificate for the echo server, and the base64
+// SHA-256 pin of its public key. Returns null on failure.
+SSL_CTX* make_server_tls(std::string& pin) {
+    EVP_PKEY* key = nullptr;
+    EVP_PKEY_CTX* keygen = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+    bool ok = keygen && EVP_PKEY_keygen_init(keygen) > 0 &&
+              EVP_PKEY_CTX_set_ec_paramgen_curve_nid(keygen, NID_X9_62_prime256v1) > 0 &&
+              EVP_PKEY_keygen(keygen, &key) > 0;
+    EVP_PKEY_CTX_free(keygen);
+
+    X509* cert = ok ? X509_new() : nullptr;
+    if (cert) {
+        X509_set_version(cert, 2);
+        ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+        X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+        X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+        X509_set_pubkey(cert, key);
+        X509_NAME* name = X509_get_subject_name(cert);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*)"127.0.0.1", -1, -1, 0);
+        X509_set_issuer_name(cert, name);
+        ok = X509_sign(cert, key, EVP_sha256()) > 0;
+    }
+
+    SSL_CTX* ctx = ok ? SSL_CTX_new(TLS_server_method()) : nullptr;
+    if (ctx && (SSL_CTX_use_certificate(ctx, cert) != 1 || SSL_CTX_use_PrivateKey(ctx, key) != 1)) {
+        SSL_CTX_free(ctx);
+        ctx = nullptr;
+    }
+    if (ctx) {
+        unsigned char* der = nullptr;
+        int len = i2d_PUBKEY(key, &der);
+        unsigned char digest[SHA256_DIGEST_LENGTH];
+        SHA256(der, (size_t)len, digest);
+        OPENSSL_free(der);
+        unsigned char encoded[64];
+        EVP_EncodeBlock(encoded, digest, sizeof(digest));
+        pin = (const char*)encoded;
+    }
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return ctx;
+}
+
+// ========== Echo server ==========
+// Serves connections one after another. extensions is the
+// permessage-deflate response to a client that offers it; when empty the
+// offer is declined. Agreed connections echo whole messages, compressed
+// and split into 64 KiB frames. With dropAfter set, the first
+// connection echoes nothing: after dropAfter data messages it stops
+// reading, closes its side on drop(), and after release() reads what the
+// client had already written. Every data frame received is recorded
+// (every message, on agreed connections). With tls set, connections are
+// accepted over TLS.
+class EchoServer {
+public:
+    explicit EchoServer(const std::string& extensions = std::string(), int dropAfter = -1, SSL_CTX* tls = nullptr)
+        : extensions(extensions), dropAfter(dropAfter), tls(tls) {
+        listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        // A small receive window makes a stalled server back the client up
+        // quickly. Accepted sockets inherit it.
+        int window = 64 * 1024;
+        if (dropAfter >= 0) setsockopt(listenFd, SOL_SOCKET, SO_RCVBUF, &window, sizeof(window));
+        if (listenFd < 0 || bind(listenFd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listenFd, 1) != 0 ||
+            getsockname(listenFd, (struct sockaddr*)&addr, &len) != 0) {
+            perror("echo server");
+            return;
+        }
+        port = ntohs(addr.sin_port);
+        thread = std::thread(&EchoServer::serve, this);
+    }
+
+    ~EchoServer() {
+        drop();
+        release();
+        shutdown(listenFd, SHUT_RDWR);
+        if (thread.joinable()) thread.join();
+        close(listenFd);
+    }
+
+    void drop() {
+        std::lock_guard<std::mutex> lock(mutex);
+        dropped = true;
+        cv.notify_all();
+    }
+
+    void release() {
+        std::lock_guard<std::mutex> lock(mutex);
+        released = true;
+        cv.notify_all();
+    }
+
+    // Waits up to 10 s for count recorded frames in total.
+    bool waitReceived(size_t count) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return cv.wait_for(lock, std::chrono::seconds(10), [this, count] { return frames.size() >= count; });
+    }
+
+    std::vector<std::string> received() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return frames;
+    }
+
+    // The client's last Sec-WebSocket-Extensions header.
+    std::string offer() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return lastOffer;
+    }
+
+    size_t compressedMessages() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return compressedCount;
+    }
+
+    // TLS connections that resumed an earlier session.
+    size_t resumed() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return resumedCount;
+    }
+
+    int port = 0;
+
+private:
+    int listenFd = -1;
+    std::string extensions;
+    int dropAfter;
+    SSL_CTX* tls;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool dropped = false;
+    bool released = false;
+    std::vector<std::string> frames;  // as recorded, over all connections
+    std::string lastOffer;
+    size_t compressedCount = 0;       // messages that arrived compressed
+    size_t resumedCount = 0;
+
+    struct Connection {
+        int fd;
+        SSL* ssl;  // null for plain TCP
+    };
+
+    static bool readFull(const Connection& c, void* buf, size_t len) {
+        char* p = (char*)buf;
+        while (len > 0) {
+            ssize_t n = c.ssl ? SSL_read(c.ssl, p, (int)len) : read(c.fd, p, len);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            p += n;
+            len -= (size_t)n;
+        }
+        return true;
+    }
+
+    static bool writeFull(const Connection& c, const void* buf, size_t len) {
+        const char* p = (const char*)buf;
+        while (len > 0) {
+            ssize_t n = c.ssl ? SSL_write(c.ssl, p, (int)len) : write(c.fd, p, len);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            p += n;
+            len -= (size_t)n;
+        }
+        return true;
+    }
+
+    static bool sendFrame(const Connection& c, uint8_t first, const std::string& payload) {
+        std::string frame(1, (char)first);
+        size_t len = payload.size();
+        if (len < 126) {
+            frame += (char)len;
+        } else if (len < 65536) {
+            frame += (char)126;
+            frame += (char)(len >> 8);
+            frame += (char)len;
+        } else {
+            frame += (char)127;
+            for (int shift = 56; shift >= 0; shift -= 8) frame += (char)((uint64_t)len >> shift);
+        }
+        frame += payload;
+        return writeFull(c, frame.data(), frame.size());
+    }
+
+    // One compressed message, split into frames of at most 64 KiB so the
+    // client inflates across fragments.
+    static bool sendCompressed(const Connection& c, uint8_t opcode, ServerDeflate& deflate, const std::string& message) {
+        std::string data;
+        if (!deflate.deflateMessage(message, data)) return false;
+        size_t pos = 0;
+        do {
+            size_t n = std::min<size_t>(data.size() - pos, 64 * 1024);
+            uint8_t first = (uint8_t)((pos == 0 ? 0x40 | opcode : 0) | (pos + n == data.size() ? 0x80 : 0));
+            if (!sendFrame(c, first, data.substr(pos, n))) return false;
+            pos += n;
+        } while (pos < data.size());
+        return true;
+    }
+
+    // Sets deflate when the client offered permessage-deflate and the
+    // server has a response for it.
+    bool handshake(const Connection& c, std::unique_ptr<ServerDeflate>& deflate) {
+        std::string request;
+        char ch;
+        while (request.find("\r\n\r\n") == std::string::npos) {
+            if (!readFull(c, &ch, 1)) return false;
+            request += ch;
+        }
+        const char* header = "Sec-WebSocket-Key: ";
+        size_t start = request.find(header);
+        if (start == std::string::npos) return false;
+        start += strlen(header);
+        std::string key = request.substr(start, request.find("\r\n", start) - start);
+        key += "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+        unsigned char digest[SHA_DIGEST_LENGTH];
+        SHA1((const unsigned char*)key.data(), key.size(), digest);
+        unsigned char accept[64];
+        EVP_EncodeBlock(accept, digest, sizeof(digest));
+
+        std::string offer;
+        const char* offerHeader = "Sec-WebSocket-Extensions: ";
+        start = request.find(offerHeader);
+        if (start != std::string::npos) {
+            start += strlen(offerHeader);
+            offer = request.substr(start, request.find("\r\n", start) - start);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            lastOffer = offer;
+        }
+
+        std::string response = "HTTP/1.1 101 Switching Protocols\r\n"
+                               "Upgrade: websocket\r\n"
+                               "Connection: Upgrade\r\n"
+                               "Sec-WebSocket-Accept: " + std::string((const char*)accept) + "\r\n";
+        if (!extensions.empty() && offer.find("permessage-deflate") != std::string::npos) {
+            response += "Sec-WebSocket-Extensions: " + extensions + "\r\n";
+            deflate.reset(new ServerDeflate(extensions));
+        }
+        response += "\r\n";
+        return writeFull(c, response.data(), response.size());
+    }
+
+    // Echo data frames until the client closes.
+    void echo(const Connection& c, bool drop, ServerDeflate* deflate) {
+        std::string message;  // compressed connections echo whole messages
+        uint8_t messageOpcode = 0;
+        bool messageCompressed = false;
+        for (int count = 0;; ++count) {
+            if (drop && count == dropAfter) {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [this] { return dropped; });
+                shutdown(c.fd, SHUT_WR);
+                cv.wait(lock, [this] { return released; });
+            }
+            unsigned char head[2];
+            if (!readFull(c, head, 2)) return;
+            uint64_t len = head[1] & 0x7F;
+            if (len == 126 || len == 127) {
+                unsigned char ext[8];
+                size_t extLen = len == 126 ? 2 : 8;
+                if (!readFull(c, ext, extLen)) return;
+                len = 0;
+                for (size_t i = 0; i < extLen; ++i) len = (len << 8) | ext[i];
+            }
+            unsigned char mask[4] = {0, 0, 0, 0};
+            if ((head[1] & 0x80) && !readFull(c, mask, 4)) return;
+            std::string payload(len, '\0');
+            if (len && !readFull(c, &payload[0], len)) return;
+            for (uint64_t i = 0; i < len; ++i) payload[i] ^= (char)mask[i & 3];
+
+            uint8_t opcode = head[0] & 0x0F;
+            if (opcode == 0x8) {
+                sendFrame(c, 0x88, payload);
+                return;
+            }
+            if (opcode == 0x9) {
+                if (!sendFrame(c, 0x8A, payload)) return;
+                continue;
+            }
+            if (opcode == 0xA) continue;
+            if (deflate) {
+                if (opcode != 0) {
+                    messageOpcode = opcode;
+                    messageCompressed = (head[0] & 0x40) != 0;
+                    message.clear();
+                }
+                message += payload;
+                if (!(head[0] & 0x80)) continue;
+                if (!messageCompressed) {
+                    payload.swap(message);
+                } else if (!deflate->inflateMessage(message, payload)) {
+                    fprintf(stderr, "echo server: cannot inflate a client message\n");
+                    return;
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                frames.push_back(payload);
+                if (deflate && messageCompressed) ++compressedCount;
+                cv.notify_all();
+            }
+            if (drop) continue;
+            if (deflate ? !sendCompressed(c, messageOpcode, *deflate, payload) : !sendFrame(c, head[0], payload)) return;
+        }
+    }
+
+    void serve() {
+        for (int connection = 0;; ++connection) {
+            Connection c = {accept(listenFd, nullptr, nullptr), nullptr};
+            if (c.fd < 0) return;
+            if (tls) {
+                c.ssl = SSL_new(tls);
+                SSL_set_fd(c.ssl, c.fd);
+                if (SSL_accept(c.ssl) == 1) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (SSL_session_reused(c.ssl)) ++resumedCount;
+                } else {
+                    SSL_free(c.ssl);
+                    c.ssl = nullptr;
+                    close(c.fd);
+                    continue;
+                }
+            }
+            std::unique_ptr<ServerDeflate> deflate;
+            if (handshake(c, deflate)) echo(c, dropAfter >= 0 && connection == 0, deflate.get());
+            if (c.ssl) {
+                SSL_shutdown(c.ssl);
+                SSL_free(c.ssl);
+            }
+            close(c.fd);
+        }
+    }
+};
+
+// ========== Listener ==========
+struct Received {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool opened = false;
+    std::vector<int> closeCodes;
+    std::string error;
+    std::vector<std::pair<bool, std::string>> messages;  // (binary, payload)
+    std::pair<bool, std::string> streamed;               // message being streamed in
+    size_t chunks = 0;
+    size_t batches = 0;
+    size_t largestBatch = 0;
+};
+
+Received received;
+
+void on_open() {
+    std::lock_guard<std::mutex> lock(received.mutex);
+    received.opened = true;
+    received.cv.notify_all();
+}
+
+void on_message_data(const char* data, size_t length) {
+    std::lock_guard<std::mutex> lock(received.mutex);
+    received.messages.push_back(std::make_pair(false, std::string(data, length)));
+    received.cv.notify_all();
+}
+
+void on_binary_message(const char* data, size_t length) {
+    std::lock_guard<std::mutex> lock(received.mutex);
+    received.messages.push_back(std::make_pair(true, std::string(data, length)));
+    received.cv.notify_all();
+}
+
+void on_message_begin(bool binary) {
+    std::lock_guard<std::mutex> lock(received.mutex);
+    received.streamed = std::make_pair(binary, std::string());
+}
+
+void on_message_chunk(const char* data, size_t length) {
+    std::lock_guard<std::mutex> lock(received.mutex);
+    received.streamed.second.append(data, length);
+    ++received.chunks;
+}
+
+void on_message_end() {
+    std::lock_guard<std::mutex> lock(received.mutex);
+    received.messages.push_back(received.streamed);
+    received.cv.notify_all();
+}
+
+void on_message_batch(const WebSocketMessage* messages, size_t count) {
+    size_t batch;
+    {
+        std::lock_guard<std::mutex> lock(received.mutex);
+        for (size_t i = 0; i < count; ++i) {
+            received.messages.push_back(
+                std::make_pair(messages[i].binary, std::string(messages[i].data, messages[i].length)));
+        }
+        received.largestBatch = std::max(received.largestBatch, count);
+        batch = received.batches++;
+        received.cv.notify_all();
+    }
+    // Stall once, so the events behind this batch fill the ring.
+    if (batch == 0) std::this_thread::sleep_for(std::chrono::milliseconds(200));
+}
+
+void on_close(int code, const char*) {
+    std::lock_guard<std::mutex> lock(received.mutex);
+    received.closeCodes.push_back(code);
+    received.cv.notify_all();
+}
+
+void on_error(const char* error) {
+    std::lock_guard<std::mutex> lock(received.mutex);
+    received.error = error;
+    received.cv.notify_all();
+}
+
+void reset_received() {
+    std::lock_guard<std::mutex> lock(received.mutex);
+    received.opened = false;
+    received.closeCodes.clear();
+    received.error.clear();
+    received.messages.clear();
+    received.chunks = 0;
+    received.batches = 0;
+    received.largestBatch = 0;
+}
+
+template <typename Pred>
+bool wait_for(Pred pred) {
+    std::unique_lock<std::mutex> lock(received.mutex);
+    return received.cv.wait_for(lock, std::chrono::seconds(10), pred);
+}
+
+int failures = 0;
+const char* scenario = "";
+
+void expect(bool ok, const char* what) {
+    if (!ok) {
+        fprintf(stderr, "FAILED: %s: %s\n", scenario, what);
+        ++failures;
+    }
+}
+
+size_t count_files(const char* dir) {
+    size_t count = 0;
+    if (DIR* d = opendir(dir)) {
+        while (struct dirent* entry = readdir(d)) {
+            if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) ++count;
+        }
+        closedir(d);
+    }
+    return count;
+}
+
+// Every kind of message, echoed back in order. response is the server's
+// permessage-deflate answer (empty declines), and offer must appear in the
+// client's Sec-WebSocket-Extensions header.
+void echo_burst(const char* name, WebSocketListener* listener, const WebSocketCompression& compression,
+                const std::string& response, const std::string& offer) {
+    scenario = name;
+    EchoServer server(response);
+    if (!server.port) {
+        ++failures;
+        return;
+    }
+    reset_received();
+
+    // Expected echoes, in order
+    std::vector<std::pair<bool, std::string>> sent;
+    {
+        WebSocketClient client("ws://127.0.0.1:" + std::to_string(server.port) + "/echo", "");
+        client.setListener(listener);
+        client.setCompression(compression);
+        client.connect();
+        expect(wait_for([] { return received.opened || !received.error.empty(); }) && received.opened, "open");
+
+        for (int i = 0; i < 2000; ++i) {
+            std::string msg = "message " + std::to_string(i);
+            client.send(msg);
+            sent.push_back(std::make_pair(false, msg));
+        }
+
+        // Long enough to be compressed, and alike, so with context takeover
+        // each refers back into the one before.
+        for (int i = 0; i < 50; ++i) {
+            std::string msg = "status report " + std::to_string(i) +
+                              ": the quick brown fox jumps over the lazy dog while the outbox drains";
+            client.send(msg);
+            sent.push_back(std::make_pair(false, msg));
+        }
+
+        std::string binary;
+        for (int i = 0; i < 512; ++i) binary += (char)(i & 0xFF);
+        client.sendBinary(binary.data(), binary.size());
+        sent.push_back(std::make_pair(true, binary));
+
+        std::string large(300 * 1024, 'x');
+        for (size_t i = 0; i < large.size(); i += 4096) large[i] = (char)('a' + (i / 4096) % 26);
+        client.send(large);
+        sent.push_back(std::make_pair(false, large));
+
+        // Random 8 KiB blocks, each repeated once: too little redundancy to
+        // fit one 64 KiB frame compressed, and matches further back than a
+        // 9-bit window reaches.
+        std::string blocks;
+        uint32_t seed = 12345;
+        while (blocks.size() < 256 * 1024) {
+            std::string block(8192, '\0');
+            for (size_t i = 0; i < block.size(); ++i) {
+                seed = seed * 1103515245 + 12345;
+                block[i] = (char)(seed >> 24);
+            }
+            blocks += block + block;
+        }
+        client.sendBinary(blocks.data(), blocks.size());
+        sent.push_back(std::make_pair(true, blocks));
+
+        std::string streamed;
+        client.beginMessage(true);
+        for (int i = 0; i < 3; ++i) {
+            std::string chunk(70000 + i, (char)('0' + i));
+            expect(client.sendChunk(chunk.data(), chunk.size()), "sendChunk");
+            streamed += chunk;
+        }
+        expect(client.endMessage(), "endMessage");
+        sent.push_back(std::make_pair(true, streamed));
+
+        size_t want = sent.size();
+        expect(wait_for([want] { return received.messages.size() >= want || !received.error.empty(); }),
+               "all echoes received");
+        {
+            std::lock_guard<std::mutex> lock(received.mutex);
+            expect(received.error.empty(), received.error.c_str());
+            expect(received.messages.size() == want, "echo count");
+            for (size_t i = 0; i < want && i < received.messages.size(); ++i) {
+                if (received.messages[i] != sent[i]) {
+                    fprintf(stderr, "echo %zu differs (%zu bytes, want %zu)\n", i, received.messages[i].second.size(),
+                            sent[i].second.size());
+                    ++failures;
+                    break;
+                }
+            }
+        }
+        expect(client.droppedSends() == 0, "no dropped sends");
+
+        client.close();
+        expect(wait_for([] { return !received.closeCodes.empty(); }) && received.closeCodes == std::vector<int>{1000},
+               "close 1000");
+    }
+    expect(server.offer().find(offer) != std::string::npos, "extension offer");
+    expect(response.empty() || server.compressedMessages() > 0, "client messages compressed");
+}
+
+// wss:// against a self-signed server: a wrong pin is refused, the right
+// one connects, and connecting again resumes the TLS session. Messages
+// go through the TLS write coalescing, compressed.
+void tls_resume(WebSocketListener* listener) {
+    scenario = "tls";
+    std::string pin;
+    SSL_CTX* tls = make_server_tls(pin);
+    if (!tls) {
+        fprintf(stderr, "cannot create a server certificate\n");
+        ++failures;
+        return;
+    }
+    {
+        EchoServer server("permessage-deflate", -1, tls);
+        if (!server.port) {
+            ++failures;
+            SSL_CTX_free(tls);
+            return;
+        }
+        std::string url = "wss://127.0.0.1:" + std::to_string(server.port) + "/tls";
+
+        reset_received();
+        {
+            WebSocketClient client(url, "sha256/AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA=");
+            client.setListener(listener);
+            client.connect();
+            expect(wait_for([] { return received.opened || !received.error.empty(); }) && !received.opened,
+                   "wrong pin refused");
+        }
+
+        WebSocketClient client(url, pin);
+        client.setListener(listener);
+        for (int round = 0; round < 2; ++round) {
+            reset_received();
+            client.connect();
+            expect(wait_for([] { return received.opened || !received.error.empty(); }) && received.opened, "open");
+
+            std::vector<std::pair<bool, std::string>> sent;
+            for (int i = 0; i < 500; ++i) {
+                std::string msg = "secure message " + std::to_string(i);
+                client.send(msg);
+                sent.push_back(std::make_pair(false, msg));
+            }
+            std::string large(200 * 1024, 'y');
+            client.send(large);
+            sent.push_back(std::make_pair(false, large));
+
+            size_t want = sent.size();
+            expect(wait_for([want] { return received.messages.size() >= want || !received.error.empty(); }),
+                   "all echoes received");
+            {
+                std::lock_guard<std::mutex> lock(received.mutex);
+                expect(received.error.empty(), received.error.c_str());
+                expect(received.messages == sent, "echoes match");
+            }
+            client.close();
+            expect(wait_for([] { return !received.closeCodes.empty(); }) && received.closeCodes == std::vector<int>{1000},
+                   "close 1000");
+        }
+        expect(server.resumed() == 1, "second connection resumed the session");
+    }
+    SSL_CTX_free(tls);
+}
+
+// A listener that stalls fills a small event ring. Under DROP the I/O
+// thread keeps reading and discards new messages instead of waiting; the
+// others arrive in order and in batches, and the close is never dropped.
+void drop_when_full(WebSocketListener* listener) {
+    scenario = "drop when full";
+    EchoServer server;
+    if (!server.port) {
+        ++failures;
+        return;
+    }
+    reset_received();
+
+    WebSocketCompression compression;
+    compression.enabled = false;
+    WebSocketDelivery delivery;
+    delivery.capacity = 16;
+    delivery.batchSize = 8;
+    delivery.whenFull = WebSocketDelivery::DROP;
+
+    const size_t want = 2000;
+    {
+        WebSocketClient client("ws://127.0.0.1:" + std::to_string(server.port) + "/batch", "");
+        client.setListener(listener);
+        client.setCompression(compression);
+        client.setDelivery(delivery);
+        client.connect();
+        expect(wait_for([] { return received.opened || !received.error.empty(); }) && received.opened, "open");
+
+        for (size_t i = 0; i < want; ++i) client.send(std::to_string(i));
+        // Dropped messages leave no event to wait for, so poll.
+        size_t delivered = 0;
+        for (int i = 0; i < 1000; ++i) {
+            {
+                std::lock_guard<std::mutex> lock(received.mutex);
+                delivered = received.messages.size();
+            }
+            if (delivered + client.droppedMessages() >= want) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        expect(delivered + client.droppedMessages() == want, "every echo delivered or counted");
+        expect(client.droppedMessages() > 0, "echoes dropped while the listener stalled");
+
+        client.close();
+        expect(wait_for([] { return !received.closeCodes.empty(); }) && received.closeCodes == std::vector<int>{1000},
+               "close 1000");
+    }
+
+    std::lock_guard<std::mutex> lock(received.mutex);
+    long previous = -1;
+    for (size_t i = 0; i < received.messages.size(); ++i) {
+        long n = atol(received.messages[i].second.c_str());
+        if (n <= previous) {
+            fprintf(stderr, "delivered %ld after %ld\n", n, previous);
+            ++failures;
+            break;
+        }
+        previous = n;
+    }
+    expect(received.largestBatch > 1 && received.largestBatch <= 8, "batches of up to batchSize");
+}
+
+// The server drops the first connection while framed messages wait for
+// the socket and the rest of the burst is spilled to disk. The client reconnects, and the server must get every message
+// exactly once, in order. The segment files go with the client.
+void drop_mid_burst(WebSocketListener* listener) {
+    scenario = "drop";
+    EchoServer server("", 100);
+    if (!server.port) {
+        ++failures;
+        return;
+    }
+    reset_received();
+
+    char dir[] = "/tmp/ws_spill_XXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        ++failures;
+        return;
+    }
+    std::string spillPath = std::string(dir) + "/outbox";
+
+    WebSocketCompression compression;
+    compression.enabled = false;
+    WebSocketReconnect reconnect;
+    reconnect.enabled = true;
+    reconnect.initialDelayMs = 10;
+    reconnect.maxDelayMs = 50;
+    WebSocketQueue queue;
+    queue.memoryBytes = 256 * 1024;
+    queue.spillPath = spillPath;
+    queue.segmentBytes = 1024 * 1024;
+
+    std::vector<std::string> sent;
+    {
+        WebSocketClient client("ws://127.0.0.1:" + std::to_string(server.port) + "/drop", "");
+        client.setListener(listener);
+        client.setCompression(compression);
+        client.setReconnect(reconnect);
+        client.setQueue(queue);
+        client.connect();
+        expect(wait_for([] { return received.opened || !received.error.empty(); }) && received.opened, "open");
+
+        // The kernel keeps taking bytes after it stops reporting the socket
+        // writable, so the drop could find the small messages all written.
+        // One message larger than the socket buffers is still partly
+        // written when the connection goes.
+        std::string filler(2048, '.');
+        for (int i = 0; i < 6000; ++i) {
+            std::string msg = std::to_string(i) + (i == 200 ? std::string(8 * 1024 * 1024, '#') : filler);
+            client.send(msg);
+            sent.push_back(msg);
+        }
+        expect(count_files(dir) > 0, "burst spilled to disk");
+        // Reading resumes only once the client has given up on the
+        // connection, with framed messages still waiting for the socket.
+        server.drop();
+        expect(wait_for([] { return !received.closeCodes.empty(); }), "connection dropped");
+        server.release();
+
+        expect(server.waitReceived(sent.size()), "all messages received after the drop");
+        expect(client.droppedSends() == 0, "no dropped sends after the drop");
+        client.close();
+        expect(wait_for([] { return received.closeCodes.size() >= 2; }) &&
+                   received.closeCodes == std::vector<int>({1006, 1000}),
+               "close 1006 then 1000");
+    }
+
+    std::vector<std::string> got = server.received();
+    expect(got.size() == sent.size(), "each message received once");
+    for (size_t i = 0; i < got.size() && i < sent.size(); ++i) {
+        if (got[i] != sent[i]) {
+            fprintf(stderr, "message %zu differs: %.16s, want %.16s\n", i, got[i].c_str(), sent[i].c_str());
+            ++failures;
+            break;
+        }
+    }
+
+    expect(count_files(dir) == 0, "segment files removed");
+    rmdir(dir);
+}
+
+}  // namespace
+
+int main() {
+    // The echo server may write to a socket the client has just closed.
+    signal(SIGPIPE, SIG_IGN);
+
+    WebSocketListener listener;
+    memset(&listener, 0, sizeof(listener));
+    listener.onOpen = on_open;
+    listener.onMessageData = on_message_data;
+    listener.onBinaryMessage = on_binary_message;
+    listener.onClose = on_close;
+    listener.onError = on_error;
+
+    WebSocketCompression plain;
+    plain.enabled = false;
+    echo_burst("uncompressed", &listener, plain, "", "");
+
+    WebSocketCompression deflate;
+    echo_burst("deflate", &listener, deflate, "permessage-deflate", "permessage-deflate; client_max_window_bits");
+    // Both sides must start every message from an empty history.
+    echo_burst("no context takeover", &listener, deflate,
+               "permessage-deflate; server_no_context_takeover; client_no_context_takeover", "");
+    // Out-of-range windows are clamped in the offer; the server then holds
+    // the client to a 9-bit window, from the same pool of zlib streams.
+    WebSocketCompression clamped;
+    clamped.clientMaxWindowBits = 20;
+    clamped.serverMaxWindowBits = 4;
+    echo_burst("small windows", &listener, clamped,
+               "permessage-deflate; client_max_window_bits=9; server_max_window_bits=9",
+               "client_max_window_bits; server_max_window_bits=9");
+
+    WebSocketListener streaming = listener;
+    streaming.onMessageBegin = on_message_begin;
+    streaming.onMessageChunk = on_message_chunk;
+    streaming.onMessageEnd = on_message_end;
+    echo_burst("streamed receive", &streaming, plain, "", "");
+    expect(received.chunks > received.messages.size(), "large messages arrive in pieces");
+    echo_burst("streamed inflate", &streaming, deflate, "permessage-deflate", "");
+    expect(received.chunks > received.messages.size(), "large messages arrive in pieces");
+
+    tls_resume(&listener);
+
+    WebSocketListener batching = listener;
+    batching.onMessageBatch = on_message_batch;
+    drop_when_full(&batching);
+
+    drop_mid_burst(&listener);
+
+    if (failures) {
+        fprintf(stderr, "%d failure(s)\n", failures);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
@@ -0,0 +1,257 @@
+// ========== SecurityCoreSigGen ==========
+// Builds a signature database image (see sig_db.h) from a text source such
+// as signatures/signatures.txt, or checks an existing image.
+//
+//   SecurityCoreSigGen signatures.txt signatures.scsig
+//   SecurityCoreSigGen --check signatures.scsig
+//   SecurityCoreSigGen --check-builtin signatures.txt
+//
+// --check-builtin compares the source with the built-in set compiled into
+// the library (src/sig_db.cpp), entry by entry; the revision is ignored.
+//
+// The output is written to a temporary file and renamed over the target,
+// so an app that has the old image mapped keeps reading intact data.
+
+#include "root_checker.h"
+#include "sig_db.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct SetName {
+    const char* name;
+    SigSetId id;
+};
+
+const SetName SET_NAMES[] = {
+    {"thread_names", SIG_THREAD_NAMES},
+    {"maps", SIG_MAPS},
+    {"image_names", SIG_IMAGE_NAMES},
+    {"env_vars", SIG_ENV_VARS},
+    {"packages", SIG_PACKAGES},
+    {"symbols", SIG_SYMBOLS},
+};
+
+struct GroupName {
+    const char* name;
+    unsigned int group;
+};
+
+const GroupName GROUP_NAMES[] = {
+    {"root_binaries", INDICATOR_ROOT_BINARIES},
+    {"frida_server", INDICATOR_FRIDA_SERVER},
+    {"jailbreak_basic", INDICATOR_JAILBREAK_BASIC},
+    {"jailbreak_apt", INDICATOR_JAILBREAK_APT},
+    {"frida_files", INDICATOR_FRIDA_FILES},
+};
+
+const char* set_name(SigSetId id) {
+    for (const SetName& s : SET_NAMES) {
+        if (s.id == id) return s.name;
+    }
+    return "paths";
+}
+
+std::string trim(const std::string& s) {
+    size_t start = s.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos) return "";
+    size_t end = s.find_last_not_of(" \t\r\n");
+    return s.substr(start, end - start + 1);
+}
+
+// "[set]" or "[paths group]"
+bool parse_section(const std::string& header, SigSetId* id, unsigned int* tag) {
+    std::string inner = trim(header.substr(1, header.size() - 2));
+    for (const SetName& s : SET_NAMES) {
+        if (inner == s.name) {
+            *id = s.id;
+            *tag = 0;
+            return true;
+        }
+    }
+    if (inner.compare(0, 6, "paths ") != 0) return false;
+    std::string group = trim(inner.substr(6));
+    for (const GroupName& g : GROUP_NAMES) {
+        if (group == g.name) {
+            *id = SIG_PATHS;
+            *tag = g.group;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parse_source(const char* path, SigDbBuilder& builder) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+
+    bool ok = true;
+    bool inSection = false;
+    SigSetId id = SIG_THREAD_NAMES;
+    unsigned int tag = 0;
+    char buf[SIG_DB_MAX_STRING + 2];
+    for (unsigned int lineNo = 1; ok && fgets(buf, sizeof(buf), f); ++lineNo) {
+        if (!strchr(buf, '\n') && !feof(f)) {
+            fprintf(stderr, "%s:%u: line too long\n", path, lineNo);
+            ok = false;
+            break;
+        }
+        std::string line = trim(buf);
+        if (line.empty() || line[0] == '#') continue;
+
+        unsigned long revision;
+        char extra;
+        if (line.compare(0, 9, "revision ") == 0) {
+            if (sscanf(line.c_str() + 9, "%lu %c", &revision, &extra) != 1 || revision > 0xFFFFFFFFUL) {
+                fprintf(stderr, "%s:%u: bad revision\n", path, lineNo);
+                ok = false;
+            } else {
+                builder.setRevision((uint32_t)revision);
+            }
+        } else if (line[0] == '[' && line[line.size() - 1] == ']') {
+            inSection = parse_section(line, &id, &tag);
+            if (!inSection) {
+                fprintf(stderr, "%s:%u: unknown section %s\n", path, lineNo, line.c_str());
+                ok = false;
+            }
+        } else if (!inSection) {
+            fprintf(stderr, "%s:%u: entry outside a section\n", path, lineNo);
+            ok = false;
+        } else if (!builder.add(id, line, tag)) {
+            fprintf(stderr, "%s:%u: cannot add \"%s\" to %s (duplicate, bad path or set full)\n", path, lineNo,
+                    line.c_str(), set_name(id));
+            ok = false;
+        }
+    }
+    fclose(f);
+    return ok;
+}
+
+bool write_image(const char* path, const std::vector<uint64_t>& image) {
+    std::string tmp = std::string(path) + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f) {
+        perror(tmp.c_str());
+        return false;
+    }
+    size_t bytes = image.size() * sizeof(uint64_t);
+    bool ok = fwrite(image.data(), 1, bytes, f) == bytes;
+    ok = fclose(f) == 0 && ok;
+    if (ok && rename(tmp.c_str(), path) != 0) {
+        perror(path);
+        ok = false;
+    }
+    if (!ok) remove(tmp.c_str());
+    return ok;
+}
+
+int check_image(const char* path) {
+    std::shared_ptr<const SigDb> db = SigDb::open(path);
+    if (!db) {
+        fprintf(stderr, "%s: not a valid signature image (format %d)\n", path, SIG_DB_FORMAT_VERSION);
+        return 1;
+    }
+    printf("%s: revision %u\n", path, db->revision());
+    for (int id = 0; id < SIG_SET_COUNT; ++id) {
+        size_t count = sig_set_kind((SigSetId)id) == SIG_KIND_PATTERNS ? db->matcher((SigSetId)id).patternCount()
+                                                                        : db->count((SigSetId)id);
+        printf("  %-13s %zu\n", set_name((SigSetId)id), count);
+    }
+    return 0;
+}
+
+typedef std::vector<std::pair<std::string, unsigned int>> SetEntries;
+
+// Entries with their tags; exact sets sorted, since their order is the
+// perfect hash's rather than the source's.
+SetEntries set_entries(const SigDb& db, SigSetId id) {
+    SetEntries out;
+    for (size_t i = 0; i < db.count(id); ++i) out.push_back(std::make_pair(db.string(id, i), db.tag(id, i)));
+    if (sig_set_kind(id) == SIG_KIND_EXACT) std::sort(out.begin(), out.end());
+    return out;
+}
+
+std::vector<uint8_t> matcher_image(const PatternMatcher& matcher) {
+    std::vector<uint8_t> out(matcher.imageSize());
+    if (!out.empty()) matcher.writeImage(out.data());
+    return out;
+}
+
+int check_builtin(const char* path) {
+    SigDbBuilder builder;
+    if (!parse_source(path, builder)) return 1;
+    std::vector<uint64_t> image;
+    if (!builder.build(image)) {
+        fprintf(stderr, "%s: a pattern set is over the matcher's size limit\n", path);
+        return 1;
+    }
+    std::shared_ptr<const SigDb> source = SigDb::fromImage(std::move(image));
+    std::shared_ptr<const SigDb> builtin = sig_db_active();
+    if (!source) {
+        fprintf(stderr, "%s: built image does not validate\n", path);
+        return 1;
+    }
+
+    int differences = 0;
+    for (int id = 0; id < SIG_SET_COUNT; ++id) {
+        SigSetId set = (SigSetId)id;
+        bool same;
+        if (sig_set_kind(set) == SIG_KIND_PATTERNS) {
+            // Same patterns in the same order compile to the same automaton
+            same = matcher_image(source->matcher(set)) == matcher_image(builtin->matcher(set));
+        } else {
+            SetEntries want = set_entries(*source, set);
+            SetEntries have = set_entries(*builtin, set);
+            same = want == have;
+            for (size_t i = 0; !same && i < std::max(want.size(), have.size()); ++i) {
+                if (i < want.size() && i < have.size() && want[i] == have[i]) continue;
+                fprintf(stderr, "  %s entry %zu: source \"%s\", built-in \"%s\"\n", set_name(set), i,
+                        i < want.size() ? want[i].first.c_str() : "", i < have.size() ? have[i].first.c_str() : "");
+                break;
+            }
+        }
+        if (!same) {
+            fprintf(stderr, "%s: [%s] differs from the built-in set in src/sig_db.cpp\n", path, set_name(set));
+            ++differences;
+        }
+    }
+    if (differences) return 1;
+    printf("%s: matches the built-in set\n", path);
+    return 0;
+}
+
+void usage(const char* argv0) {
+    printf("usage: %s SOURCE OUTPUT\n"
+           "       %s --check IMAGE\n"
+           "       %s --check-builtin SOURCE\n", argv0, argv0, argv0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 3 && strcmp(argv[1], "--check") == 0) return check_image(argv[2]);
+    if (argc == 3 && strcmp(argv[1], "--check-builtin") == 0) return check_builtin(argv[2]);
+    if (argc != 3 || argv[1][0] == '-') {
+        usage(argv[0]);
+        return argc == 2 && (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-h") == 0) ? 0 : 2;
+    }
+
+    SigDbBuilder builder;
+    if (!parse_source(argv[1], builder)) return 1;
+    std::vector<uint64_t> image;
+    if (!builder.build(image)) {
+        fprintf(stderr, "%s: a pattern set is over the matcher's size limit\n", argv[1]);
+        return 1;
+    }
+    if (!write_image(argv[2], image)) return 1;
+    return check_image(argv[2]);
+}
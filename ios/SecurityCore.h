@@ -53,9 +53,53 @@
        resolve:(RCTPromiseResolveBlock)resolve
         reject:(RCTPromiseRejectBlock)reject;
 
+- (void)sha256:(NSArray *)data
+        resolve:(RCTPromiseResolveBlock)resolve
+         reject:(RCTPromiseRejectBlock)reject;
+
+- (void)crc32File:(NSString *)path
+          resolve:(RCTPromiseResolveBlock)resolve
+           reject:(RCTPromiseRejectBlock)reject;
+
+- (void)sha256File:(NSString *)path
+           resolve:(RCTPromiseResolveBlock)resolve
+            reject:(RCTPromiseRejectBlock)reject;
+
+- (void)verifyPackageFiles:(NSArray *)files
+                 cachePath:(NSString *)cachePath
+                   resolve:(RCTPromiseResolveBlock)resolve
+                    reject:(RCTPromiseRejectBlock)reject;
+
+- (void)loadSignatures:(NSString *)path
+               resolve:(RCTPromiseResolveBlock)resolve
+                reject:(RCTPromiseRejectBlock)reject;
+
+- (void)getSignatureRevision:(RCTPromiseResolveBlock)resolve
+                      reject:(RCTPromiseRejectBlock)reject;
+
+- (void)findRootPackages:(RCTPromiseResolveBlock)resolve
+                  reject:(RCTPromiseRejectBlock)reject;
+
 - (void)startSelfHeal:(RCTPromiseResolveBlock)resolve
                reject:(RCTPromiseRejectBlock)reject;
 
+- (void)stopMonitor:(RCTPromiseResolveBlock)resolve
+             reject:(RCTPromiseRejectBlock)reject;
+
+// ========== Batched Checks ==========
+- (void)runAllChecks:(double)mask
+          deadlineMs:(double)deadlineMs
+        stopOnDetect:(BOOL)stopOnDetect
+             resolve:(RCTPromiseResolveBlock)resolve
+              reject:(RCTPromiseRejectBlock)reject;
+
+// ========== Instrumentation ==========
+- (void)getStats:(RCTPromiseResolveBlock)resolve
+          reject:(RCTPromiseRejectBlock)reject;
+
+- (void)resetStats:(RCTPromiseResolveBlock)resolve
+            reject:(RCTPromiseRejectBlock)reject;
+
 // ========== Unified Root/Jailbreak Detection ==========
 - (void)isRooted:(RCTPromiseResolveBlock)resolve
            reject:(RCTPromiseRejectBlock)reject;
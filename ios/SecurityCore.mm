@@ -1,23 +1,114 @@
 #import "SecurityCore.h"
 #import <React/RCTLog.h>
+#import <UIKit/UIKit.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
 
 // Import C++ library
 extern "C" {
     #include "SecurityCore.h"
 }
 
+static BOOL parseHexDigest(NSString *hex, unsigned char *out)
+{
+    if (![hex isKindOfClass:[NSString class]] || hex.length != SC_SHA256_LENGTH * 2) return NO;
+    const char *chars = [hex UTF8String];
+    for (int i = 0; i < SC_SHA256_LENGTH; i++) {
+        unsigned int byte;
+        if (sscanf(chars + i * 2, "%2x", &byte) != 1) return NO;
+        out[i] = (unsigned char)byte;
+    }
+    return YES;
+}
+
+static NSString *stripFileScheme(NSString *path)
+{
+    if ([path hasPrefix:@"file://"]) {
+        return [[NSURL URLWithString:path] path] ?: [path substringFromIndex:7];
+    }
+    return path;
+}
+
+static NSString *hexString(const unsigned char *bytes, size_t len)
+{
+    NSMutableString *hex = [NSMutableString stringWithCapacity:len * 2];
+    for (size_t i = 0; i < len; i++) {
+        [hex appendFormat:@"%02x", bytes[i]];
+    }
+    return hex;
+}
+
+// Strips a file:// scheme; the descriptor is read by the C++ side, so the
+// contents never pass through JS or Objective-C memory
+static int openForHashing(NSString *path)
+{
+    return open([stripFileScheme(path) fileSystemRepresentation], O_RDONLY | O_CLOEXEC);
+}
+
+// Promise methods hand the scan to sc_submit() and resolve from its
+// completion callback, so no bridge thread waits on the checks
+typedef void (^SCChecksDoneBlock)(bool detected, const sc_check_result *results);
+
+static void onChecksDone(sc_task task, bool detected, const sc_check_result *results, void *userdata)
+{
+    @autoreleasepool {
+        SCChecksDoneBlock done = (__bridge_transfer SCChecksDoneBlock)userdata;
+        done(detected, results);
+    }
+}
+
+static void submitChecks(unsigned int mask, unsigned int deadlineMs, bool stopOnDetect, SCChecksDoneBlock done)
+{
+    sc_submit(mask, deadlineMs, stopOnDetect, NULL, onChecksDone, (__bridge_retained void *)[done copy]);
+}
+
 @implementation SecurityCore
 
 RCT_EXPORT_MODULE()
 
+- (instancetype)init
+{
+    if ((self = [super init])) {
+        // Background monitors sleep while the app is in the background
+        NSNotificationCenter *center = [NSNotificationCenter defaultCenter];
+        [center addObserver:self
+                   selector:@selector(appDidEnterBackground)
+                       name:UIApplicationDidEnterBackgroundNotification
+                     object:nil];
+        [center addObserver:self
+                   selector:@selector(appWillEnterForeground)
+                       name:UIApplicationWillEnterForegroundNotification
+                     object:nil];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+- (void)appDidEnterBackground
+{
+    security_core_monitor_pause();
+}
+
+- (void)appWillEnterForeground
+{
+    security_core_monitor_resume();
+}
+
 // ========== Android Security Functions ==========
 
 RCT_EXPORT_METHOD(runAdvancedChecks:(RCTPromiseResolveBlock)resolve
                   reject:(RCTPromiseRejectBlock)reject)
 {
     @try {
-        bool result = run_advanced_checks();
-        resolve(@(result));
+        submitChecks(SC_ADVANCED_CHECKS_MASK, 0, true, ^(bool detected, const sc_check_result *results) {
+            resolve(@(!detected));
+        });
     } @catch (NSException *exception) {
         reject(@"ERROR", exception.reason, nil);
     }
@@ -161,8 +252,9 @@ RCT_EXPORT_METHOD(isRooted:(RCTPromiseResolveBlock)resolve
                   reject:(RCTPromiseRejectBlock)reject)
 {
     @try {
-        bool result = is_rooted();
-        resolve(@(result));
+        submitChecks(SC_ROOT_CHECKS_MASK, 0, true, ^(bool detected, const sc_check_result *results) {
+            resolve(@(detected));
+        });
     } @catch (NSException *exception) {
         reject(@"ERROR", exception.reason, nil);
     }
@@ -188,23 +280,168 @@ RCT_EXPORT_METHOD(crc32:(NSArray *)data
                   reject:(RCTPromiseRejectBlock)reject)
 {
     @try {
-        // Convert NSArray to unsigned char array
+        // Stream NSArray through a fixed buffer instead of copying it whole
+        NSInteger length = [data count];
+        unsigned char chunk[4096];
+        crc32_ctx ctx;
+        crc32_init(&ctx);
+
+        NSInteger filled = 0;
+        for (NSInteger i = 0; i < length; i++) {
+            chunk[filled++] = [[data objectAtIndex:i] unsignedCharValue];
+            if (filled == sizeof(chunk)) {
+                crc32_update(&ctx, chunk, filled);
+                filled = 0;
+            }
+        }
+        crc32_update(&ctx, chunk, filled);
+
+        unsigned int result = crc32_final(&ctx);
+        resolve(@(result));
+    } @catch (NSException *exception) {
+        reject(@"ERROR", exception.reason, nil);
+    }
+}
+
+RCT_EXPORT_METHOD(sha256:(NSArray *)data
+                  resolve:(RCTPromiseResolveBlock)resolve
+                  reject:(RCTPromiseRejectBlock)reject)
+{
+    @try {
         NSInteger length = [data count];
-        unsigned char *bytes = malloc(length);
-        
+        NSMutableData *bytes = [NSMutableData dataWithLength:length];
+        unsigned char *out = (unsigned char *)[bytes mutableBytes];
         for (NSInteger i = 0; i < length; i++) {
-            bytes[i] = [[data objectAtIndex:i] unsignedCharValue];
+            out[i] = [[data objectAtIndex:i] unsignedCharValue];
+        }
+
+        unsigned char digest[SC_SHA256_LENGTH];
+        sha256_digest(out, length, digest);
+        resolve(hexString(digest, sizeof(digest)));
+    } @catch (NSException *exception) {
+        reject(@"ERROR", exception.reason, nil);
+    }
+}
+
+RCT_EXPORT_METHOD(crc32File:(NSString *)path
+                  resolve:(RCTPromiseResolveBlock)resolve
+                  reject:(RCTPromiseRejectBlock)reject)
+{
+    @try {
+        int fd = openForHashing(path);
+        unsigned int result = 0;
+        bool ok = fd >= 0 && crc32_fd(fd, &result);
+        if (fd >= 0) close(fd);
+        if (!ok) {
+            reject(@"ERROR", [NSString stringWithFormat:@"cannot read %@", path], nil);
+            return;
         }
-        
-        unsigned int result = crc32(bytes, length);
-        free(bytes);
-        
         resolve(@(result));
     } @catch (NSException *exception) {
         reject(@"ERROR", exception.reason, nil);
     }
 }
 
+RCT_EXPORT_METHOD(sha256File:(NSString *)path
+                  resolve:(RCTPromiseResolveBlock)resolve
+                  reject:(RCTPromiseRejectBlock)reject)
+{
+    @try {
+        int fd = openForHashing(path);
+        unsigned char digest[SC_SHA256_LENGTH];
+        bool ok = fd >= 0 && sha256_fd(fd, digest);
+        if (fd >= 0) close(fd);
+        if (!ok) {
+            reject(@"ERROR", [NSString stringWithFormat:@"cannot read %@", path], nil);
+            return;
+        }
+        resolve(hexString(digest, sizeof(digest)));
+    } @catch (NSException *exception) {
+        reject(@"ERROR", exception.reason, nil);
+    }
+}
+
+// files: [{ path, sha256 }]. Relative paths are resolved against the app
+// bundle. cachePath nil uses the module's cache in Library/Caches; @""
+// disables the cache
+RCT_EXPORT_METHOD(verifyPackageFiles:(NSArray *)files
+                  cachePath:(NSString *)cachePath
+                  resolve:(RCTPromiseResolveBlock)resolve
+                  reject:(RCTPromiseRejectBlock)reject)
+{
+    @try {
+        NSString *bundlePath = [[NSBundle mainBundle] bundlePath];
+        std::vector<std::string> paths(files.count);
+        std::vector<sc_file_digest> digests(files.count);
+        for (NSUInteger i = 0; i < files.count; i++) {
+            NSDictionary *entry = files[i];
+            NSString *path = [entry isKindOfClass:[NSDictionary class]] ? entry[@"path"] : nil;
+            if (![path isKindOfClass:[NSString class]] || !parseHexDigest(entry[@"sha256"], digests[i].sha256)) {
+                reject(@"ERROR", [NSString stringWithFormat:@"files[%lu] needs a path and a 64-digit sha256",
+                                  (unsigned long)i], nil);
+                return;
+            }
+            path = stripFileScheme(path);
+            if (![path isAbsolutePath]) path = [bundlePath stringByAppendingPathComponent:path];
+            paths[i] = [path fileSystemRepresentation];
+        }
+        for (NSUInteger i = 0; i < files.count; i++) {
+            digests[i].path = paths[i].c_str();
+        }
+
+        NSString *cache = cachePath;
+        if (cache == nil) {
+            NSString *caches = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES).firstObject;
+            cache = [caches stringByAppendingPathComponent:@"security_core_files.cache"];
+        } else {
+            cache = stripFileScheme(cache);
+        }
+
+        std::vector<sc_file_status> statuses(files.count);
+        bool verified = verify_package_files(digests.data(), digests.size(),
+                                             cache.length ? [cache fileSystemRepresentation] : NULL,
+                                             statuses.data());
+        NSMutableArray *list = [NSMutableArray arrayWithCapacity:files.count];
+        for (sc_file_status status : statuses) {
+            [list addObject:@(status)];
+        }
+        resolve(@{ @"verified": @(verified), @"statuses": list });
+    } @catch (NSException *exception) {
+        reject(@"ERROR", exception.reason, nil);
+    }
+}
+
+// Replace the active signature set with an image built by
+// SecurityCoreSigGen; resolves its revision. Write updates to a new file
+// and rename it into place rather than rewriting the loaded one.
+RCT_EXPORT_METHOD(loadSignatures:(NSString *)path
+                  resolve:(RCTPromiseResolveBlock)resolve
+                  reject:(RCTPromiseRejectBlock)reject)
+{
+    @try {
+        if (!security_core_load_signatures([stripFileScheme(path) fileSystemRepresentation])) {
+            reject(@"ERROR", [NSString stringWithFormat:@"signature file rejected: %@", path], nil);
+            return;
+        }
+        resolve(@(security_core_signature_revision()));
+    } @catch (NSException *exception) {
+        reject(@"ERROR", exception.reason, nil);
+    }
+}
+
+RCT_EXPORT_METHOD(getSignatureRevision:(RCTPromiseResolveBlock)resolve
+                  reject:(RCTPromiseRejectBlock)reject)
+{
+    resolve(@(security_core_signature_revision()));
+}
+
+// Apps cannot list installed apps on iOS
+RCT_EXPORT_METHOD(findRootPackages:(RCTPromiseResolveBlock)resolve
+                  reject:(RCTPromiseRejectBlock)reject)
+{
+    resolve(@[]);
+}
+
 RCT_EXPORT_METHOD(startSelfHeal:(RCTPromiseResolveBlock)resolve
                   reject:(RCTPromiseRejectBlock)reject)
 {
@@ -216,6 +453,100 @@ RCT_EXPORT_METHOD(startSelfHeal:(RCTPromiseResolveBlock)resolve
     }
 }
 
+RCT_EXPORT_METHOD(stopMonitor:(RCTPromiseResolveBlock)resolve
+                  reject:(RCTPromiseRejectBlock)reject)
+{
+    @try {
+        security_core_monitor_stop();
+        resolve(nil);
+    } @catch (NSException *exception) {
+        reject(@"ERROR", exception.reason, nil);
+    }
+}
+
+// ========== Batched Checks ==========
+
+RCT_EXPORT_METHOD(runAllChecks:(double)mask
+                  deadlineMs:(double)deadlineMs
+                  stopOnDetect:(BOOL)stopOnDetect
+                  resolve:(RCTPromiseResolveBlock)resolve
+                  reject:(RCTPromiseRejectBlock)reject)
+{
+    @try {
+        submitChecks((unsigned int)mask, (unsigned int)deadlineMs, stopOnDetect,
+                     ^(bool anyDetected, const sc_check_result *results) {
+            unsigned int detected = 0, clean = 0, cancelled = 0, timedOut = 0;
+            NSMutableArray *elapsed = [NSMutableArray arrayWithCapacity:SC_CHECK_COUNT];
+            for (int id = 0; id < SC_CHECK_COUNT; id++) {
+                switch (results[id].status) {
+                    case SC_STATUS_DETECTED: detected |= SC_CHECK_BIT(id); break;
+                    case SC_STATUS_CLEAN: clean |= SC_CHECK_BIT(id); break;
+                    case SC_STATUS_CANCELLED: cancelled |= SC_CHECK_BIT(id); break;
+                    case SC_STATUS_TIMED_OUT: timedOut |= SC_CHECK_BIT(id); break;
+                    default: break;
+                }
+                [elapsed addObject:@(results[id].elapsed_us)];
+            }
+            resolve(@{
+                @"detected": @(anyDetected),
+                @"detectedMask": @(detected),
+                @"cleanMask": @(clean),
+                @"cancelledMask": @(cancelled),
+                @"timedOutMask": @(timedOut),
+                @"elapsedUs": elapsed,
+            });
+        });
+    } @catch (NSException *exception) {
+        reject(@"ERROR", exception.reason, nil);
+    }
+}
+
+// ========== Instrumentation ==========
+
+RCT_EXPORT_METHOD(getStats:(RCTPromiseResolveBlock)resolve
+                  reject:(RCTPromiseRejectBlock)reject)
+{
+    @try {
+        sc_check_stats stats[SC_CHECK_COUNT];
+        security_core_get_stats(stats);
+
+        NSMutableArray *result = [NSMutableArray arrayWithCapacity:SC_CHECK_COUNT];
+        for (int id = 0; id < SC_CHECK_COUNT; id++) {
+            const sc_check_stats &s = stats[id];
+            NSMutableArray *buckets = [NSMutableArray arrayWithCapacity:SC_STATS_BUCKETS];
+            for (int b = 0; b < SC_STATS_BUCKETS; b++) {
+                [buckets addObject:@(s.latency_buckets[b])];
+            }
+            [result addObject:@{
+                @"id": @(id),
+                @"name": @(security_core_check_name((sc_check_id)id)),
+                @"calls": @(s.calls),
+                @"detections": @(s.detections),
+                @"cacheHits": @(s.cache_hits),
+                @"cancelled": @(s.cancelled),
+                @"timeouts": @(s.timeouts),
+                @"totalNs": @(s.total_ns),
+                @"maxNs": @(s.max_ns),
+                @"latencyBuckets": buckets,
+            }];
+        }
+        resolve(result);
+    } @catch (NSException *exception) {
+        reject(@"ERROR", exception.reason, nil);
+    }
+}
+
+RCT_EXPORT_METHOD(resetStats:(RCTPromiseResolveBlock)resolve
+                  reject:(RCTPromiseRejectBlock)reject)
+{
+    @try {
+        security_core_reset_stats();
+        resolve(nil);
+    } @catch (NSException *exception) {
+        reject(@"ERROR", exception.reason, nil);
+    }
+}
+
 // ========== Module Configuration ==========
 
 + (BOOL)requiresMainQueueSetup
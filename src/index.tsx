@@ -17,6 +17,75 @@ const SecurityCore = NativeModules.SecurityCore
       }
     );
 
+export interface CheckStats {
+  id: number;
+  name: string;
+  calls: number;
+  detections: number;
+  cacheHits: number;
+  cancelled: number;
+  timeouts: number;
+  totalNs: number;
+  maxNs: number;
+  // latencyBuckets[i] counts runs that took [2^i, 2^(i+1)) ns
+  latencyBuckets: number[];
+}
+
+// Mirrors sc_check_id in SecurityCore.h; bit `1 << id` selects a check
+export enum CheckId {
+  Debugger = 0,
+  FridaThread,
+  MemoryMaps,
+  ProcessName,
+  Integrity,
+  RootPaths,
+  SystemProps,
+  RwSystemMount,
+  FridaServer,
+  JailbreakPaths,
+  SandboxEscape,
+  FridaSymbols,
+  FridaEnv,
+  FridaFiles,
+}
+
+export const CHECK_COUNT = 14;
+export const ALL_CHECKS_MASK = (1 << CHECK_COUNT) - 1;
+
+export interface CheckRunResult {
+  detected: boolean;
+  // Bit `1 << CheckId` per check; a selected check that is in none of the
+  // masks does not apply to this platform
+  detectedMask: number;
+  cleanMask: number;
+  cancelledMask: number;
+  timedOutMask: number;
+  // Indexed by CheckId; 0 for checks answered from the cache or not run
+  elapsedUs: number[];
+}
+
+// Mirrors sc_file_status in SecurityCore.h
+export enum FileStatus {
+  Verified = 0,
+  Cached,
+  Mismatch,
+  Unreadable,
+}
+
+export interface PackageFile {
+  // Absolute, file://, or relative to the native library directory
+  // (Android) / app bundle (iOS)
+  path: string;
+  // Expected SHA-256, 64 hex digits
+  sha256: string;
+}
+
+export interface PackageVerifyResult {
+  verified: boolean;
+  // FileStatus per entry of the files argument
+  statuses: FileStatus[];
+}
+
 export interface SecurityCoreInterface {
   // ========== Android Security Functions ==========
   runAdvancedChecks(): Promise<boolean>;
@@ -38,6 +107,39 @@ export interface SecurityCoreInterface {
   // ========== Utility Functions ==========
   xorDecode(encoded: string, key: number): Promise<string>;
   crc32(data: number[]): Promise<number>;
+  // Lowercase hex digest
+  sha256(data: number[]): Promise<string>;
+  // Hashed natively from the file descriptor; accepts plain or file:// paths
+  crc32File(path: string): Promise<number>;
+  sha256File(path: string): Promise<string>;
+  verifyPackageFiles(
+    files: PackageFile[],
+    cachePath: string | null
+  ): Promise<PackageVerifyResult>;
+
+  // ========== Signatures ==========
+  // Resolves the revision of the loaded set; rejects if the file is invalid
+  // or older than the active set
+  loadSignatures(path: string): Promise<number>;
+  getSignatureRevision(): Promise<number>;
+  // Installed packages matching the root package signatures (Android)
+  findRootPackages(): Promise<string[]>;
+
+  // ========== Background Monitor ==========
+  startSelfHeal(): Promise<boolean>;
+  stopMonitor(): Promise<void>;
+
+  // ========== Batched Checks ==========
+  runAllChecks(
+    mask: number,
+    deadlineMs: number,
+    stopOnDetect: boolean
+  ): Promise<CheckRunResult>;
+
+  // ========== Instrumentation ==========
+  // Per-check counters and latency histograms since start or the last reset
+  getStats(): Promise<CheckStats[]>;
+  resetStats(): Promise<void>;
 
   // ========== Unified Root/Jailbreak Detection ==========
   isRooted(): Promise<boolean>;
@@ -154,6 +256,110 @@ export class SecurityCoreHelper {
     }
   }
 
+  static async calculateSHA256(data: number[]): Promise<string | null> {
+    try {
+      return await this.instance.sha256(data);
+    } catch (error) {
+      console.error('SHA-256 calculation failed:', error);
+      return null;
+    }
+  }
+
+  // Large files are read by native code and never cross the bridge.
+  // Resolves null if the file cannot be read.
+  static async calculateFileCRC32(path: string): Promise<number | null> {
+    try {
+      return await this.instance.crc32File(path);
+    } catch (error) {
+      console.error('File CRC32 calculation failed:', error);
+      return null;
+    }
+  }
+
+  static async calculateFileSHA256(path: string): Promise<string | null> {
+    try {
+      return await this.instance.sha256File(path);
+    } catch (error) {
+      console.error('File SHA-256 calculation failed:', error);
+      return null;
+    }
+  }
+
+  // Files are hashed in parallel natively. Files that verified before and
+  // are unchanged on disk (same inode, size, mtime, ctime) are skipped via
+  // a small cache, so only the first launch after an install pays for the
+  // hashing. cachePath null uses the default location, '' disables it.
+  // Resolves null on invalid arguments.
+  static async verifyPackageFiles(
+    files: PackageFile[],
+    cachePath: string | null = null
+  ): Promise<PackageVerifyResult | null> {
+    try {
+      return await this.instance.verifyPackageFiles(files, cachePath);
+    } catch (error) {
+      console.error('Package file verification failed:', error);
+      return null;
+    }
+  }
+
+  // ========== Signatures ==========
+  // Swap in a signature image built by SecurityCoreSigGen (cpp/tools),
+  // e.g. one downloaded by the app. Write the download to a new file and
+  // rename it into place. Checks already running finish with the old set.
+  // Resolves the new revision, or null if the file was rejected.
+  static async loadSignatures(path: string): Promise<number | null> {
+    try {
+      return await this.instance.loadSignatures(path);
+    } catch (error) {
+      console.error('Loading signatures failed:', error);
+      return null;
+    }
+  }
+
+  static async findRootPackages(): Promise<string[]> {
+    try {
+      return await this.instance.findRootPackages();
+    } catch (error) {
+      console.error('Root package lookup failed:', error);
+      return [];
+    }
+  }
+
+  // ========== Batched Checks ==========
+  // One bridge call for every selected check, run concurrently natively.
+  // deadlineMs == 0 waits for all of them.
+  static async runAllChecks(
+    mask: number = ALL_CHECKS_MASK,
+    deadlineMs: number = 0,
+    stopOnDetect: boolean = false
+  ): Promise<CheckRunResult | null> {
+    try {
+      return await this.instance.runAllChecks(mask, deadlineMs, stopOnDetect);
+    } catch (error) {
+      console.error('Batched security check failed:', error);
+      return null;
+    }
+  }
+
+  // ========== Instrumentation ==========
+  static async getStats(): Promise<CheckStats[]> {
+    try {
+      return await this.instance.getStats();
+    } catch (error) {
+      console.error('Reading check stats failed:', error);
+      return [];
+    }
+  }
+
+  // Start a new measurement window, e.g. after warm-up.
+  static async resetStats(): Promise<void> {
+    try {
+      await this.instance.resetStats();
+    } catch (error) {
+      console.error('Resetting check stats failed:', error);
+    }
+  }
+
   // ========== Unified Root/Jailbreak ==========
   static async isRooted(): Promise<boolean> {
     try {